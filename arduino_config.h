@@ -8,24 +8,126 @@
 #define CONFIG_H
 
 // WiFi Configuration
-const char* WIFI_SSID = "SLT_FIBRE";
-const char* WIFI_PASSWORD = "abcd1234";
+const char* const WIFI_SSID = "SLT_FIBRE";
+const char* const WIFI_PASSWORD = "abcd1234";
+const bool WIFI_FAST_CONNECT = true;
+const char* const WIFI_STATIC_IP = "";
+const char* const WIFI_GATEWAY = "";
+const char* const WIFI_SUBNET = "255.255.255.0";
+const char* const WIFI_DNS = "";
+const unsigned long WIFI_RECONNECT_MIN_MS = 500;
+const unsigned long WIFI_RECONNECT_MAX_MS = 8000;
 
 // Motor Configuration
-const int MOTOR_DIRECTION_CORRECTION[4] = {-1, 1, 1, 1};
+constexpr int MOTOR_DIRECTION_CORRECTION[4] = {-1, 1, 1, 1};
 const int MOTOR_MAX_SPEED = 255;
 const int MOTOR_PWM_FREQUENCY = 1000;
 const int MOTOR_PWM_RESOLUTION = 8;
 const int MOTOR2_STARTUP_DELAY = 50;
 
-// Motor Pin Configuration
-const int MOTOR_PINS[4][2] = {
+// Staged start-up offset per motor (ms after the command), FRONT_RIGHT..BACK_LEFT
+const int MOTOR_STARTUP_OFFSETS[4] = {50, 50, 0, 50};
+
+// Acceleration ramps (ms for a full 0..max_speed change, 0 = instant), STOP, DRIVE, TURN, DIRECT
+const int RAMP_ACCEL_MS[4] = {0, 300, 150, 0};
+const int RAMP_DECEL_MS[4] = {0, 200, 100, 0};
+const int RAMP_TICK_MS = 5;
+
+// Motor Pin Configuration (from motor_pins)
+constexpr int MOTOR_PINS[4][2] = {
     {16, 17},  // FRONT_RIGHT_MOTOR
     {18, 19},   // BACK_RIGHT_MOTOR
     {27, 26},   // FRONT_LEFT_MOTOR
     {25, 33}     // BACK_LEFT_MOTOR
 };
 
+// Battery Voltage Compensation
+constexpr bool BATTERY_ENABLED = false;
+constexpr int BATTERY_ADC_PIN = 39;
+const int BATTERY_DIVIDER_PERMILLE = 3000;
+const int BATTERY_SAMPLE_RATE_HZ = 20000;
+const unsigned long BATTERY_UPDATE_MS = 50;
+const unsigned long BATTERY_FILTER_MS = 500;
+const int BATTERY_NOMINAL_MV = 7400;
+const int BATTERY_MAX_COMPENSATION_PERMILLE = 1300;
+const int BATTERY_LOW_MV = 6600;
+const int BATTERY_LOW_LIMIT_PERCENT = 60;
+const int BATTERY_LOW_HYSTERESIS_MV = 200;
+
+// Wheel Encoder Configuration (channel A, channel B; B = -1 for single-channel encoders)
+constexpr bool ENCODERS_ENABLED = false;
+constexpr int ENCODER_PINS[4][2] = {
+    {34, 35},  // FRONT_RIGHT_MOTOR
+    {36, 13},   // BACK_RIGHT_MOTOR
+    {32, 23},   // FRONT_LEFT_MOTOR
+    {22, 21}     // BACK_LEFT_MOTOR
+};
+const int ENCODER_COUNTS_PER_REV = 40;
+const int SPEED_MAX_RPM = 200;
+const int SPEED_LOOP_HZ = 200;
+const float SPEED_PID_KP = 0.5f;
+const float SPEED_PID_KI = 2.0f;
+const float SPEED_PID_KD = 0.0f;
+const int SPEED_TRIM_LIMIT = 60;
+
+// Tracking Configuration
+const int TRACKING_MIN_DUTY = 90;
+const int TRACKING_MAX_DUTY = 200;
+const int TRACKING_DEAD_BAND = 50;
+const int TRACKING_GAIN_PERCENT = 100;
+const int TRACKER_RATE_HZ = 50;
+const int TRACKER_ENTER_BAND = 100;
+const int TRACKER_EXIT_BAND = 50;
+const int TRACKER_MIN_CONFIDENCE = 40;
+const unsigned long TRACKER_PREDICT_MS = 200;
+const unsigned long TRACKER_LOST_MS = 400;
+
+// Firmware Task Configuration
+const int MOTOR_TASK_CORE = 1;
+const int MOTOR_TASK_PRIORITY = 5;
+const int COMMAND_QUEUE_DEPTH = 16;
+const unsigned long COMMAND_LEASE_MS = 500;
+const int PWM_SKEW_BENCHMARK_ITERATIONS = 0;
+const int LOG_TASK_CORE = 0;
+const int LOG_TASK_PRIORITY = 1;
+const int NETWORK_CORE = 0;
+const int NETWORK_TASK_PRIORITY = 3;
+const int SERVICE_TASK_CORE = 0;
+const int SERVICE_TASK_PRIORITY = 1;
+const unsigned long SERVICE_PERIOD_MS = 10;
+const int RECORDER_ENTRIES = 256;
+#define FIRMWARE_LOG_LEVEL LOG_LEVEL_DEBUG  // see car_log.h
+
+// Control Arbitration (priority per source: ws, control, hand_gesture, person_tracking, udp)
+const int SOURCE_PRIORITIES[5] = {3, 2, 1, 1, 2};
+const unsigned long ARBITER_LEASE_MS = 1000;
+
+// Telemetry Configuration
+const int TELEMETRY_RATE_HZ = 20;
+const int TELEMETRY_BATCH_SAMPLES = 5;
+
+// UDP Fast-Path Configuration
+const int UDP_COMMAND_PORT = 4210;
+const unsigned long UDP_SESSION_TIMEOUT_MS = 1000;
+
+// Timestamped Command Batches
+const unsigned long JITTER_PLAYOUT_DELAY_MS = 60;
+const unsigned long JITTER_WINDOW_MS = 2000;
+const unsigned long JITTER_SESSION_TIMEOUT_MS = 1000;
+
+// Onboard Camera (ESP32-CAM builds)
+#define SMARTCAR_CAMERA 0
+#define CAMERA_MODEL CAMERA_MODEL_AI_THINKER  // see camera_pins.h
+const char* const CAMERA_FRAME_SIZE = "vga";
+const int CAMERA_FPS = 15;
+const int CAMERA_JPEG_QUALITY = 12;
+const int CAMERA_STREAM_PORT = 81;
+const int CAMERA_TASK_CORE = 0;
+const int CAMERA_TASK_PRIORITY = 1;
+
+// Runtime Calibration (POST /calibration bearer token; empty disables the endpoint)
+const char* const CALIBRATION_TOKEN = "";
+
 // System Configuration
 const bool ENABLE_DEBUG_OUTPUT = true;
 
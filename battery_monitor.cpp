@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <atomic>
+
+#include "arduino_config.h"
+#include "battery_monitor.h"
+#include "camera_pins.h"
+#include "car_log.h"
+#include "hal.h"
+#include "motor_control.h"
+#include "motor_ramp.h"
+
+static_assert(!BATTERY_ENABLED || (BATTERY_ADC_PIN >= 32 && BATTERY_ADC_PIN <= 39),
+              "battery.adc_pin must be an ADC1 pin (GPIO 32-39)");
+static_assert(!BATTERY_ENABLED || !pinPairsUse(MOTOR_PINS, 4, BATTERY_ADC_PIN),
+              "battery.adc_pin is also a motor pin");
+static_assert(!(BATTERY_ENABLED && ENCODERS_ENABLED && pinPairsUse(ENCODER_PINS, 4, BATTERY_ADC_PIN)),
+              "battery.adc_pin is also an encoder pin");
+static_assert(!(BATTERY_ENABLED && SMARTCAR_CAMERA), "the camera needs I2S0, which battery sampling uses for DMA");
+
+// Filtered voltage in 1/256 mV; service task only
+#define FILTER_FRACTION_BITS 8
+
+static bool adcRunning = false;
+static uint32_t lastUpdateMillis = 0;
+static bool filterPrimed = false;
+static int32_t filteredVoltage = 0;
+static bool lowLimit = false;
+
+static std::atomic<uint32_t> filteredMillivolts{0};
+static std::atomic<uint32_t> outputScale{RAMP_SCALE_ONE};
+static std::atomic<uint8_t> batteryState{BATTERY_UNKNOWN};
+static std::atomic<uint32_t> readings{0};
+static std::atomic<uint32_t> lowEvents{0};
+
+void startBatteryMonitor()
+{
+  if (!BATTERY_ENABLED)
+  {
+    return;
+  }
+
+  adcRunning = halAdcStart(BATTERY_ADC_PIN, BATTERY_SAMPLE_RATE_HZ);
+  if (!adcRunning)
+  {
+    LOG_ERROR("Battery ADC on pin %d failed to start", BATTERY_ADC_PIN);
+  }
+}
+
+void serviceBattery(uint32_t nowMillis)
+{
+  uint32_t elapsed = nowMillis - lastUpdateMillis;
+  uint32_t pinMillivolts;
+
+  if (!adcRunning || elapsed < BATTERY_UPDATE_MS)
+  {
+    return;
+  }
+  lastUpdateMillis = nowMillis;
+  if (halAdcTakeMillivolts(pinMillivolts))
+  {
+    batteryAddReading((uint64_t)pinMillivolts * BATTERY_DIVIDER_PERMILLE / 1000, elapsed);
+  }
+}
+
+// First-order low-pass: moves elapsed / (time constant + elapsed) of the way
+static uint32_t filterVoltage(uint32_t millivolts, uint32_t elapsedMillis)
+{
+  int32_t sample = (int32_t)millivolts << FILTER_FRACTION_BITS;
+
+  if (!filterPrimed)
+  {
+    filteredVoltage = sample;
+    filterPrimed = true;
+  }
+  else
+  {
+    filteredVoltage += (int32_t)((int64_t)(sample - filteredVoltage) * (int64_t)elapsedMillis /
+                                 (int64_t)(BATTERY_FILTER_MS + elapsedMillis));
+  }
+  return (filteredVoltage + (1 << (FILTER_FRACTION_BITS - 1))) >> FILTER_FRACTION_BITS;
+}
+
+static uint32_t scaleFor(uint32_t millivolts)
+{
+  uint32_t scale = (uint32_t)(((uint64_t)BATTERY_NOMINAL_MV << 16) / millivolts);
+  scale = std::min(scale, (uint32_t)((uint64_t)BATTERY_MAX_COMPENSATION_PERMILLE * RAMP_SCALE_ONE / 1000));
+
+  // Soft limit: no more than the low-battery share of nominal motor voltage
+  if (lowLimit)
+  {
+    scale = scale * BATTERY_LOW_LIMIT_PERCENT / 100;
+  }
+  return scale;
+}
+
+void batteryAddReading(uint32_t packMillivolts, uint32_t elapsedMillis)
+{
+  uint32_t millivolts = filterVoltage(packMillivolts, elapsedMillis);
+  uint8_t state;
+  uint32_t scale = RAMP_SCALE_ONE;
+
+  readings.fetch_add(1, std::memory_order_relaxed);
+  filteredMillivolts.store(millivolts, std::memory_order_relaxed);
+  if (millivolts < BATTERY_PRESENT_MV)
+  {
+    lowLimit = false;
+    state = BATTERY_ABSENT;
+  }
+  else
+  {
+    if (!lowLimit && millivolts < (uint32_t)BATTERY_LOW_MV)
+    {
+      lowLimit = true;
+      lowEvents.fetch_add(1, std::memory_order_relaxed);
+      LOG_WARN("Battery low at %u mV, limiting motors to %d%%", millivolts, BATTERY_LOW_LIMIT_PERCENT);
+    }
+    else if (lowLimit && millivolts > (uint32_t)(BATTERY_LOW_MV + BATTERY_LOW_HYSTERESIS_MV))
+    {
+      lowLimit = false;
+      LOG_INFO("Battery recovered at %u mV", millivolts);
+    }
+    state = lowLimit ? BATTERY_LOW : BATTERY_OK;
+    scale = scaleFor(millivolts);
+  }
+  batteryState.store(state, std::memory_order_relaxed);
+
+  // Smaller moves would not change an 8-bit duty
+  uint32_t applied = outputScale.load(std::memory_order_relaxed);
+  uint32_t change = scale > applied ? scale - applied : applied - scale;
+  if (change > RAMP_SCALE_ONE / 256 || (change > 0 && scale == RAMP_SCALE_ONE))
+  {
+    outputScale.store(scale, std::memory_order_relaxed);
+    requestOutputRescale();
+  }
+}
+
+uint32_t batteryOutputScale()
+{
+  return outputScale.load(std::memory_order_relaxed);
+}
+
+BatteryStats getBatteryStats()
+{
+  BatteryStats stats;
+
+  stats.millivolts = filteredMillivolts.load(std::memory_order_relaxed);
+  stats.scalePermille = (uint32_t)(((uint64_t)outputScale.load(std::memory_order_relaxed) * 1000 +
+                                    RAMP_SCALE_ONE / 2) >> 16);
+  stats.state = batteryState.load(std::memory_order_relaxed);
+  stats.readings = readings.load(std::memory_order_relaxed);
+  stats.lowEvents = lowEvents.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,63 @@
+/*
+ * Battery voltage sensing and motor voltage compensation
+ *
+ * The pack voltage comes in through a divider on BATTERY_ADC_PIN, which
+ * the ADC converts continuously into a DMA ring. Every BATTERY_UPDATE_MS
+ * the service task averages what arrived and feeds it through a
+ * BATTERY_FILTER_MS low-pass, so the motor task never waits on the ADC.
+ *
+ * As the pack drains, the same duty gives less motor voltage and so less
+ * wheel speed. The motor outputs are therefore scaled by
+ * BATTERY_NOMINAL_MV / filtered voltage, at most
+ * BATTERY_MAX_COMPENSATION_PERMILLE and never beyond full PWM, keeping
+ * the effective motor voltage where max_speed and the tracking gains were
+ * tuned. Below BATTERY_LOW_MV a soft limit caps it further at
+ * BATTERY_LOW_LIMIT_PERCENT of nominal, until the pack recovers past
+ * BATTERY_LOW_MV + BATTERY_LOW_HYSTERESIS_MV.
+ *
+ * A reading under BATTERY_PRESENT_MV means no divider is connected; the
+ * outputs are then left unscaled. The motor task is only asked to restage
+ * its channels when the scale moves by more than a duty step at 8 bits.
+ */
+
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <stdint.h>
+
+#define BATTERY_PRESENT_MV 1000
+
+enum BatteryState : uint8_t
+{
+  BATTERY_UNKNOWN,  // disabled, or no reading yet
+  BATTERY_ABSENT,   // reading too low for a connected pack
+  BATTERY_OK,
+  BATTERY_LOW,      // soft limit active
+};
+
+struct BatteryStats
+{
+  uint32_t millivolts;     // filtered pack voltage, 0 until the first reading
+  uint32_t scalePermille;  // applied to the motor outputs
+  uint8_t state;           // BatteryState
+  uint32_t readings;
+  uint32_t lowEvents;      // times the soft limit engaged
+};
+
+// Start the ADC when BATTERY_ENABLED; before the service task runs
+void startBatteryMonitor();
+
+// Service task: take the ADC samples when an update is due
+void serviceBattery(uint32_t nowMillis);
+
+// One averaged pack reading, elapsedMillis after the previous; hands a
+// changed scale to the motor task. serviceBattery() calls it, tests drive
+// it directly.
+void batteryAddReading(uint32_t packMillivolts, uint32_t elapsedMillis);
+
+// Q16 output scale for rampSetOutputScale(); any task
+uint32_t batteryOutputScale();
+
+BatteryStats getBatteryStats();
+
+#endif // BATTERY_MONITOR_H
@@ -0,0 +1 @@
+-DCONFIG_ASYNC_TCP_RUNNING_CORE=0 -DCONFIG_ASYNC_TCP_PRIORITY=3
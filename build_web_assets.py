@@ -0,0 +1,73 @@
+"""
+Web asset builder for Smart Car
+Minifies and gzips web/control_page.html into web_assets.h
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+SOURCE_PATH = os.path.join("web", "control_page.html")
+HEADER_PATH = "web_assets.h"
+
+def minify_html(text: str) -> str:
+    """Drop indentation, blank lines and whole-line // comments; keeps line breaks for inline JS"""
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith("//"):
+            continue
+        lines.append(re.sub(r"\s{2,}", " ", line))
+    return "\n".join(lines)
+
+def build_web_assets() -> bool:
+    """Generate the gzip-compressed control page header"""
+    try:
+        with open(SOURCE_PATH, "r", encoding="utf-8") as f:
+            page = minify_html(f.read()).encode("utf-8")
+    except OSError as e:
+        print(f"❌ Error reading {SOURCE_PATH}: {e}")
+        return False
+
+    # mtime=0 keeps the output, and so the ETag, identical across builds
+    compressed = gzip.compress(page, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(compressed).hexdigest()[:16]
+
+    rows = []
+    for offset in range(0, len(compressed), 16):
+        rows.append("  " + ", ".join(f"0x{byte:02x}" for byte in compressed[offset:offset + 16]) + ",")
+
+    header_content = f'''/*
+ * AUTO-GENERATED WEB ASSETS
+ * Generated from {SOURCE_PATH} by build_web_assets.py
+ * DO NOT EDIT THIS FILE DIRECTLY - Edit {SOURCE_PATH} instead
+ */
+
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <Arduino.h>
+
+// {len(page)} bytes minified, {len(compressed)} bytes gzip-compressed
+#define CONTROL_PAGE_ETAG "\\"{etag}\\""
+const size_t CONTROL_PAGE_GZ_LENGTH = {len(compressed)};
+const uint8_t CONTROL_PAGE_GZ[] PROGMEM = {{
+{chr(10).join(rows)}
+}};
+
+#endif // WEB_ASSETS_H
+'''
+
+    try:
+        with open(HEADER_PATH, "w") as f:
+            f.write(header_content)
+        print(f"✅ Web assets generated: {HEADER_PATH} ({len(compressed)} bytes gzip, ETag {etag})")
+        return True
+    except OSError as e:
+        print(f"❌ Error generating web assets: {e}")
+        return False
+
+if __name__ == "__main__":
+    print("🔧 Building web assets...")
+    build_web_assets()
@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#include "arduino_config.h"
+#include "calibration.h"
+#include "car_log.h"
+#include "command_queue.h"
+#include "hal.h"
+#include "motion_table.h"
+
+#define CALIBRATION_SPACE "calib"
+#define CALIBRATION_KEY "motors"
+
+// LEDC divides the 80 MHz APB clock by a 10.8 fixed-point divider
+#define PWM_SOURCE_CLOCK_HZ 80000000ULL
+#define PWM_MAX_DIVIDER 1024ULL
+#define PWM_MAX_RESOLUTION 16
+#define STARTUP_OFFSET_MAX_MS 1000
+
+static_assert(TRACKING_MAX_DUTY <= MOTOR_MAX_SPEED, "tracking max_duty must not exceed max_speed");
+
+struct CalibrationBlob
+{
+  uint16_t version;
+  uint16_t size;      // of values, so a resized struct is never misread
+  uint32_t checksum;  // FNV-1a of values
+  Calibration values;
+};
+
+// The values in force, written and read by the motor task only
+static Calibration active;
+
+// Copy for the other tasks, as whole words under a sequence lock like the
+// control state in control_arbiter.cpp: odd while being written, and
+// readers retry until they see the same even value on both sides
+#define CALIBRATION_WORDS ((sizeof(Calibration) + 3) / 4)
+static std::atomic<uint32_t> publishedSequence{0};
+static std::atomic<uint32_t> publishedWords[CALIBRATION_WORDS];
+static SpscQueue<Calibration, 1> pendingCalibration;
+static std::atomic<bool> savePending{false};
+
+Calibration defaultCalibration()
+{
+  Calibration calibration = {};
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    calibration.directionCorrection[i] = MOTOR_DIRECTION_CORRECTION[i];
+    calibration.startupOffsets[i] = MOTOR_STARTUP_OFFSETS[i];
+  }
+  calibration.pwmResolution = MOTOR_PWM_RESOLUTION;
+  calibration.maxSpeed = MOTOR_MAX_SPEED;
+  calibration.pwmFrequency = MOTOR_PWM_FREQUENCY;
+  return calibration;
+}
+
+bool sameCalibration(const Calibration &a, const Calibration &b)
+{
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if (a.directionCorrection[i] != b.directionCorrection[i] || a.startupOffsets[i] != b.startupOffsets[i])
+    {
+      return false;
+    }
+  }
+  return a.pwmResolution == b.pwmResolution && a.maxSpeed == b.maxSpeed && a.pwmFrequency == b.pwmFrequency;
+}
+
+const char *validateCalibration(const Calibration &calibration)
+{
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if (calibration.directionCorrection[i] != 1 && calibration.directionCorrection[i] != -1)
+    {
+      return "direction_correction must be 1 or -1";
+    }
+    if (calibration.startupOffsets[i] > STARTUP_OFFSET_MAX_MS)
+    {
+      return "startup_offsets must be 0..1000 ms";
+    }
+  }
+
+  if (calibration.pwmResolution < 1 || calibration.pwmResolution > PWM_MAX_RESOLUTION)
+  {
+    return "pwm_resolution must be 1..16 bits";
+  }
+
+  uint64_t counterHz = (uint64_t)calibration.pwmFrequency << calibration.pwmResolution;
+  if (counterHz > PWM_SOURCE_CLOCK_HZ || counterHz * PWM_MAX_DIVIDER < PWM_SOURCE_CLOCK_HZ)
+  {
+    return "pwm_frequency is out of range for this pwm_resolution";
+  }
+
+  if (calibration.maxSpeed == 0 || calibration.maxSpeed >= (1UL << calibration.pwmResolution))
+  {
+    return "max_speed must be 1..2^pwm_resolution-1";
+  }
+  if (calibration.maxSpeed < TRACKING_MAX_DUTY)
+  {
+    return "max_speed must not be below tracking max_duty";
+  }
+  return nullptr;
+}
+
+// One value per motor, comma-separated
+static bool parseMotorList(const char *value, long *parsed)
+{
+  const char *cursor = value;
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    char *end = nullptr;
+    parsed[i] = strtol(cursor, &end, 10);
+    if (end == cursor || *end != (i < MOTOR_COUNT - 1 ? ',' : '\0'))
+    {
+      return false;
+    }
+    cursor = end + 1;
+  }
+  return true;
+}
+
+static bool parseNumber(const char *value, long minimum, long maximum, long &parsed)
+{
+  char *end = nullptr;
+
+  parsed = strtol(value, &end, 10);
+  return end != value && *end == '\0' && parsed >= minimum && parsed <= maximum;
+}
+
+bool parseCalibrationField(Calibration &calibration, const char *key, const char *value)
+{
+  long parsed[MOTOR_COUNT];
+
+  if (strcmp(key, "direction_correction") == 0 || strcmp(key, "startup_offsets") == 0)
+  {
+    bool direction = key[0] == 'd';
+    if (!parseMotorList(value, parsed))
+    {
+      return false;
+    }
+    for (int i = 0; i < MOTOR_COUNT; i++)
+    {
+      if (parsed[i] < (direction ? INT8_MIN : 0) || parsed[i] > (direction ? INT8_MAX : UINT16_MAX))
+      {
+        return false;
+      }
+      if (direction)
+      {
+        calibration.directionCorrection[i] = (int8_t)parsed[i];
+      }
+      else
+      {
+        calibration.startupOffsets[i] = (uint16_t)parsed[i];
+      }
+    }
+    return true;
+  }
+
+  long number = 0;
+  if (strcmp(key, "max_speed") == 0 && parseNumber(value, 0, UINT16_MAX, number))
+  {
+    calibration.maxSpeed = (uint16_t)number;
+    return true;
+  }
+  if (strcmp(key, "pwm_frequency") == 0 && parseNumber(value, 0, INT32_MAX, number))
+  {
+    calibration.pwmFrequency = (uint32_t)number;
+    return true;
+  }
+  if (strcmp(key, "pwm_resolution") == 0 && parseNumber(value, 0, UINT8_MAX, number))
+  {
+    calibration.pwmResolution = (uint8_t)number;
+    return true;
+  }
+  return false;
+}
+
+size_t formatCalibration(char *buffer, size_t size, const Calibration &calibration)
+{
+  const int8_t *direction = calibration.directionCorrection;
+  const uint16_t *offsets = calibration.startupOffsets;
+  int length = snprintf(buffer, size,
+                        "direction_correction %d,%d,%d,%d\n"
+                        "max_speed %u\n"
+                        "pwm_frequency %lu\n"
+                        "pwm_resolution %u\n"
+                        "startup_offsets %u,%u,%u,%u\n",
+                        direction[0], direction[1], direction[2], direction[3], calibration.maxSpeed,
+                        (unsigned long)calibration.pwmFrequency, calibration.pwmResolution, offsets[0],
+                        offsets[1], offsets[2], offsets[3]);
+
+  return length < 0 ? 0 : std::min((size_t)length, size > 0 ? size - 1 : 0);
+}
+
+static uint32_t checksumOf(const Calibration &values)
+{
+  const uint8_t *bytes = (const uint8_t *)&values;
+  uint32_t hash = 2166136261UL;
+
+  for (size_t i = 0; i < sizeof(values); i++)
+  {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+// Stored values are only trusted if they are intact, current and usable
+static bool readStoredCalibration(Calibration &calibration)
+{
+  CalibrationBlob blob;
+
+  if (halSettingsRead(CALIBRATION_SPACE, CALIBRATION_KEY, &blob, sizeof(blob)) != sizeof(blob))
+  {
+    return false;
+  }
+  if (blob.version != CALIBRATION_BLOB_VERSION || blob.size != sizeof(blob.values))
+  {
+    LOG_WARN("Ignoring calibration blob version %u (size %u)", blob.version, blob.size);
+    return false;
+  }
+  if (blob.checksum != checksumOf(blob.values))
+  {
+    LOG_WARN("Ignoring corrupt calibration blob");
+    return false;
+  }
+
+  const char *problem = validateCalibration(blob.values);
+  if (problem != nullptr)
+  {
+    LOG_WARN("Ignoring stored calibration: %s", problem);
+    return false;
+  }
+  calibration = blob.values;
+  return true;
+}
+
+static void makeActive(const Calibration &calibration)
+{
+  uint32_t words[CALIBRATION_WORDS] = {};
+
+  active = calibration;
+  memcpy(words, &calibration, sizeof(calibration));
+  uint32_t sequence = publishedSequence.load(std::memory_order_relaxed);
+  publishedSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < CALIBRATION_WORDS; i++)
+  {
+    publishedWords[i].store(words[i], std::memory_order_relaxed);
+  }
+  publishedSequence.store(sequence + 2, std::memory_order_release);
+  rebuildMotionTable(calibration);
+}
+
+void loadCalibration()
+{
+  Calibration calibration = defaultCalibration();
+  bool stored = readStoredCalibration(calibration);
+
+  makeActive(calibration);
+  LOG_INFO("Motor calibration: %s", stored ? "stored" : "defaults");
+}
+
+const Calibration &activeCalibration()
+{
+  return active;
+}
+
+Calibration calibrationSnapshot()
+{
+  uint32_t words[CALIBRATION_WORDS];
+  uint32_t sequence;
+
+  do
+  {
+    sequence = publishedSequence.load(std::memory_order_acquire);
+    for (size_t i = 0; i < CALIBRATION_WORDS; i++)
+    {
+      words[i] = publishedWords[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) != 0 || publishedSequence.load(std::memory_order_relaxed) != sequence);
+
+  Calibration calibration;
+  memcpy(&calibration, words, sizeof(calibration));
+  return calibration;
+}
+
+void setActiveCalibration(const Calibration &calibration)
+{
+  makeActive(calibration);
+  savePending.store(true, std::memory_order_release);
+}
+
+bool queueCalibration(const Calibration &calibration)
+{
+  return pendingCalibration.push(calibration);
+}
+
+bool takeQueuedCalibration(Calibration &calibration)
+{
+  return pendingCalibration.pop(calibration);
+}
+
+void serviceCalibration()
+{
+  if (!savePending.exchange(false, std::memory_order_acquire))
+  {
+    return;
+  }
+
+  CalibrationBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = CALIBRATION_BLOB_VERSION;
+  blob.size = sizeof(blob.values);
+  blob.values = calibrationSnapshot();
+  blob.checksum = checksumOf(blob.values);
+
+  if (sameCalibration(blob.values, defaultCalibration()))
+  {
+    halSettingsErase(CALIBRATION_SPACE, CALIBRATION_KEY);
+    LOG_INFO("Calibration back to defaults, stored values erased");
+  }
+  else if (!halSettingsWrite(CALIBRATION_SPACE, CALIBRATION_KEY, &blob, sizeof(blob)))
+  {
+    LOG_ERROR("Could not store the calibration");
+  }
+}
+
+bool calibrationTokenMatches(const char *token)
+{
+  size_t expectedLength = strlen(CALIBRATION_TOKEN);
+  size_t length = token != nullptr ? strlen(token) : 0;
+  uint8_t difference = length != expectedLength;
+
+  if (expectedLength == 0)
+  {
+    return false;
+  }
+
+  // Time depends only on the configured token's length
+  for (size_t i = 0; i < expectedLength; i++)
+  {
+    difference |= CALIBRATION_TOKEN[i] ^ (i < length ? token[i] : 0);
+  }
+  return difference == 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Runtime motor calibration
+ *
+ * Direction correction, PWM frequency and resolution, max speed and the
+ * staged start-up offsets used to be compile-time only. The values from
+ * arduino_config.h are now the defaults: at boot a versioned blob in NVS
+ * replaces them if it is present and intact, and POST /calibration (with
+ * the CALIBRATION_TOKEN bearer token) changes them live.
+ *
+ * The motor task owns the active calibration. A change is queued to it
+ * (submitCalibration() in motor_control.h); it stops the car, rebuilds
+ * the motion table and reconfigures the LEDC timer before the next
+ * command, then hands the values to the service task to be written to
+ * flash.
+ */
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "car_commands.h"
+
+#define CALIBRATION_BLOB_VERSION 1
+
+struct Calibration
+{
+  int8_t directionCorrection[MOTOR_COUNT];  // 1 or -1
+  uint8_t pwmResolution;                    // bits
+  uint16_t maxSpeed;                        // full duty, below 2^pwmResolution
+  uint32_t pwmFrequency;                    // Hz
+  uint16_t startupOffsets[MOTOR_COUNT];     // ms after a staged command
+};
+
+// Compile-time values from arduino_config.h
+Calibration defaultCalibration();
+
+bool sameCalibration(const Calibration &a, const Calibration &b);
+
+// Why the values cannot be used, or nullptr if they can
+const char *validateCalibration(const Calibration &calibration);
+
+// Update one field from a request parameter; direction_correction and
+// startup_offsets take one comma-separated value per motor. False for
+// unknown keys and unparsable values.
+bool parseCalibrationField(Calibration &calibration, const char *key, const char *value);
+
+// "key value" lines, like /stats
+size_t formatCalibration(char *buffer, size_t size, const Calibration &calibration);
+
+// Boot: make the stored blob active, or the defaults when it is missing,
+// from another version or corrupt. Call before setUpPinModes().
+void loadCalibration();
+
+// The values in force, for the motor task (and boot, before it starts)
+// only: the reference is overwritten when the motor task applies new values.
+const Calibration &activeCalibration();
+
+// A consistent copy of the values in force, for any other task
+Calibration calibrationSnapshot();
+
+// Motor task: make new values active, rebuild the motion table and queue
+// them for serviceCalibration(). The caller reconfigures the outputs.
+void setActiveCalibration(const Calibration &calibration);
+
+// Single slot from the AsyncTCP task to the motor task; false while a
+// calibration is still waiting to be applied
+bool queueCalibration(const Calibration &calibration);
+bool takeQueuedCalibration(Calibration &calibration);
+
+// Service task: write applied values to flash. Values equal to the defaults
+// erase the blob instead, so a reflash with new defaults takes effect.
+void serviceCalibration();
+
+// Compare a request's token with CALIBRATION_TOKEN in constant time;
+// always false when no token is configured
+bool calibrationTokenMatches(const char *token);
+
+#endif // CALIBRATION_H
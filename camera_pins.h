@@ -0,0 +1,71 @@
+/*
+ * Camera bus wiring of the supported ESP32 camera boards
+ *
+ * The camera takes most of a board's GPIOs, and the PSRAM holding the
+ * frame buffers takes two more. Camera builds check at compile time that
+ * the motor pins, and the encoder pins if enabled, stay clear of both;
+ * config.yaml's camera.motor_pins lists the pins left on an AI-Thinker
+ * ESP32-CAM.
+ */
+
+#ifndef CAMERA_PINS_H
+#define CAMERA_PINS_H
+
+#include "arduino_config.h"
+
+#define CAMERA_MODEL_AI_THINKER 0
+#define CAMERA_MODEL_WROVER_KIT 1
+#define CAMERA_MODEL_ESP_EYE 2
+
+// -1 where the board does not wire the signal
+struct CameraPins
+{
+  int pwdn;
+  int reset;
+  int xclk;
+  int sda;
+  int scl;
+  int data[8];  // D0..D7 (Y2..Y9)
+  int vsync;
+  int href;
+  int pclk;
+  int psram[2];
+};
+
+constexpr CameraPins CAMERA_BOARDS[] = {
+  {32, -1, 0, 26, 27, {5, 18, 19, 21, 36, 39, 34, 35}, 25, 23, 22, {16, 17}},   // AI-Thinker ESP32-CAM
+  {-1, -1, 21, 26, 27, {4, 5, 18, 19, 36, 39, 34, 35}, 25, 23, 22, {16, 17}},   // ESP-WROVER-KIT
+  {-1, -1, 4, 18, 23, {34, 13, 14, 35, 39, 38, 37, 36}, 5, 27, 25, {-1, -1}},   // ESP-EYE
+};
+
+static constexpr const CameraPins &CAMERA_BUS = CAMERA_BOARDS[CAMERA_MODEL];
+
+constexpr bool pinInList(int pin, const int *pins, int count)
+{
+  return count > 0 && (pins[0] == pin || pinInList(pin, pins + 1, count - 1));
+}
+
+constexpr bool cameraUsesPin(int pin)
+{
+  return pin >= 0 &&
+         (pin == CAMERA_BUS.pwdn || pin == CAMERA_BUS.reset || pin == CAMERA_BUS.xclk || pin == CAMERA_BUS.sda ||
+          pin == CAMERA_BUS.scl || pinInList(pin, CAMERA_BUS.data, 8) || pin == CAMERA_BUS.vsync ||
+          pin == CAMERA_BUS.href || pin == CAMERA_BUS.pclk || pinInList(pin, CAMERA_BUS.psram, 2));
+}
+
+// Any pin of the first count pin pairs on the camera bus
+constexpr bool pinPairsOnCameraBus(const int (*pairs)[2], int count)
+{
+  return count > 0 &&
+         (cameraUsesPin(pairs[0][0]) || cameraUsesPin(pairs[0][1]) || pinPairsOnCameraBus(pairs + 1, count - 1));
+}
+
+constexpr bool pinPairsUse(const int (*pairs)[2], int count, int pin)
+{
+  return count > 0 && (pairs[0][0] == pin || pairs[0][1] == pin || pinPairsUse(pairs + 1, count - 1, pin));
+}
+
+// GPIO 1 and 3 are the UART; Serial must stay off while motors use them
+constexpr bool MOTORS_USE_UART = pinPairsUse(MOTOR_PINS, 4, 1) || pinPairsUse(MOTOR_PINS, 4, 3);
+
+#endif // CAMERA_PINS_H
@@ -0,0 +1,315 @@
+#include "arduino_config.h"
+
+#if SMARTCAR_CAMERA
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <esp_camera.h>
+#include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "camera_pins.h"
+#include "camera_stream.h"
+#include "car_log.h"
+#include "hal.h"
+
+static_assert(!pinPairsOnCameraBus(MOTOR_PINS, 4), "camera.motor_pins collide with the camera bus or its PSRAM");
+static_assert(!ENCODERS_ENABLED || !pinPairsOnCameraBus(ENCODER_PINS, 4),
+              "wheel encoder pins collide with the camera bus or its PSRAM");
+
+#define STREAM_BOUNDARY "smartcarframe"
+#define STREAM_FRAME_TIMEOUT_MS 2000  // end the stream if the camera stops delivering
+#define CAMERA_FRAME_BUFFERS 3        // one being sent, one waiting, one being filled
+#define CAMERA_MAX_FPS 60
+
+struct FrameSizeName
+{
+  const char *name;
+  framesize_t size;
+};
+
+// Ascending, so a larger index is a larger frame
+static const FrameSizeName frameSizes[] = {
+  {"qqvga", FRAMESIZE_QQVGA}, {"qvga", FRAMESIZE_QVGA}, {"cif", FRAMESIZE_CIF},
+  {"vga", FRAMESIZE_VGA},     {"svga", FRAMESIZE_SVGA}, {"xga", FRAMESIZE_XGA},
+  {"hd", FRAMESIZE_HD},       {"sxga", FRAMESIZE_SXGA}, {"uxga", FRAMESIZE_UXGA},
+};
+static const int frameSizeCount = sizeof(frameSizes) / sizeof(frameSizes[0]);
+
+// Newest captured frame; whoever takes it out owns the buffer until
+// esp_camera_fb_return
+static QueueHandle_t latestFrame = nullptr;
+static httpd_handle_t streamServer = nullptr;
+
+// Largest frame size the buffers were allocated for
+static int maxSizeIndex = 0;
+
+// Written by setCameraMode, applied by the capture task between frames
+static std::atomic<int> requestedSizeIndex{0};
+static std::atomic<int> requestedFps{CAMERA_FPS};
+static std::atomic<int> activeSizeIndex{0};
+
+static std::atomic<bool> streaming{false};
+static std::atomic<uint32_t> framesCaptured{0};
+static std::atomic<uint32_t> framesSent{0};
+static std::atomic<uint32_t> framesDropped{0};
+static std::atomic<uint32_t> captureFailures{0};
+static std::atomic<uint32_t> lastFrameBytes{0};
+
+static int frameSizeIndex(const char *name)
+{
+  for (int i = 0; i < frameSizeCount; i++)
+  {
+    if (strcmp(frameSizes[i].name, name) == 0)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void returnWaitingFrame()
+{
+  camera_fb_t *stale;
+
+  if (xQueueReceive(latestFrame, &stale, 0) == pdTRUE)
+  {
+    esp_camera_fb_return(stale);
+    framesDropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static void applyRequestedSize()
+{
+  int index = requestedSizeIndex.load(std::memory_order_relaxed);
+
+  if (index != activeSizeIndex.load(std::memory_order_relaxed))
+  {
+    sensor_t *sensor = esp_camera_sensor_get();
+    if (sensor != nullptr && sensor->set_framesize(sensor, frameSizes[index].size) == 0)
+    {
+      LOG_INFO("Camera frame size %s", frameSizes[index].name);
+    }
+    activeSizeIndex.store(index, std::memory_order_relaxed);
+  }
+}
+
+// Capture stage: paced to the requested rate, idle while nobody watches
+static void captureTask(void *parameter)
+{
+  TickType_t wake = xTaskGetTickCount();
+
+  for (;;)
+  {
+    applyRequestedSize();
+    if (!streaming.load(std::memory_order_relaxed))
+    {
+      returnWaitingFrame();
+      halSleepMillis(100);
+      wake = xTaskGetTickCount();
+      continue;
+    }
+
+    camera_fb_t *frame = esp_camera_fb_get();
+    if (frame == nullptr)
+    {
+      captureFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      returnWaitingFrame();
+      xQueueSend(latestFrame, &frame, 0);
+      framesCaptured.fetch_add(1, std::memory_order_relaxed);
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / requestedFps.load(std::memory_order_relaxed)));
+  }
+}
+
+// Stream stage: runs on the stream server's task for as long as the
+// client stays connected
+static esp_err_t handleStream(httpd_req_t *request)
+{
+  bool idle = false;
+  if (!streaming.compare_exchange_strong(idle, true))
+  {
+    httpd_resp_set_status(request, "503 Service Unavailable");
+    return httpd_resp_send(request, "Another client is streaming", HTTPD_RESP_USE_STRLEN);
+  }
+
+  httpd_resp_set_type(request, "multipart/x-mixed-replace;boundary=" STREAM_BOUNDARY);
+  httpd_resp_set_hdr(request, "Access-Control-Allow-Origin", "*");
+  LOG_INFO("Camera stream started");
+
+  esp_err_t result = ESP_OK;
+  char partHeader[96];
+  while (result == ESP_OK)
+  {
+    camera_fb_t *frame;
+    if (xQueueReceive(latestFrame, &frame, pdMS_TO_TICKS(STREAM_FRAME_TIMEOUT_MS)) != pdTRUE)
+    {
+      result = ESP_ERR_TIMEOUT;
+      break;
+    }
+
+    int length = snprintf(partHeader, sizeof(partHeader),
+                          "\r\n--" STREAM_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+                          (unsigned)frame->len);
+    result = httpd_resp_send_chunk(request, partHeader, length);
+    if (result == ESP_OK)
+    {
+      // Straight from the driver's buffer into the TCP stack
+      result = httpd_resp_send_chunk(request, (const char *)frame->buf, frame->len);
+    }
+    lastFrameBytes.store(frame->len, std::memory_order_relaxed);
+    esp_camera_fb_return(frame);
+    if (result == ESP_OK)
+    {
+      framesSent.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  streaming.store(false, std::memory_order_relaxed);
+  LOG_INFO("Camera stream ended (%d)", (int)result);
+  return result;
+}
+
+static bool startStreamServer()
+{
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = CAMERA_STREAM_PORT;
+  config.core_id = CAMERA_TASK_CORE;
+  config.task_priority = CAMERA_TASK_PRIORITY;
+  config.max_open_sockets = 2;  // the stream and a client being turned away
+
+  httpd_uri_t stream = {};
+  stream.uri = "/stream";
+  stream.method = HTTP_GET;
+  stream.handler = handleStream;
+
+  if (httpd_start(&streamServer, &config) != ESP_OK)
+  {
+    return false;
+  }
+  httpd_register_uri_handler(streamServer, &stream);
+  return true;
+}
+
+bool startCamera()
+{
+  int configuredIndex = frameSizeIndex(CAMERA_FRAME_SIZE);
+  if (configuredIndex < 0)
+  {
+    LOG_WARN("Unknown camera frame size %s, using vga", CAMERA_FRAME_SIZE);
+    configuredIndex = frameSizeIndex("vga");
+  }
+
+  // XCLK comes from the low-speed LEDC group; the motors own the high-speed one
+  camera_config_t config = {};
+  config.pin_pwdn = CAMERA_BUS.pwdn;
+  config.pin_reset = CAMERA_BUS.reset;
+  config.pin_xclk = CAMERA_BUS.xclk;
+  config.pin_sccb_sda = CAMERA_BUS.sda;
+  config.pin_sccb_scl = CAMERA_BUS.scl;
+  config.pin_d0 = CAMERA_BUS.data[0];
+  config.pin_d1 = CAMERA_BUS.data[1];
+  config.pin_d2 = CAMERA_BUS.data[2];
+  config.pin_d3 = CAMERA_BUS.data[3];
+  config.pin_d4 = CAMERA_BUS.data[4];
+  config.pin_d5 = CAMERA_BUS.data[5];
+  config.pin_d6 = CAMERA_BUS.data[6];
+  config.pin_d7 = CAMERA_BUS.data[7];
+  config.pin_vsync = CAMERA_BUS.vsync;
+  config.pin_href = CAMERA_BUS.href;
+  config.pin_pclk = CAMERA_BUS.pclk;
+  config.xclk_freq_hz = 20000000;
+  config.ledc_timer = LEDC_TIMER_1;
+  config.ledc_channel = LEDC_CHANNEL_0;
+  config.pixel_format = PIXFORMAT_JPEG;
+  config.jpeg_quality = CAMERA_JPEG_QUALITY;
+  config.grab_mode = CAMERA_GRAB_LATEST;
+  if (psramFound())
+  {
+    maxSizeIndex = frameSizeCount - 1;
+    config.fb_location = CAMERA_FB_IN_PSRAM;
+    config.fb_count = CAMERA_FRAME_BUFFERS;
+  }
+  else
+  {
+    maxSizeIndex = configuredIndex;
+    config.fb_location = CAMERA_FB_IN_DRAM;
+    config.fb_count = 2;
+  }
+  config.frame_size = frameSizes[maxSizeIndex].size;
+
+  esp_err_t result = esp_camera_init(&config);
+  if (result != ESP_OK)
+  {
+    LOG_ERROR("Camera init failed (0x%x)", (unsigned)result);
+    return false;
+  }
+
+  activeSizeIndex.store(maxSizeIndex, std::memory_order_relaxed);
+  requestedSizeIndex.store(configuredIndex, std::memory_order_relaxed);
+  latestFrame = xQueueCreate(1, sizeof(camera_fb_t *));
+  halStartTask(captureTask, "camera", 4096, CAMERA_TASK_PRIORITY, CAMERA_TASK_CORE, nullptr);
+  if (!startStreamServer())
+  {
+    LOG_ERROR("Camera stream server failed to start");
+    return false;
+  }
+
+  if (CAMERA_TASK_CORE == MOTOR_TASK_CORE)
+  {
+    LOG_WARN("Camera shares core %d with the motor task", CAMERA_TASK_CORE);
+  }
+  LOG_INFO("Camera streaming on port %d, %s at up to %d fps", CAMERA_STREAM_PORT, frameSizes[configuredIndex].name,
+           CAMERA_FPS);
+  return true;
+}
+
+bool setCameraMode(const char *frameSize, int fps)
+{
+  int index = frameSize != nullptr ? frameSizeIndex(frameSize) : requestedSizeIndex.load(std::memory_order_relaxed);
+
+  if (index < 0 || index > maxSizeIndex || fps < 0 || fps > CAMERA_MAX_FPS)
+  {
+    return false;
+  }
+  requestedSizeIndex.store(index, std::memory_order_relaxed);
+  if (fps > 0)
+  {
+    requestedFps.store(fps, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+CameraStats getCameraStats()
+{
+  CameraStats stats;
+
+  stats.captured = framesCaptured.load(std::memory_order_relaxed);
+  stats.sent = framesSent.load(std::memory_order_relaxed);
+  stats.dropped = framesDropped.load(std::memory_order_relaxed);
+  stats.captureFailures = captureFailures.load(std::memory_order_relaxed);
+  stats.lastFrameBytes = lastFrameBytes.load(std::memory_order_relaxed);
+  stats.streaming = streaming.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void formatCameraStatus(char *buffer, size_t size)
+{
+  CameraStats stats = getCameraStats();
+
+  snprintf(buffer, size,
+           "camera_frame_size %s\ncamera_max_frame_size %s\ncamera_fps %d\ncamera_stream_port %d\n"
+           "camera_streaming %u\ncamera_frames_captured %u\ncamera_frames_sent %u\ncamera_frames_dropped %u\n"
+           "camera_capture_failures %u\ncamera_last_frame_bytes %u\n",
+           frameSizes[requestedSizeIndex.load(std::memory_order_relaxed)].name, frameSizes[maxSizeIndex].name,
+           requestedFps.load(std::memory_order_relaxed), CAMERA_STREAM_PORT, stats.streaming, stats.captured,
+           stats.sent, stats.dropped, stats.captureFailures, stats.lastFrameBytes);
+}
+
+#endif // SMARTCAR_CAMERA
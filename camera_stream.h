@@ -0,0 +1,49 @@
+/*
+ * Onboard camera stream for ESP32-CAM builds (camera.enabled)
+ *
+ * Two stages, both on CAMERA_TASK_CORE below the network task, so the
+ * camera never competes with the motor task. The capture task takes
+ * JPEG frames from the driver at the configured rate and parks the
+ * newest in a one-slot hand-off, returning any frame the stream did not
+ * get to. The stream server on CAMERA_STREAM_PORT sends each frame as a
+ * part of a multipart/x-mixed-replace response straight out of the
+ * driver's frame buffer and then gives the buffer back; nothing copies
+ * frames on the way. One client streams at a time.
+ *
+ * The frame buffers live in PSRAM and are sized for the largest frame
+ * size, so the size and rate can change while streaming. Without PSRAM
+ * the configured size is the largest.
+ */
+
+#ifndef CAMERA_STREAM_H
+#define CAMERA_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct CameraStats
+{
+  uint32_t captured;
+  uint32_t sent;
+  uint32_t dropped;         // replaced by a newer frame before the stream took it
+  uint32_t captureFailures;
+  uint32_t lastFrameBytes;
+  bool streaming;
+};
+
+// Bring up the camera, the capture task and the stream server; false if
+// the camera does not answer
+bool startCamera();
+
+// Change the frame size ("vga", ..., see config.yaml) and rate, taking
+// effect between frames. Null or 0 keeps the current value; false if the
+// size is unknown or too big for the frame buffers, or the rate is not
+// 1..60 fps.
+bool setCameraMode(const char *frameSize, int fps);
+
+CameraStats getCameraStats();
+
+// Plain-text status for GET /camera
+void formatCameraStatus(char *buffer, size_t size);
+
+#endif // CAMERA_STREAM_H
@@ -0,0 +1,45 @@
+/*
+ * Command and motor identifiers shared by the firmware modules.
+ */
+
+#ifndef CAR_COMMANDS_H
+#define CAR_COMMANDS_H
+
+#define UP 1
+#define DOWN 2
+#define LEFT 3
+#define RIGHT 4
+#define UP_LEFT 5
+#define UP_RIGHT 6
+#define DOWN_LEFT 7
+#define DOWN_RIGHT 8
+#define TURN_LEFT 9
+#define TURN_RIGHT 10
+#define STOP 0
+
+// Hand gesture commands
+#define HAND_LEFT_RAISED 11
+#define HAND_RIGHT_RAISED 12
+#define HAND_BOTH_RAISED 13
+#define HAND_NONE_RAISED 14
+
+// Add new movement commands for tracking
+#define TRACK_LEFT 15
+#define TRACK_RIGHT 16
+#define TRACK_CENTER 17
+
+// Highest valid command id
+#define LAST_COMMAND TRACK_CENTER
+
+#define FRONT_RIGHT_MOTOR 0
+#define BACK_RIGHT_MOTOR 1
+#define FRONT_LEFT_MOTOR 2
+#define BACK_LEFT_MOTOR 3
+
+#define MOTOR_COUNT 4
+#define MOTOR_CHANNEL_COUNT (MOTOR_COUNT * 2)
+
+#define FORWARD 1
+#define BACKWARD -1
+
+#endif // CAR_COMMANDS_H
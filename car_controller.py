@@ -6,13 +6,266 @@ Simple Smart Car Controller with Hand Gesture Control
 """
 
 import requests
+import select
+import struct
 import time
 import logging
 from config_loader import config
 
+try:
+    import websocket  # websocket-client, only needed for the "stream" transport
+except ImportError:
+    websocket = None
+
 logger = logging.getLogger(__name__)
 
+class ControlStream:
+    """
+    Persistent binary WebSocket link to the car's /control endpoint.
+
+    Every frame is acknowledged by the firmware, so each command also
+    yields a round-trip latency sample. With wait_for_ack=False frames are
+    sent fire-and-forget: the firmware's command lease stops the car if the
+    stream goes quiet, and acks are collected opportunistically for RTT.
+    """
+
+    OP_COMMAND = 0x01
+    OP_MOTOR_DUTY = 0x02
+    OP_TURN = 0x03
+    OP_GESTURE = 0x04
+    OP_TRACK_ERROR = 0x05
+    OP_PING = 0x06
+    OP_SUBSCRIBE = 0x07
+    OP_SCRIPT = 0x08
+    OP_OBSERVE = 0x09
+    OP_BATCH = 0x0A
+    OP_VELOCITY = 0x0B
+    OP_ACK = 0x80
+    OP_TELEMETRY = 0x82
+    OP_SCRIPT_STATE = 0x83
+
+    # TelemetrySample in telemetry.h
+    TELEMETRY_SAMPLE = struct.Struct("<IBB8HbIHBBHIHHB")
+    TELEMETRY_FIELDS = ("millis", "command", "owner", "channel_duty", "rssi", "free_heap",
+                        "loop_hz", "queue_depth", "queue_high_watermark", "queue_overflows",
+                        "command_latency_us", "battery_mv", "output_scale_permille", "battery_state")
+    BATTERY_STATES = ("unknown", "absent", "ok", "low")
+
+    ACK_OK = 0
+    SCRIPT_STATES = ("idle", "running", "done", "aborted", "rejected")
+    GESTURES = {"none": 0, "left": 1, "right": 2, "both": 3}
+
+    def __init__(self, car_ip: str, car_port: int, timeout: float, wait_for_ack: bool = True):
+        self.url = f"ws://{car_ip}:{car_port}/control"
+        self.timeout = timeout
+        self.wait_for_ack = wait_for_ack
+        self.ws = None
+        self.sequence = 0
+        self.pending = {}  # sequence -> send time, fire-and-forget mode only
+        self.telemetry = []  # decoded samples, newest last, once subscribed
+        self.script_progress = None  # latest motion script state pushed by the car
+        self.max_telemetry = 1000
+        self.rtt_samples = []
+        self.max_samples = 200
+
+    def connect(self) -> bool:
+        """Open the stream; returns False if websocket-client is missing or the car is unreachable"""
+        if websocket is None:
+            logger.error("websocket-client is not installed; cannot use the stream transport")
+            return False
+        try:
+            self.ws = websocket.create_connection(self.url, timeout=self.timeout)
+            logger.info(f"Control stream connected to {self.url}")
+            return True
+        except (OSError, websocket.WebSocketException) as e:
+            logger.error(f"Failed to open control stream: {e}")
+            self.ws = None
+            return False
+
+    def close(self) -> None:
+        if self.ws is not None:
+            self.ws.close()
+            self.ws = None
+        self.pending.clear()
+
+    def _drain_acks(self) -> None:
+        """Consume whatever acks have already arrived without blocking"""
+        while self.pending and select.select([self.ws.sock], [], [], 0)[0]:
+            ack = self.ws.recv()
+            if len(ack) < 5 or ack[0] != self.OP_ACK:
+                self._handle_push(ack)
+                continue
+            ack_sequence, status = struct.unpack_from("<HB", ack, 1)
+            sent_at = self.pending.pop(ack_sequence, None)
+            if sent_at is not None:
+                self._record_rtt((time.perf_counter() - sent_at) * 1000.0)
+            if status != self.ACK_OK:
+                logger.error(f"Car rejected frame {ack_sequence} with status {status}")
+
+        # Acks for frames the car dropped never arrive; don't let them pile up
+        if len(self.pending) > self.max_samples:
+            self.pending.clear()
+
+    def _send(self, opcode: int, payload: bytes = b"") -> bool:
+        if self.ws is None and not self.connect():
+            return False
+
+        self.sequence = (self.sequence + 1) & 0xFFFF
+        frame = struct.pack("<BH", opcode, self.sequence) + payload
+        try:
+            start = time.perf_counter()
+            self.ws.send_binary(frame)
+
+            if not self.wait_for_ack:
+                self.pending[self.sequence] = start
+                self._drain_acks()
+                return True
+
+            # Acks arrive in order; skip any left over from a timed-out frame
+            while True:
+                ack = self.ws.recv()
+                self._handle_push(ack)
+                if len(ack) >= 5 and ack[0] == self.OP_ACK:
+                    ack_sequence, status = struct.unpack_from("<HB", ack, 1)
+                    if ack_sequence == self.sequence:
+                        break
+
+            self._record_rtt((time.perf_counter() - start) * 1000.0)
+            if status != self.ACK_OK:
+                logger.error(f"Car rejected frame {self.sequence} with status {status}")
+            return status == self.ACK_OK
+        except (OSError, websocket.WebSocketException) as e:
+            logger.error(f"Control stream error: {e}")
+            self.close()
+            return False
+
+    def _handle_push(self, frame) -> None:
+        """Keep telemetry frames that arrive between acks"""
+        if isinstance(frame, bytes) and len(frame) >= 5 and frame[0] == self.OP_TELEMETRY:
+            self.telemetry.extend(self.parse_telemetry(frame))
+            del self.telemetry[:-self.max_telemetry]
+        elif isinstance(frame, bytes) and len(frame) >= 6 and frame[0] == self.OP_SCRIPT_STATE:
+            script_id, segment, count, state = struct.unpack_from("<HBBB", frame, 1)
+            self.script_progress = {
+                'script': script_id,
+                'segment': segment,
+                'segments': count,
+                'state': self.SCRIPT_STATES[state] if state < len(self.SCRIPT_STATES) else "unknown"
+            }
+
+    @classmethod
+    def parse_telemetry(cls, frame: bytes) -> list:
+        """Decode a [0x82][seq u16][count u8][sample size u8][samples] frame"""
+        count, size = frame[3], frame[4]
+        samples = []
+        for index in range(count):
+            offset = 5 + index * size
+            values = cls.TELEMETRY_SAMPLE.unpack_from(frame, offset)
+            sample = dict(zip(cls.TELEMETRY_FIELDS[:3], values[:3]))
+            sample["channel_duty"] = list(values[3:11])
+            sample.update(zip(cls.TELEMETRY_FIELDS[4:], values[11:]))
+            state = sample["battery_state"]
+            sample["battery_state"] = cls.BATTERY_STATES[state] if state < len(cls.BATTERY_STATES) else "unknown"
+            samples.append(sample)
+        return samples
+
+    def subscribe_telemetry(self, enable: bool = True) -> bool:
+        return self._send(self.OP_SUBSCRIBE, bytes([1 if enable else 0]))
+
+    def _record_rtt(self, rtt_ms: float) -> None:
+        self.rtt_samples.append(rtt_ms)
+        if len(self.rtt_samples) > self.max_samples:
+            self.rtt_samples.pop(0)
+
+    def send_gesture(self, gesture: str) -> bool:
+        return self._send(self.OP_GESTURE, bytes([self.GESTURES.get(gesture, 0)]))
+
+    def send_tracking_error(self, error: int) -> bool:
+        return self._send(self.OP_TRACK_ERROR, struct.pack("<h", max(-1000, min(1000, int(error)))))
+
+    def ping(self) -> bool:
+        return self._send(self.OP_PING)
+
+    def send_observation(self, x: int, width: int, confidence: int, frame_ms: int) -> bool:
+        """Raw target observation for the car's own tracking controller"""
+        return self._send(self.OP_OBSERVE, struct.pack("<hHBI", max(-1000, min(1000, int(x))),
+                                                       max(0, min(1000, int(width))),
+                                                       max(0, min(100, int(confidence))),
+                                                       int(frame_ms) & 0xFFFFFFFF))
+
+    def _motion_body(self, kind: str, value) -> bytes:
+        """Opcode and payload of one script segment or batch item"""
+        if kind == "command":
+            return struct.pack("<BB", self.OP_COMMAND, int(value))
+        if kind == "gesture":
+            return struct.pack("<BB", self.OP_GESTURE, self.GESTURES.get(value, 0))
+        if kind == "turn":
+            return struct.pack("<Bh", self.OP_TURN, int(value))
+        if kind == "track_error":
+            return struct.pack("<Bh", self.OP_TRACK_ERROR, max(-1000, min(1000, int(value))))
+        if kind == "duty":
+            return struct.pack("<B4h", self.OP_MOTOR_DUTY, *[int(duty) for duty in value])
+        if kind == "velocity":
+            return struct.pack("<B3h", self.OP_VELOCITY, *[max(-1000, min(1000, int(part))) for part in value])
+        raise ValueError(f"unknown motion kind: {kind}")
+
+    def run_script(self, segments: list) -> bool:
+        """
+        Upload a motion script the car runs on its own timer.
+
+        Each segment is (duration_ms, kind, value): kind "command" takes a
+        command id from car_commands.h, "gesture" a GESTURES name, "turn" and "track_error" an int, "duty" four signed
+        motor duties (front right, back right, front left, back left), "velocity" (vx, vy, omega) as in
+        send_velocity.
+        Progress arrives in script_progress; the script id is the frame's
+        sequence number.
+        """
+        payload = b""
+        for duration_ms, kind, value in segments:
+            payload += struct.pack("<H", max(0, min(0xFFFF, int(duration_ms)))) + self._motion_body(kind, value)
+        return self._send(self.OP_SCRIPT, payload)
+
+    def send_velocity(self, vx: int, vy: int, omega: int) -> bool:
+        """
+        Drive in any direction at once: forward, right and clockwise turn,
+        each -1000..1000 of full speed. The car mixes them into the four
+        mecanum wheels, scaling all four down together when one saturates.
+        """
+        return self._send(self.OP_VELOCITY, self._motion_body("velocity", (vx, vy, omega))[1:])
+
+    def send_batch(self, items: list) -> bool:
+        """
+        Send up to BATCH_MAX_COMMANDS (8) timestamped commands in one frame.
+
+        Each item is (timestamp_ms, kind, value) with kinds as in
+        run_script and timestamp_ms on one steady host clock, e.g. when the
+        command was decided. The car's jitter buffer applies them at that
+        spacing, a fixed playout delay after the fastest recent delivery.
+        """
+        payload = b"".join(struct.pack("<I", int(timestamp_ms) & 0xFFFFFFFF) + self._motion_body(kind, value)
+                           for timestamp_ms, kind, value in items)
+        return self._send(self.OP_BATCH, payload)
+
+    def latency_summary(self) -> dict:
+        """Round-trip latency over the recent samples, in milliseconds"""
+        if not self.rtt_samples:
+            return {}
+        ordered = sorted(self.rtt_samples)
+        return {
+            'samples': len(ordered),
+            'p50_ms': ordered[len(ordered) // 2],
+            'p95_ms': ordered[min(len(ordered) - 1, int(len(ordered) * 0.95))],
+            'max_ms': ordered[-1]
+        }
+
 class SmartCarController:
+    # GET /recorder: [version u8][entry size u8][count u16][recorded u32], then entries
+    RECORDER_HEADER = struct.Struct("<BBHI")
+    RECORDER_ENTRY = struct.Struct("<IBBBBHII4h")
+    RECORDER_KINDS = ("applied", "repeated", "rejected", "observation", "lease_expired", "disconnect_stop",
+                      "stop_requested")
+    SOURCE_NAMES = ("ws", "control", "hand_gesture", "person_tracking", "udp")
+
     def __init__(self, car_ip: str = None, car_port: int = None):
         """
         Initialize the smart car controller
@@ -30,11 +283,20 @@ class SmartCarController:
         self.base_url = f"http://{self.car_ip}:{self.car_port}"
         self.last_gesture = None
         self.last_command_time = time.time()
+        self.last_send_time = 0.0
+        # Resend an unchanged gesture this often so the firmware's command lease never lapses
+        self.lease_renew_interval = controller_config['lease_renew_interval']
         self.min_command_interval = controller_config['min_command_interval']
         self.connection_timeout = controller_config['connection_timeout']
         self.request_timeout = controller_config['request_timeout']
         self.command_in_progress = False
         self.was_moving = False  # Track if the car was moving
+
+        # Optional persistent binary stream instead of one HTTP POST per gesture
+        self.stream = None
+        if controller_config['transport'] == 'stream':
+            self.stream = ControlStream(self.car_ip, self.car_port, self.request_timeout,
+                                        wait_for_ack=controller_config['stream_wait_for_ack'])
         
     def send_hand_gesture(self, gesture: str, force: bool = False) -> bool:
         """
@@ -50,21 +312,35 @@ class SmartCarController:
         if not force:
             time_since_last = current_time - self.last_command_time
             if time_since_last < self.min_command_interval:
-                # If the gesture is the same as last time, just return success
+                # If the gesture is the same as last time, just renew the lease when due
                 if gesture == self.last_gesture:
-                    return True
+                    if current_time - self.last_send_time < self.lease_renew_interval:
+                        return True
+                    return self._renew_lease(gesture, current_time)
                 # If it's a new gesture but cooldown isn't finished, ignore it
                 logger.info(f"Command cooldown: {self.min_command_interval - time_since_last:.1f}s remaining")
                 return False
             
-        # Don't send the same command twice unless forced
+        # Don't send the same command twice unless forced or the lease needs renewing
         if gesture == self.last_gesture and not force:
-            return True
+            if current_time - self.last_send_time < self.lease_renew_interval:
+                return True
+            return self._renew_lease(gesture, current_time)
             
         try:
             # Set command in progress flag
             self.command_in_progress = True
             
+            if self.stream is not None:
+                sent = self.stream.send_gesture(gesture)
+                if sent:
+                    logger.info(f"Successfully streamed gesture command: {gesture} (rtt {self.stream.latency_summary()})")
+                    self.last_gesture = gesture
+                    self.last_send_time = current_time
+                    if not force:
+                        self.last_command_time = current_time
+                return sent
+
             url = f"{self.base_url}/hand-gesture"
             data = {"gesture": gesture}
             
@@ -73,6 +349,7 @@ class SmartCarController:
             if response.status_code == 200:
                 logger.info(f"Successfully sent gesture command: {gesture}")
                 self.last_gesture = gesture
+                self.last_send_time = current_time
                 # Only update command time for non-forced commands
                 if not force:
                     self.last_command_time = current_time
@@ -88,6 +365,25 @@ class SmartCarController:
             # Clear command in progress flag
             self.command_in_progress = False
     
+    def _renew_lease(self, gesture: str, current_time: float) -> bool:
+        """Resend the active gesture without touching the cooldown"""
+        if self.lease_renew_interval <= 0:
+            return True
+        try:
+            if self.stream is not None:
+                sent = self.stream.send_gesture(gesture)
+            else:
+                response = requests.post(f"{self.base_url}/hand-gesture", data={"gesture": gesture},
+                                         timeout=self.request_timeout)
+                sent = response.status_code == 200
+        except requests.exceptions.RequestException as e:
+            logger.error(f"Error renewing command lease: {e}")
+            return False
+
+        if sent:
+            self.last_send_time = current_time
+        return sent
+
     def handle_gesture(self, has_raised_hand: bool = False, hand_side: str = None) -> bool:
         """Process hand detection results and send appropriate commands to the car"""
         # Don't process new gestures if a command is in progress
@@ -118,8 +414,70 @@ class SmartCarController:
             self.was_moving = False
             return self.send_hand_gesture("both")
     
+    def send_tracking_error(self, error: int) -> bool:
+        """
+        Send a proportional tracking correction to the smart car
+
+        Args:
+            error: Target offset from the frame centre, -1000 (far left) .. 1000 (far right)
+        """
+        if self.stream is not None:
+            return self.stream.send_tracking_error(error)
+
+        try:
+            url = f"{self.base_url}/person-tracking"
+            data = {"error": max(-1000, min(1000, int(error)))}
+
+            response = requests.post(url, data=data, timeout=self.request_timeout)
+
+            if response.status_code == 200:
+                return True
+            else:
+                logger.error(f"Failed to send tracking error. Status code: {response.status_code}")
+                return False
+
+        except requests.exceptions.RequestException as e:
+            logger.error(f"Error sending tracking error: {e}")
+            return False
+
+    def send_target_observation(self, bbox, frame_width: int, confidence: float) -> bool:
+        """
+        Stream one camera frame's view of the tracked person; the car turns
+        towards it on its own and stops when observations stop arriving
+
+        Args:
+            bbox: (x1, y1, x2, y2) in pixels, or None when nobody was detected
+            frame_width: Frame width in pixels
+            confidence: Detection confidence, 0..1
+        """
+        if bbox is None:
+            x, width, confidence = 0, 0, 0.0
+        else:
+            x1, _, x2, _ = bbox
+            x = ((x1 + x2) / 2.0 / frame_width - 0.5) * 2000
+            width = (x2 - x1) * 1000 / frame_width
+        frame_ms = int(time.monotonic() * 1000)
+
+        if self.stream is not None:
+            return self.stream.send_observation(x, width, confidence * 100, frame_ms)
+
+        try:
+            data = {"x": int(x), "width": int(width), "confidence": int(confidence * 100), "frame_ms": frame_ms}
+            response = requests.post(f"{self.base_url}/person-tracking", data=data, timeout=self.request_timeout)
+            return response.status_code == 200
+        except requests.exceptions.RequestException as e:
+            logger.error(f"Error sending target observation: {e}")
+            return False
+
     def test_connection(self) -> bool:
         """Test connection to the smart car"""
+        if self.stream is not None:
+            if self.stream.connect() and self.stream.ping():
+                logger.info(f"Successfully connected to smart car stream at {self.stream.url} "
+                            f"(rtt {self.stream.latency_summary()['p50_ms']:.1f} ms)")
+                return True
+            return False
+
         try:
             response = requests.get(self.base_url, timeout=self.connection_timeout)
             if response.status_code == 200:
@@ -132,6 +490,37 @@ class SmartCarController:
             logger.error(f"Failed to connect to smart car: {e}")
             return False
     
+    @classmethod
+    def parse_flight_recorder(cls, data: bytes) -> list:
+        """Decode a /recorder dump into entries, oldest first"""
+        _, entry_size, count, _ = cls.RECORDER_HEADER.unpack_from(data, 0)
+        entries = []
+        for index in range(count):
+            values = cls.RECORDER_ENTRY.unpack_from(data, cls.RECORDER_HEADER.size + index * entry_size)
+            number, kind, source, opcode, command, sequence, received_us, done_us = values[:8]
+            entries.append({
+                'number': number,
+                'kind': cls.RECORDER_KINDS[kind] if kind < len(cls.RECORDER_KINDS) else "lost",
+                'source': cls.SOURCE_NAMES[source] if source < len(cls.SOURCE_NAMES) else "none",
+                'opcode': opcode,
+                'command': command,
+                'sequence': sequence,
+                'received_us': received_us,
+                'done_us': done_us,
+                'duty': list(values[8:])
+            })
+        return entries
+
+    def read_flight_recorder(self) -> list:
+        """Fetch the car's recent command history (see flight_recorder.h)"""
+        try:
+            response = requests.get(f"{self.base_url}/recorder", timeout=self.request_timeout)
+            response.raise_for_status()
+            return self.parse_flight_recorder(response.content)
+        except requests.exceptions.RequestException as e:
+            logger.error(f"Error reading flight recorder: {e}")
+            return []
+
     def emergency_stop(self) -> bool:
         """Send emergency stop command to the car"""
         logger.warning("Sending emergency stop command")
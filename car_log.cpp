@@ -0,0 +1,131 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+
+#include "car_log.h"
+#include "hal.h"
+
+#define LOG_SLOT_COUNT 32  // power of two
+#define LOG_LINE_SIZE 120
+#define LOG_DRAIN_INTERVAL_MS 10
+
+static_assert((LOG_SLOT_COUNT & (LOG_SLOT_COUNT - 1)) == 0, "LOG_SLOT_COUNT must be a power of two");
+
+// Bounded multi-producer ring (Vyukov). For ring position p the slot at
+// p % LOG_SLOT_COUNT is free when its sequence equals the lap base of p
+// (p rounded down to a multiple of LOG_SLOT_COUNT) and holds the message
+// for p at base + 1. Zero-initialised slots are therefore free for the
+// first lap without any start-up code. Producers claim positions with a
+// CAS; the log task is the only consumer.
+struct LogSlot
+{
+  std::atomic<uint32_t> sequence;
+  uint32_t timestamp;
+  uint8_t level;
+  char text[LOG_LINE_SIZE];
+};
+
+static LogSlot slots[LOG_SLOT_COUNT];
+static std::atomic<uint32_t> enqueuePosition{0};
+static uint32_t dequeuePosition = 0;
+static std::atomic<uint32_t> droppedCount{0};
+
+static const char levelTags[] = {'-', 'E', 'W', 'I', 'D'};
+
+static uint32_t lapBase(uint32_t position)
+{
+  return position & ~(uint32_t)(LOG_SLOT_COUNT - 1);
+}
+
+void logWrite(uint8_t level, const char *format, ...)
+{
+  uint32_t position = enqueuePosition.load(std::memory_order_relaxed);
+  LogSlot *slot;
+  for (;;)
+  {
+    slot = &slots[position & (LOG_SLOT_COUNT - 1)];
+    int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - lapBase(position));
+    if (diff == 0)
+    {
+      if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (diff < 0)
+    {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+    {
+      position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->timestamp = halMillis();
+  slot->level = level;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(slot->text, sizeof(slot->text), format, args);
+  va_end(args);
+  slot->sequence.store(lapBase(position) + 1, std::memory_order_release);
+}
+
+static bool drainOne()
+{
+  LogSlot *slot = &slots[dequeuePosition & (LOG_SLOT_COUNT - 1)];
+  uint32_t base = lapBase(dequeuePosition);
+  if (slot->sequence.load(std::memory_order_acquire) != base + 1)
+  {
+    return false;
+  }
+
+  char line[LOG_LINE_SIZE + 24];
+  int length = snprintf(line, sizeof(line), "[%lu] %c %s\r\n", (unsigned long)slot->timestamp,
+                        levelTags[slot->level < sizeof(levelTags) ? slot->level : 0], slot->text);
+  slot->sequence.store(base + LOG_SLOT_COUNT, std::memory_order_release);
+  dequeuePosition++;
+
+  halLogOutput(line, std::min(length, (int)sizeof(line) - 1));
+  return true;
+}
+
+void flushLogs()
+{
+  static uint32_t reportedDrops = 0;
+
+  while (drainOne())
+  {
+  }
+
+  uint32_t drops = droppedCount.load(std::memory_order_relaxed);
+  if (drops != reportedDrops)
+  {
+    char line[64];
+    int length = snprintf(line, sizeof(line), "[%lu] W %u log messages dropped\r\n", (unsigned long)halMillis(),
+                          drops - reportedDrops);
+    halLogOutput(line, std::min(length, (int)sizeof(line) - 1));
+    reportedDrops = drops;
+  }
+}
+
+static void logTask(void *parameter)
+{
+  for (;;)
+  {
+    flushLogs();
+    halSleepMillis(LOG_DRAIN_INTERVAL_MS);
+  }
+}
+
+void startLogTask()
+{
+  halStartTask(logTask, "log", 3072, LOG_TASK_PRIORITY, LOG_TASK_CORE, nullptr);
+}
+
+uint32_t getLogDroppedCount()
+{
+  return droppedCount.load(std::memory_order_relaxed);
+}
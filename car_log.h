@@ -0,0 +1,66 @@
+/*
+ * Asynchronous, level-gated logging.
+ *
+ * LOG_ERROR/LOG_WARN/LOG_INFO/LOG_DEBUG compile to nothing when their
+ * level is above FIRMWARE_LOG_LEVEL (arduino_config.h), so disabled
+ * levels cost no instructions and their arguments are never evaluated.
+ * Enabled messages are formatted into a slot of a lock-free ring buffer
+ * and written to Serial by a low-priority task; when the ring is full the
+ * message is counted as dropped instead of blocking the caller.
+ *
+ * Messages must end without '\n'; the log task adds the line ending.
+ */
+
+#ifndef CAR_LOG_H
+#define CAR_LOG_H
+
+#include <stdint.h>
+
+#include "arduino_config.h"
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef FIRMWARE_LOG_LEVEL
+#define FIRMWARE_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+void logWrite(uint8_t level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Start the task that drains the ring buffer to Serial
+void startLogTask();
+
+// Write out everything queued so far; what the log task runs every pass,
+// exposed so the host build can drain the ring without the task
+void flushLogs();
+
+uint32_t getLogDroppedCount();
+
+#if FIRMWARE_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if FIRMWARE_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if FIRMWARE_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if FIRMWARE_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // CAR_LOG_H
@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include "car_log.h"
+#include "command_ingress.h"
+#include "hal.h"
+#include "motor_control.h"
+#include "tracking_control.h"
+
+struct NamedCommand
+{
+  const char *name;
+  uint8_t command;
+};
+
+static const NamedCommand gestureNames[] = {
+  {"left", HAND_LEFT_RAISED},
+  {"right", HAND_RIGHT_RAISED},
+  {"both", HAND_BOTH_RAISED},
+  {"none", HAND_NONE_RAISED},
+};
+
+static const NamedCommand trackingActions[] = {
+  {"track_left", TRACK_LEFT},
+  {"track_right", TRACK_RIGHT},
+  {"track_center", TRACK_CENTER},
+};
+
+// Decoded uploads; only the AsyncTCP task ingests scripts and batches
+static MotionScript uploadedScript;
+static CommandBatch receivedBatch;
+
+static uint8_t commandForName(const NamedCommand *names, size_t count, const char *name)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (strcmp(names[i].name, name) == 0)
+    {
+      return names[i].command;
+    }
+  }
+  return STOP;
+}
+
+static IngressResult submitted(bool queued)
+{
+  return queued ? INGRESS_QUEUED : INGRESS_QUEUE_FULL;
+}
+
+static IngressResult submitDecoded(uint8_t source, uint32_t receivedMicros, CarCommand &command)
+{
+  command.source = source;
+  command.receivedMicros = receivedMicros;
+  command.decodedMicros = halMicros();
+
+  if (command.opcode == PROTO_OP_SUBSCRIBE)
+  {
+    return INGRESS_SUBSCRIBE;
+  }
+  if (command.opcode == PROTO_OP_PING)
+  {
+    return INGRESS_PING;
+  }
+  return submitted(submitCarCommand(command));
+}
+
+IngressResult ingestBinaryFrame(uint8_t source, const uint8_t *data, size_t len, uint32_t receivedMicros,
+                                CarCommand &command)
+{
+  command = {};
+  if (!decodeBinaryCommand(data, len, command))
+  {
+    return INGRESS_MALFORMED;
+  }
+
+  if (command.opcode == PROTO_OP_SCRIPT)
+  {
+    if (!decodeMotionScript(data, len, uploadedScript))
+    {
+      return INGRESS_MALFORMED;
+    }
+    uploadedScript.source = source;
+    uploadedScript.receivedMicros = receivedMicros;
+    return submitted(submitMotionScript(uploadedScript));
+  }
+  if (command.opcode == PROTO_OP_BATCH)
+  {
+    if (!decodeCommandBatch(data, len, receivedBatch))
+    {
+      return INGRESS_MALFORMED;
+    }
+    receivedBatch.source = source;
+    receivedBatch.receivedMicros = receivedMicros;
+    receivedBatch.decodedMicros = halMicros();
+    return submitted(submitCommandBatch(receivedBatch));
+  }
+  return submitDecoded(source, receivedMicros, command);
+}
+
+IngressResult ingestTextFrame(uint8_t source, const uint8_t *data, size_t len, uint32_t receivedMicros,
+                              CarCommand &command)
+{
+  command = {};
+  decodeTextCommand(data, len, command);
+  return submitDecoded(source, receivedMicros, command);
+}
+
+IngressResult ingestGesture(const char *gesture, uint32_t receivedMicros)
+{
+  LOG_DEBUG("Received hand gesture: %s", gesture);
+  uint8_t command = commandForName(gestureNames, sizeof(gestureNames) / sizeof(gestureNames[0]), gesture);
+  return submitted(submitCarMovement(command, SOURCE_HTTP_GESTURE, receivedMicros));
+}
+
+IngressResult ingestTrackingAction(const char *action, uint32_t receivedMicros)
+{
+  LOG_DEBUG("Received tracking command: %s", action);
+  uint8_t command = commandForName(trackingActions, sizeof(trackingActions) / sizeof(trackingActions[0]), action);
+  return submitted(submitCarMovement(command, SOURCE_HTTP_TRACKING, receivedMicros));
+}
+
+IngressResult ingestTrackingError(int error, uint32_t receivedMicros)
+{
+  LOG_DEBUG("Received tracking error: %d", error);
+  return submitted(submitTurnRate(trackingErrorToTurnRate(error), SOURCE_HTTP_TRACKING, receivedMicros));
+}
+
+IngressResult ingestTurnRate(int turnRate, uint32_t receivedMicros)
+{
+  LOG_DEBUG("Received tracking turn rate: %d", turnRate);
+  return submitted(submitTurnRate(turnRate, SOURCE_HTTP_TRACKING, receivedMicros));
+}
+
+IngressResult ingestTargetObservation(const TargetObservation &observation, uint32_t receivedMicros)
+{
+  CarCommand command = {};
+  command.opcode = PROTO_OP_OBSERVE;
+  command.target = observation;
+  return submitDecoded(SOURCE_HTTP_TRACKING, receivedMicros, command);
+}
+
+void ingestDisconnect(uint8_t source, uint32_t receivedMicros)
+{
+  CarCommand command = {};
+  command.opcode = PROTO_OP_COMMAND;
+  command.command = STOP;
+  command.disconnect = true;
+  submitDecoded(source, receivedMicros, command);
+}
@@ -0,0 +1,45 @@
+/*
+ * Transport callbacks: what the web server hands the control logic
+ *
+ * The WebSocket and HTTP handlers in smartcar.cpp only unpack their
+ * request and reply; decoding, mapping names to commands and submitting
+ * happen here, so the host build can drive exactly the same paths without
+ * a network stack. All functions run on the AsyncTCP producer slot.
+ */
+
+#ifndef COMMAND_INGRESS_H
+#define COMMAND_INGRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+enum IngressResult
+{
+  INGRESS_QUEUED,      // submitted to the motor task
+  INGRESS_QUEUE_FULL,  // decoded, but the queue had no room
+  INGRESS_MALFORMED,   // not a valid frame
+  INGRESS_PING,        // valid, nothing to submit
+  INGRESS_SUBSCRIBE    // telemetry request, left to the transport
+};
+
+// One complete WebSocket frame from the given SOURCE_*. command holds the
+// decoded frame afterwards (its sequence is what an ack echoes). Script
+// and batch frames are queued for the motor task as a whole.
+IngressResult ingestBinaryFrame(uint8_t source, const uint8_t *data, size_t len, uint32_t receivedMicros,
+                                CarCommand &command);
+IngressResult ingestTextFrame(uint8_t source, const uint8_t *data, size_t len, uint32_t receivedMicros,
+                              CarCommand &command);
+
+// POST /hand-gesture and POST /person-tracking; unknown names stop the car
+IngressResult ingestGesture(const char *gesture, uint32_t receivedMicros);
+IngressResult ingestTrackingAction(const char *action, uint32_t receivedMicros);
+IngressResult ingestTrackingError(int error, uint32_t receivedMicros);
+IngressResult ingestTurnRate(int turnRate, uint32_t receivedMicros);
+IngressResult ingestTargetObservation(const TargetObservation &observation, uint32_t receivedMicros);
+
+// A client went away: stop whatever it was driving
+void ingestDisconnect(uint8_t source, uint32_t receivedMicros);
+
+#endif // COMMAND_INGRESS_H
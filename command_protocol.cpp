@@ -0,0 +1,192 @@
+#include "command_protocol.h"
+#include "tracking_control.h"
+
+// Gesture codes in PROTO_GESTURE_* order
+static const uint8_t gestureCommands[] = {HAND_NONE_RAISED, HAND_LEFT_RAISED, HAND_RIGHT_RAISED, HAND_BOTH_RAISED};
+
+static uint16_t readUint16(const uint8_t *data)
+{
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+bool decodeBinaryCommand(const uint8_t *data, size_t len, CarCommand &command)
+{
+  if (len < PROTO_HEADER_SIZE)
+  {
+    return false;
+  }
+
+  command.opcode = data[0];
+  command.sequence = readUint16(data + 1);
+  return decodeCommandPayload(command.opcode, data + PROTO_HEADER_SIZE, len - PROTO_HEADER_SIZE, command);
+}
+
+bool decodeCommandPayload(uint8_t opcode, const uint8_t *payload, size_t payloadLen, CarCommand &command)
+{
+  command.opcode = opcode;
+
+  switch (opcode)
+  {
+    case PROTO_OP_COMMAND:
+      if (payloadLen < 1 || payload[0] > LAST_COMMAND)
+      {
+        return false;
+      }
+      command.command = payload[0];
+      return true;
+
+    case PROTO_OP_MOTOR_DUTY:
+      if (payloadLen < MOTOR_COUNT * 2)
+      {
+        return false;
+      }
+      for (int i = 0; i < MOTOR_COUNT; i++)
+      {
+        command.motorDuty[i] = (int16_t)readUint16(payload + i * 2);
+      }
+      return true;
+
+    case PROTO_OP_TURN:
+      if (payloadLen < 2)
+      {
+        return false;
+      }
+      command.turnRate = (int16_t)readUint16(payload);
+      return true;
+
+    case PROTO_OP_GESTURE:
+      if (payloadLen < 1 || payload[0] > PROTO_GESTURE_BOTH)
+      {
+        return false;
+      }
+      command.opcode = PROTO_OP_COMMAND;
+      command.command = gestureCommands[payload[0]];
+      return true;
+
+    case PROTO_OP_TRACK_ERROR:
+      if (payloadLen < 2)
+      {
+        return false;
+      }
+      command.opcode = PROTO_OP_TURN;
+      command.turnRate = (int16_t)trackingErrorToTurnRate((int16_t)readUint16(payload));
+      return true;
+
+    case PROTO_OP_VELOCITY:
+      if (payloadLen < 6)
+      {
+        return false;
+      }
+      command.velocity.vx = (int16_t)readUint16(payload);
+      command.velocity.vy = (int16_t)readUint16(payload + 2);
+      command.velocity.omega = (int16_t)readUint16(payload + 4);
+      return true;
+
+    case PROTO_OP_OBSERVE:
+      if (payloadLen < 9)
+      {
+        return false;
+      }
+      command.target.x = (int16_t)readUint16(payload);
+      command.target.width = readUint16(payload + 2);
+      command.target.confidence = payload[4];
+      command.target.frameMillis = readUint16(payload + 5) | (uint32_t)readUint16(payload + 7) << 16;
+      return true;
+
+    case PROTO_OP_PING:
+    case PROTO_OP_SCRIPT:
+    case PROTO_OP_BATCH:
+      return true;
+
+    case PROTO_OP_SUBSCRIBE:
+      if (payloadLen < 1)
+      {
+        return false;
+      }
+      command.command = payload[0] != 0;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+size_t motionPayloadSize(uint8_t opcode)
+{
+  switch (opcode)
+  {
+    case PROTO_OP_COMMAND:
+    case PROTO_OP_GESTURE:
+      return 1;
+    case PROTO_OP_MOTOR_DUTY:
+      return MOTOR_COUNT * 2;
+    case PROTO_OP_TURN:
+    case PROTO_OP_TRACK_ERROR:
+      return 2;
+    case PROTO_OP_VELOCITY:
+      return 6;
+    default:
+      return 0;
+  }
+}
+
+static const char *const sourceNames[SOURCE_COUNT] = {"ws", "control", "hand_gesture", "person_tracking", "udp"};
+
+const char *sourceName(uint8_t source)
+{
+  return source < SOURCE_COUNT ? sourceNames[source] : "none";
+}
+
+size_t encodeAck(uint8_t *buffer, uint16_t sequence, uint8_t status, uint8_t queueDepth)
+{
+  buffer[0] = PROTO_OP_ACK;
+  buffer[1] = (uint8_t)(sequence & 0xFF);
+  buffer[2] = (uint8_t)(sequence >> 8);
+  buffer[3] = status;
+  buffer[4] = queueDepth;
+  return PROTO_ACK_SIZE;
+}
+
+size_t encodeState(uint8_t *buffer, uint16_t version, uint8_t owner, const int16_t *motorDuty)
+{
+  buffer[0] = PROTO_OP_STATE;
+  buffer[1] = (uint8_t)(version & 0xFF);
+  buffer[2] = (uint8_t)(version >> 8);
+  buffer[3] = owner;
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    buffer[4 + i * 2] = (uint8_t)(motorDuty[i] & 0xFF);
+    buffer[5 + i * 2] = (uint8_t)((uint16_t)motorDuty[i] >> 8);
+  }
+  return PROTO_STATE_SIZE;
+}
+
+void decodeTextCommand(const uint8_t *data, size_t len, CarCommand &command)
+{
+  command.opcode = PROTO_OP_COMMAND;
+  command.sequence = 0;
+  command.command = STOP;
+
+  size_t i = 0;
+  while (i < len && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n'))
+  {
+    i++;
+  }
+
+  int value = 0;
+  size_t digits = 0;
+  while (i < len && data[i] >= '0' && data[i] <= '9')
+  {
+    if (value <= LAST_COMMAND)
+    {
+      value = value * 10 + (data[i] - '0');
+    }
+    i++;
+    digits++;
+  }
+
+  if (digits > 0 && value <= LAST_COMMAND)
+  {
+    command.command = (uint8_t)value;
+  }
+}
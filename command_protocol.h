@@ -0,0 +1,173 @@
+/*
+ * WebSocket command protocol
+ *
+ * Text frames carry a decimal command id ("0".."17") and are what the
+ * htmlHomePage joystick sends. Binary frames are meant for machine
+ * clients and are decoded straight from the receive buffer:
+ *
+ *   byte 0     opcode
+ *   byte 1..2  sequence number (little-endian)
+ *   byte 3..   payload
+ *
+ *   PROTO_OP_COMMAND     payload: 1 byte command id
+ *   PROTO_OP_MOTOR_DUTY  payload: 4 x int16 LE signed duty, one per motor
+ *                        (FRONT_RIGHT, BACK_RIGHT, FRONT_LEFT, BACK_LEFT),
+ *                        positive = forward, range -MAX_SPEED..MAX_SPEED
+ *   PROTO_OP_TURN        payload: int16 LE turn rate, -1000 (left) .. 1000
+ *                        (right), mapped to a proportional duty
+ *   PROTO_OP_GESTURE     payload: 1 byte PROTO_GESTURE_* (decoded as the
+ *                        matching HAND_* command)
+ *   PROTO_OP_TRACK_ERROR payload: int16 LE target offset from the frame
+ *                        centre, -1000..1000 (decoded as PROTO_OP_TURN)
+ *   PROTO_OP_PING        no payload; only acknowledged, used to measure
+ *                        round-trip latency without moving the car
+ *   PROTO_OP_SUBSCRIBE   payload: 1 byte, 1 = send telemetry, 0 = stop;
+ *                        accepted on /ws and /control, never moves the car
+ *   PROTO_OP_SCRIPT      payload: 1..MOTION_SCRIPT_MAX_SEGMENTS segments of
+ *                        [duration ms u16 LE][opcode u8][that opcode's
+ *                        payload], run by the car itself (motion_script.h)
+ *   PROTO_OP_OBSERVE     payload: [target centre int16 LE, -1000 (left) ..
+ *                        1000 (right)][target width u16 LE, 0..1000 of the
+ *                        frame width][confidence u8, 0..100][frame
+ *                        timestamp u32 LE, ms on the host clock]; steers
+ *                        the on-device tracking controller
+ *                        (tracking_control.h)
+ *   PROTO_OP_BATCH       payload: 1..BATCH_MAX_COMMANDS items of [sender
+ *                        timestamp u32 LE, ms on the host clock][opcode
+ *                        u8][that opcode's payload], played out at the
+ *                        spacing they were taken (jitter_buffer.h)
+ *   PROTO_OP_VELOCITY    payload: 3 x int16 LE body velocity [forward]
+ *                        [right][clockwise turn], each -1000..1000 of full
+ *                        speed, mixed into the four wheels on the car
+ *                        (mecanum_mix.h)
+ *
+ * The /control endpoint answers every binary frame with an ack:
+ *
+ *   PROTO_OP_ACK         [seq u16][status u8][queue depth u8]
+ *
+ * Both WebSockets are pushed the control state when it changes; /control
+ * gets it as a binary frame:
+ *
+ *   PROTO_OP_STATE       [version u16][owner u8][4 x int16 LE signed duty]
+ *                        owner is a SOURCE_* id or 0xFF when nobody owns
+ *                        control
+ *
+ * Subscribed clients receive batched telemetry (see telemetry.h):
+ *
+ *   PROTO_OP_TELEMETRY   [seq u16][sample count u8][sample size u8][samples]
+ *
+ * and the progress of the running motion script:
+ *
+ *   PROTO_OP_SCRIPT_STATE [script seq u16][segment u8][segment count u8]
+ *                        [state u8], state a SCRIPT_* value
+ */
+
+#ifndef COMMAND_PROTOCOL_H
+#define COMMAND_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "car_commands.h"
+
+#define PROTO_HEADER_SIZE 3
+
+#define PROTO_OP_COMMAND 0x01
+#define PROTO_OP_MOTOR_DUTY 0x02
+#define PROTO_OP_TURN 0x03
+#define PROTO_OP_GESTURE 0x04
+#define PROTO_OP_TRACK_ERROR 0x05
+#define PROTO_OP_PING 0x06
+#define PROTO_OP_SUBSCRIBE 0x07
+#define PROTO_OP_SCRIPT 0x08
+#define PROTO_OP_OBSERVE 0x09
+#define PROTO_OP_BATCH 0x0A
+#define PROTO_OP_VELOCITY 0x0B
+#define PROTO_OP_ACK 0x80
+#define PROTO_OP_STATE 0x81
+#define PROTO_OP_TELEMETRY 0x82
+#define PROTO_OP_SCRIPT_STATE 0x83
+
+#define PROTO_GESTURE_NONE 0
+#define PROTO_GESTURE_LEFT 1
+#define PROTO_GESTURE_RIGHT 2
+#define PROTO_GESTURE_BOTH 3
+
+#define PROTO_ACK_OK 0
+#define PROTO_ACK_QUEUE_FULL 1
+#define PROTO_ACK_MALFORMED 2
+
+#define PROTO_ACK_SIZE 5
+#define PROTO_STATE_SIZE (4 + MOTOR_COUNT * 2)
+
+// Where a command came from (metrics and, later, arbitration)
+#define SOURCE_WS 0             // /ws joystick page
+#define SOURCE_CONTROL_WS 1     // /control vision host stream
+#define SOURCE_HTTP_GESTURE 2   // POST /hand-gesture
+#define SOURCE_HTTP_TRACKING 3  // POST /person-tracking
+#define SOURCE_UDP 4            // UDP fast path
+#define SOURCE_COUNT 5
+
+// One camera frame's view of the tracked target
+struct TargetObservation
+{
+  int16_t x;            // centre, -1000 (far left) .. 1000 (far right)
+  uint16_t width;       // 0..1000 of the frame width, 0 = no target
+  uint8_t confidence;   // 0..100
+  uint32_t frameMillis; // host clock; only differences are used
+};
+
+// Mecanum body velocity, each -1000..1000 of full speed
+struct BodyVelocity
+{
+  int16_t vx;     // forward
+  int16_t vy;     // sideways, right positive
+  int16_t omega;  // turn, clockwise (right) positive
+};
+
+struct CarCommand
+{
+  uint8_t opcode;
+  uint16_t sequence;
+  uint8_t command;                 // PROTO_OP_COMMAND
+  int16_t motorDuty[MOTOR_COUNT];  // PROTO_OP_MOTOR_DUTY
+  int16_t turnRate;                // PROTO_OP_TURN
+  BodyVelocity velocity;           // PROTO_OP_VELOCITY
+  TargetObservation target;        // PROTO_OP_OBSERVE
+
+  // Filled in by the receiving handler, not part of the wire format
+  uint8_t source;                  // SOURCE_*
+  uint32_t receivedMicros;         // handler entry
+  uint32_t decodedMicros;          // frame decoded
+  bool disconnect;                 // STOP because the source's connection closed
+};
+
+// Decode a binary frame. Returns false for short frames, unknown opcodes
+// and out-of-range command ids. A PROTO_OP_SCRIPT frame only has its
+// header decoded; see decodeMotionScript(). So does PROTO_OP_BATCH, see
+// decodeCommandBatch().
+bool decodeBinaryCommand(const uint8_t *data, size_t len, CarCommand &command);
+
+// Decode the payload of one opcode, as decodeBinaryCommand() does after
+// the header
+bool decodeCommandPayload(uint8_t opcode, const uint8_t *payload, size_t payloadLen, CarCommand &command);
+
+// Payload size of the motion opcodes a script segment or batch item may
+// carry (command, gesture, motor duty, turn, tracking error, velocity), 0
+// for others
+size_t motionPayloadSize(uint8_t opcode);
+
+// Write an ack frame into buffer (PROTO_ACK_SIZE bytes) and return its size
+size_t encodeAck(uint8_t *buffer, uint16_t sequence, uint8_t status, uint8_t queueDepth);
+
+// Write a state frame into buffer (PROTO_STATE_SIZE bytes) and return its size
+size_t encodeState(uint8_t *buffer, uint16_t version, uint8_t owner, const int16_t *motorDuty);
+
+// Short name of a SOURCE_* id for logs and metrics; "none" when out of range
+const char *sourceName(uint8_t source);
+
+// Decode a text frame the same way String::toInt() did: anything that is
+// not a known command id becomes STOP.
+void decodeTextCommand(const uint8_t *data, size_t len, CarCommand &command);
+
+#endif // COMMAND_PROTOCOL_H
@@ -0,0 +1,76 @@
+/*
+ * Lock-free single-producer/single-consumer ring buffer.
+ *
+ * One task may call push() and one (other) task may call pop(); no locks
+ * are taken and nothing is allocated after construction. N must be a
+ * power of two.
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class SpscQueue
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+  // Producer side. Returns false (and counts an overflow) when full.
+  bool push(const T &item)
+  {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N)
+    {
+      overflows_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+
+    uint32_t depth = head + 1 - tail;
+    if (depth > highWatermark_.load(std::memory_order_relaxed))
+    {
+      highWatermark_.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T &item)
+  {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+      return false;
+    }
+
+    item = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+  uint32_t highWatermark() const { return highWatermark_.load(std::memory_order_relaxed); }
+  uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+  T items_[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> highWatermark_{0};
+  std::atomic<uint32_t> overflows_{0};
+};
+
+#endif // COMMAND_QUEUE_H
@@ -53,6 +53,7 @@ class ConfigLoader:
             },
             'vision': {
                 'camera': {
+                    'source': 0,
                     'width': 640,
                     'height': 480,
                     'flip_horizontal': True
@@ -69,7 +70,10 @@ class ConfigLoader:
             'controller': {
                 'min_command_interval': 2.0,
                 'connection_timeout': 5,
-                'request_timeout': 2
+                'request_timeout': 2,
+                'transport': 'http',
+                'stream_wait_for_ack': True,
+                'lease_renew_interval': 0.2
             },
             'display': {
                 'font_scale': 1,
@@ -174,13 +178,33 @@ class ConfigLoader:
             'max_speed': self.get('motors.max_speed', 255),
             'pwm_frequency': self.get('motors.pwm_frequency', 1000),
             'pwm_resolution': self.get('motors.pwm_resolution', 8),
-            'motor2_startup_delay': self.get('motors.motor2_startup_delay', 50)
+            'motor2_startup_delay': self.get('motors.motor2_startup_delay', 50),
+            'startup_offsets': self.get('motors.startup_offsets', self._default_startup_offsets()),
+            'ramps': self._ramp_profiles(),
+            'ramp_tick_ms': self.get('motors.ramp_tick_ms', 5)
         }
+
+    def _ramp_profiles(self) -> List[Dict[str, int]]:
+        """Ramp slopes in firmware RampClass order; STOP and direct duty frames default to instant"""
+        defaults = {'stop': (0, 0), 'drive': (300, 200), 'turn': (150, 100), 'direct': (0, 0)}
+        return [
+            {
+                'accel_ms': self.get(f'motors.ramps.{name}.accel_ms', accel),
+                'decel_ms': self.get(f'motors.ramps.{name}.decel_ms', decel)
+            }
+            for name, (accel, decel) in defaults.items()
+        ]
+
+    def _default_startup_offsets(self) -> List[int]:
+        """Give FRONT_LEFT_MOTOR its head start by delaying the other three motors"""
+        delay = self.get('motors.motor2_startup_delay', 50)
+        return [delay, delay, 0, delay]
     
     def get_vision_config(self) -> Dict[str, Any]:
         """Get vision system configuration"""
         return {
             'camera': {
+                'source': self.get('vision.camera.source', 0),
                 'width': self.get('vision.camera.width', 640),
                 'height': self.get('vision.camera.height', 480),
                 'flip_horizontal': self.get('vision.camera.flip_horizontal', True)
@@ -200,7 +224,11 @@ class ConfigLoader:
         return {
             'min_command_interval': self.get('controller.min_command_interval', 2.0),
             'connection_timeout': self.get('controller.connection_timeout', 5),
-            'request_timeout': self.get('controller.request_timeout', 2)
+            'request_timeout': self.get('controller.request_timeout', 2),
+            'transport': self.get('controller.transport', 'http'),
+            'stream_wait_for_ack': self.get('controller.stream_wait_for_ack', True),
+            'lease_renew_interval': self.get('controller.lease_renew_interval', 0.2),
+            'tracking_mode': self.get('controller.tracking_mode', 'gestures')
         }
     
     def get_display_config(self) -> Dict[str, Any]:
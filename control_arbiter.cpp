@@ -0,0 +1,109 @@
+#include <atomic>
+
+#include "arduino_config.h"
+#include "control_arbiter.h"
+#include "hal.h"
+
+static_assert(sizeof(SOURCE_PRIORITIES) / sizeof(SOURCE_PRIORITIES[0]) == SOURCE_COUNT,
+              "SOURCE_PRIORITIES needs one entry per command source");
+
+// Ownership, only touched by the motor task
+static uint8_t owner = OWNER_NONE;
+static uint32_t ownerLeaseMillis = 0;
+static std::atomic<uint32_t> rejections{0};
+
+// Published snapshot, written by the motor task and read by the service task. A
+// sequence lock: the sequence is odd while the fields are being written
+// and readers retry until they see the same even value on both sides.
+static std::atomic<uint32_t> stateSequence{0};
+static std::atomic<uint32_t> stateVersion{0};
+static std::atomic<uint8_t> stateOwner{OWNER_NONE};
+static std::atomic<int16_t> stateDuty[MOTOR_COUNT];
+
+static bool ownerLeaseValid()
+{
+  return owner != OWNER_NONE && (int32_t)(halMillis() - ownerLeaseMillis) < (int32_t)ARBITER_LEASE_MS;
+}
+
+bool arbitrateCommand(const CarCommand &command, bool moves)
+{
+  if (!ownerLeaseValid())
+  {
+    owner = OWNER_NONE;
+  }
+
+  bool isStop = command.opcode == PROTO_OP_COMMAND && command.command == STOP;
+  bool mayControl = owner == OWNER_NONE || command.source == owner || command.source >= SOURCE_COUNT ||
+                    SOURCE_PRIORITIES[command.source] >= SOURCE_PRIORITIES[owner];
+
+  if (!mayControl && !isStop)
+  {
+    rejections.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (moves && command.source < SOURCE_COUNT)
+  {
+    owner = command.source;
+    ownerLeaseMillis = halMillis();
+  }
+  else if (!moves)
+  {
+    // Whatever stopped the car also ends the current ownership
+    owner = OWNER_NONE;
+  }
+  return true;
+}
+
+void publishControlState(const int16_t *motorDuty)
+{
+  if (!ownerLeaseValid())
+  {
+    owner = OWNER_NONE;
+  }
+
+  bool changed = stateOwner.load(std::memory_order_relaxed) != owner;
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    changed |= stateDuty[i].load(std::memory_order_relaxed) != motorDuty[i];
+  }
+  if (!changed)
+  {
+    return;
+  }
+
+  uint32_t sequence = stateSequence.load(std::memory_order_relaxed);
+  stateSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    stateDuty[i].store(motorDuty[i], std::memory_order_relaxed);
+  }
+  stateOwner.store(owner, std::memory_order_relaxed);
+  stateVersion.store(stateVersion.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  stateSequence.store(sequence + 2, std::memory_order_release);
+}
+
+ControlState getControlState()
+{
+  ControlState state;
+  uint32_t sequence;
+
+  do
+  {
+    sequence = stateSequence.load(std::memory_order_acquire);
+    state.version = stateVersion.load(std::memory_order_relaxed);
+    state.owner = stateOwner.load(std::memory_order_relaxed);
+    for (int i = 0; i < MOTOR_COUNT; i++)
+    {
+      state.motorDuty[i] = stateDuty[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) != 0 || stateSequence.load(std::memory_order_relaxed) != sequence);
+  return state;
+}
+
+uint32_t getArbiterRejections()
+{
+  return rejections.load(std::memory_order_relaxed);
+}
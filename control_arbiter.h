@@ -0,0 +1,40 @@
+/*
+ * Control ownership between command sources
+ *
+ * A source that moves the car becomes its owner and holds ownership for
+ * ARBITER_LEASE_MS after its last command. While the lease runs, commands
+ * from sources of lower SOURCE_PRIORITIES are rejected; equal or higher
+ * priority preempts. STOP is always accepted, and an owner that sends a
+ * non-moving command releases ownership at once.
+ *
+ * The motor task arbitrates and publishes the resulting state; the
+ * service task picks up new versions and broadcasts them to WebSocket
+ * clients.
+ */
+
+#ifndef CONTROL_ARBITER_H
+#define CONTROL_ARBITER_H
+
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define OWNER_NONE 0xFF
+
+struct ControlState
+{
+  uint32_t version;                // bumped on every change
+  uint8_t owner;                   // SOURCE_* or OWNER_NONE
+  int16_t motorDuty[MOTOR_COUNT];  // target duty per motor, positive = forward
+};
+
+// Motor task only: true if the command may be applied
+bool arbitrateCommand(const CarCommand &command, bool moves);
+
+// Motor task only: record the target state after a batch of commands
+void publishControlState(const int16_t *motorDuty);
+
+ControlState getControlState();
+uint32_t getArbiterRejections();
+
+#endif // CONTROL_ARBITER_H
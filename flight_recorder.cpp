@@ -0,0 +1,155 @@
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#include "flight_recorder.h"
+#include "hal.h"
+
+static_assert(RECORDER_ENTRIES > 0 && (RECORDER_ENTRIES & (RECORDER_ENTRIES - 1)) == 0,
+              "firmware.recorder_entries must be a power of two");
+static_assert(RECORDER_ENTRIES <= 0x8000, "the dump header counts entries in 16 bits");
+
+// tag is the entry number + 1 once the entry is complete, 0 while it is written
+struct RecorderSlot
+{
+  std::atomic<uint32_t> tag;
+  RecorderEntry entry;
+};
+
+static RecorderSlot slots[RECORDER_ENTRIES];
+static std::atomic<uint32_t> entriesRecorded{0};
+
+void recordEvent(uint8_t kind, const CarCommand &command, const int16_t *duty)
+{
+  uint32_t number = entriesRecorded.load(std::memory_order_relaxed);
+  RecorderSlot &slot = slots[number & (RECORDER_ENTRIES - 1)];
+
+  slot.tag.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  RecorderEntry &entry = slot.entry;
+  entry.number = number;
+  entry.kind = kind;
+  entry.source = command.source;
+  entry.opcode = command.opcode;
+  entry.command = command.command;
+  entry.sequence = command.sequence;
+  entry.receivedMicros = command.receivedMicros;
+  entry.doneMicros = halMicros();
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    entry.duty[i] = duty[i];
+  }
+
+  slot.tag.store(number + 1, std::memory_order_release);
+  entriesRecorded.store(number + 1, std::memory_order_release);
+}
+
+uint32_t recorderCount()
+{
+  return entriesRecorded.load(std::memory_order_acquire);
+}
+
+bool recorderEntry(uint32_t number, RecorderEntry &entry)
+{
+  const RecorderSlot &slot = slots[number & (RECORDER_ENTRIES - 1)];
+
+  if (slot.tag.load(std::memory_order_acquire) != number + 1)
+  {
+    return false;
+  }
+  entry = slot.entry;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.tag.load(std::memory_order_relaxed) == number + 1;
+}
+
+RecorderDump startRecorderDump()
+{
+  uint32_t count = recorderCount();
+  RecorderDump dump;
+
+  dump.count = std::min(count, (uint32_t)RECORDER_ENTRIES);
+  dump.first = count - dump.count;
+  return dump;
+}
+
+size_t recorderDumpSize(const RecorderDump &dump)
+{
+  return RECORDER_HEADER_SIZE + dump.count * RECORDER_ENTRY_SIZE;
+}
+
+static void writeUint16(uint8_t *buffer, uint16_t value)
+{
+  buffer[0] = value & 0xFF;
+  buffer[1] = value >> 8;
+}
+
+static void writeUint32(uint8_t *buffer, uint32_t value)
+{
+  writeUint16(buffer, value & 0xFFFF);
+  writeUint16(buffer + 2, value >> 16);
+}
+
+static void encodeEntry(uint32_t number, uint8_t *buffer)
+{
+  RecorderEntry entry;
+
+  if (!recorderEntry(number, entry))
+  {
+    memset(buffer, 0, RECORDER_ENTRY_SIZE);
+    writeUint32(buffer, number);
+    buffer[4] = RECORD_LOST;
+    return;
+  }
+
+  writeUint32(buffer, entry.number);
+  buffer[4] = entry.kind;
+  buffer[5] = entry.source;
+  buffer[6] = entry.opcode;
+  buffer[7] = entry.command;
+  writeUint16(buffer + 8, entry.sequence);
+  writeUint32(buffer + 10, entry.receivedMicros);
+  writeUint32(buffer + 14, entry.doneMicros);
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    writeUint16(buffer + 18 + i * 2, (uint16_t)entry.duty[i]);
+  }
+}
+
+// The header or entry under offset is encoded into a scratch block, then
+// the part of it that falls into the requested range is copied out
+size_t encodeRecorderDump(const RecorderDump &dump, size_t offset, uint8_t *buffer, size_t size)
+{
+  size_t total = recorderDumpSize(dump);
+  size_t written = 0;
+  uint8_t block[RECORDER_ENTRY_SIZE];
+
+  while (written < size && offset < total)
+  {
+    size_t blockStart;
+    size_t blockSize;
+    if (offset < RECORDER_HEADER_SIZE)
+    {
+      block[0] = RECORDER_FORMAT_VERSION;
+      block[1] = RECORDER_ENTRY_SIZE;
+      writeUint16(block + 2, (uint16_t)dump.count);
+      writeUint32(block + 4, dump.first + dump.count);
+      blockStart = 0;
+      blockSize = RECORDER_HEADER_SIZE;
+    }
+    else
+    {
+      size_t index = (offset - RECORDER_HEADER_SIZE) / RECORDER_ENTRY_SIZE;
+      encodeEntry(dump.first + index, block);
+      blockStart = RECORDER_HEADER_SIZE + index * RECORDER_ENTRY_SIZE;
+      blockSize = RECORDER_ENTRY_SIZE;
+    }
+
+    size_t skip = offset - blockStart;
+    size_t length = std::min(blockSize - skip, size - written);
+    memcpy(buffer + written, block + skip, length);
+    written += length;
+    offset += length;
+  }
+  return written;
+}
@@ -0,0 +1,88 @@
+/*
+ * Flight recorder: what the motor task did with the last RECORDER_ENTRIES
+ * commands, kept in RAM
+ *
+ * Every command the motor task takes off the queues is recorded, applied
+ * or not, with its source, sequence number, receive time, the time the
+ * motor task finished with it and the motor targets afterwards. So are
+ * lease expiries, stops on disconnect and stops requested outside the
+ * queues. A script is recorded once, as its first segment, when it starts.
+ *
+ * The ring is a static array that only the motor task writes. An entry
+ * costs a handful of stores and never allocates or locks, so the recorder
+ * stays on in production. Readers check a per-entry tag before and after
+ * copying an entry, and skip it if the motor task overwrote it in the
+ * meantime.
+ *
+ * GET /recorder dumps the ring, oldest entry first, little-endian:
+ *
+ *   header  [version u8][entry size u8][entry count u16][entries recorded since boot u32]
+ *   entry   [number u32][kind u8][source u8][opcode u8][command u8][sequence u16]
+ *           [received us u32][done us u32][4 x motor target int16]
+ *
+ * An entry overwritten while the dump was being sent comes out as
+ * RECORD_LOST.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arduino_config.h"
+#include "command_protocol.h"
+
+#define RECORDER_FORMAT_VERSION 1
+#define RECORDER_HEADER_SIZE 8
+#define RECORDER_ENTRY_SIZE 26
+
+enum RecordKind : uint8_t
+{
+  RECORD_APPLIED,          // changed the motion
+  RECORD_REPEATED,         // same motion as before: lease renewed, outputs untouched
+  RECORD_REJECTED,         // another source owns control
+  RECORD_OBSERVATION,      // target observation for the tracking controller
+  RECORD_LEASE_EXPIRED,    // nothing renewed the lease of this command: car stopped
+  RECORD_DISCONNECT_STOP,  // the source's connection closed: car stopped
+  RECORD_STOP_REQUESTED,   // STOP outside the queues (link lost, queue full)
+  RECORD_LOST = 0xFF,      // dump only: overwritten while being sent
+};
+
+struct RecorderEntry
+{
+  uint32_t number;  // entries recorded before this one since boot
+  uint8_t kind;     // RecordKind
+  uint8_t source;   // SOURCE_* or OWNER_NONE
+  uint8_t opcode;
+  uint8_t command;
+  uint16_t sequence;
+  uint32_t receivedMicros;
+  uint32_t doneMicros;        // motor task finished with it
+  int16_t duty[MOTOR_COUNT];  // signed motor targets afterwards, staged motors included
+};
+
+// Motor task only
+void recordEvent(uint8_t kind, const CarCommand &command, const int16_t *duty);
+
+uint32_t recorderCount();
+
+// Copy one entry by number; false if it was not recorded yet or was
+// already overwritten
+bool recorderEntry(uint32_t number, RecorderEntry &entry);
+
+// The entries a dump started now covers
+struct RecorderDump
+{
+  uint32_t first;
+  uint32_t count;
+};
+
+RecorderDump startRecorderDump();
+size_t recorderDumpSize(const RecorderDump &dump);
+
+// Write bytes offset .. offset + size of the dump into buffer; a response
+// can send it in pieces. Returns the bytes written.
+size_t encodeRecorderDump(const RecorderDump &dump, size_t offset, uint8_t *buffer, size_t size);
+
+#endif // FLIGHT_RECORDER_H
@@ -13,6 +13,29 @@ def generate_arduino_config():
     wifi_config = config.get_wifi_config()
     motor_config = config.get_motor_config()
     
+    # Firmware log level; ENABLE_DEBUG_OUTPUT decides the default
+    debug_output = config.get('system.enable_debug_output', True)
+    log_level = str(config.get('firmware.log_level', 'debug' if debug_output else 'info')).upper()
+
+    # AsyncTCP reads its core and priority from compiler flags, so they go
+    # to build_opt.h, which the ESP32 Arduino core passes to every file
+    network_core = config.get('firmware.network_core', 0)
+    network_priority = config.get('firmware.network_task_priority', 3)
+    build_options = (f"-DCONFIG_ASYNC_TCP_RUNNING_CORE={network_core} "
+                     f"-DCONFIG_ASYNC_TCP_PRIORITY={network_priority}\n")
+
+    # Camera builds take the motors off the camera bus
+    camera_enabled = config.get('camera.enabled', False)
+    if camera_enabled:
+        pin_section = 'camera.motor_pins'
+        pin_defaults = {'front_right': (14, 15), 'back_right': (13, 12), 'front_left': (2, 4), 'back_left': (1, 3)}
+    else:
+        pin_section = 'motor_pins'
+        pin_defaults = {'front_right': (16, 17), 'back_right': (18, 19), 'front_left': (27, 26), 'back_left': (25, 33)}
+    motor_pins = {name: (config.get(f'{pin_section}.{name}.pin_in1', in1), config.get(f'{pin_section}.{name}.pin_in2', in2))
+                  for name, (in1, in2) in pin_defaults.items()}
+    camera_model = str(config.get('camera.model', 'ai_thinker')).upper()
+
     # Generate Arduino header content
     header_content = f'''/*
  * AUTO-GENERATED CONFIGURATION FILE
@@ -24,23 +47,125 @@ def generate_arduino_config():
 #define CONFIG_H
 
 // WiFi Configuration
-const char* WIFI_SSID = "{wifi_config['ssid']}";
-const char* WIFI_PASSWORD = "{wifi_config['password']}";
+const char* const WIFI_SSID = "{wifi_config['ssid']}";
+const char* const WIFI_PASSWORD = "{wifi_config['password']}";
+const bool WIFI_FAST_CONNECT = {str(config.get('wifi.fast_connect', True)).lower()};
+const char* const WIFI_STATIC_IP = "{config.get('wifi.static_ip', '')}";
+const char* const WIFI_GATEWAY = "{config.get('wifi.gateway', '')}";
+const char* const WIFI_SUBNET = "{config.get('wifi.subnet', '255.255.255.0')}";
+const char* const WIFI_DNS = "{config.get('wifi.dns', '')}";
+const unsigned long WIFI_RECONNECT_MIN_MS = {config.get('wifi.reconnect_min_ms', 500)};
+const unsigned long WIFI_RECONNECT_MAX_MS = {config.get('wifi.reconnect_max_ms', 8000)};
 
 // Motor Configuration
-const int MOTOR_DIRECTION_CORRECTION[4] = {{{', '.join(map(str, motor_config['direction_correction']))}}};
+constexpr int MOTOR_DIRECTION_CORRECTION[4] = {{{', '.join(map(str, motor_config['direction_correction']))}}};
 const int MOTOR_MAX_SPEED = {motor_config['max_speed']};
 const int MOTOR_PWM_FREQUENCY = {motor_config['pwm_frequency']};
 const int MOTOR_PWM_RESOLUTION = {motor_config['pwm_resolution']};
 const int MOTOR2_STARTUP_DELAY = {motor_config['motor2_startup_delay']};
 
-// Motor Pin Configuration
-const int MOTOR_PINS[4][2] = {{
-    {{{config.get('motor_pins.front_right.pin_in1', 16)}, {config.get('motor_pins.front_right.pin_in2', 17)}}},  // FRONT_RIGHT_MOTOR
-    {{{config.get('motor_pins.back_right.pin_in1', 18)}, {config.get('motor_pins.back_right.pin_in2', 19)}}},   // BACK_RIGHT_MOTOR
-    {{{config.get('motor_pins.front_left.pin_in1', 27)}, {config.get('motor_pins.front_left.pin_in2', 26)}}},   // FRONT_LEFT_MOTOR
-    {{{config.get('motor_pins.back_left.pin_in1', 25)}, {config.get('motor_pins.back_left.pin_in2', 33)}}}     // BACK_LEFT_MOTOR
+// Staged start-up offset per motor (ms after the command), FRONT_RIGHT..BACK_LEFT
+const int MOTOR_STARTUP_OFFSETS[4] = {{{', '.join(map(str, motor_config['startup_offsets']))}}};
+
+// Acceleration ramps (ms for a full 0..max_speed change, 0 = instant), STOP, DRIVE, TURN, DIRECT
+const int RAMP_ACCEL_MS[4] = {{{', '.join(str(r['accel_ms']) for r in motor_config['ramps'])}}};
+const int RAMP_DECEL_MS[4] = {{{', '.join(str(r['decel_ms']) for r in motor_config['ramps'])}}};
+const int RAMP_TICK_MS = {motor_config['ramp_tick_ms']};
+
+// Motor Pin Configuration (from {pin_section})
+constexpr int MOTOR_PINS[4][2] = {{
+    {{{motor_pins['front_right'][0]}, {motor_pins['front_right'][1]}}},  // FRONT_RIGHT_MOTOR
+    {{{motor_pins['back_right'][0]}, {motor_pins['back_right'][1]}}},   // BACK_RIGHT_MOTOR
+    {{{motor_pins['front_left'][0]}, {motor_pins['front_left'][1]}}},   // FRONT_LEFT_MOTOR
+    {{{motor_pins['back_left'][0]}, {motor_pins['back_left'][1]}}}     // BACK_LEFT_MOTOR
+}};
+
+// Battery Voltage Compensation
+constexpr bool BATTERY_ENABLED = {str(config.get('battery.enabled', False)).lower()};
+constexpr int BATTERY_ADC_PIN = {config.get('battery.adc_pin', 39)};
+const int BATTERY_DIVIDER_PERMILLE = {int(round(float(config.get('battery.divider_ratio', 3.0)) * 1000))};
+const int BATTERY_SAMPLE_RATE_HZ = {config.get('battery.sample_rate_hz', 20000)};
+const unsigned long BATTERY_UPDATE_MS = {config.get('battery.update_ms', 50)};
+const unsigned long BATTERY_FILTER_MS = {config.get('battery.filter_ms', 500)};
+const int BATTERY_NOMINAL_MV = {config.get('battery.nominal_mv', 7400)};
+const int BATTERY_MAX_COMPENSATION_PERMILLE = {int(round(float(config.get('battery.max_compensation', 1.3)) * 1000))};
+const int BATTERY_LOW_MV = {config.get('battery.low_mv', 6600)};
+const int BATTERY_LOW_LIMIT_PERCENT = {config.get('battery.low_limit_percent', 60)};
+const int BATTERY_LOW_HYSTERESIS_MV = {config.get('battery.low_hysteresis_mv', 200)};
+
+// Wheel Encoder Configuration (channel A, channel B; B = -1 for single-channel encoders)
+constexpr bool ENCODERS_ENABLED = {str(config.get('encoders.enabled', False)).lower()};
+constexpr int ENCODER_PINS[4][2] = {{
+    {{{config.get('encoders.pins.front_right.pin_a', 34)}, {config.get('encoders.pins.front_right.pin_b', 35)}}},  // FRONT_RIGHT_MOTOR
+    {{{config.get('encoders.pins.back_right.pin_a', 36)}, {config.get('encoders.pins.back_right.pin_b', 13)}}},   // BACK_RIGHT_MOTOR
+    {{{config.get('encoders.pins.front_left.pin_a', 32)}, {config.get('encoders.pins.front_left.pin_b', 23)}}},   // FRONT_LEFT_MOTOR
+    {{{config.get('encoders.pins.back_left.pin_a', 22)}, {config.get('encoders.pins.back_left.pin_b', 21)}}}     // BACK_LEFT_MOTOR
 }};
+const int ENCODER_COUNTS_PER_REV = {config.get('encoders.counts_per_rev', 40)};
+const int SPEED_MAX_RPM = {config.get('encoders.max_rpm', 200)};
+const int SPEED_LOOP_HZ = {config.get('encoders.loop_hz', 200)};
+const float SPEED_PID_KP = {float(config.get('encoders.kp', 0.5))}f;
+const float SPEED_PID_KI = {float(config.get('encoders.ki', 2.0))}f;
+const float SPEED_PID_KD = {float(config.get('encoders.kd', 0.0))}f;
+const int SPEED_TRIM_LIMIT = {config.get('encoders.trim_limit', 60)};
+
+// Tracking Configuration
+const int TRACKING_MIN_DUTY = {config.get('tracking.min_duty', 90)};
+const int TRACKING_MAX_DUTY = {config.get('tracking.max_duty', 200)};
+const int TRACKING_DEAD_BAND = {config.get('tracking.dead_band', 50)};
+const int TRACKING_GAIN_PERCENT = {config.get('tracking.gain_percent', 100)};
+const int TRACKER_RATE_HZ = {config.get('tracking.controller.rate_hz', 50)};
+const int TRACKER_ENTER_BAND = {config.get('tracking.controller.enter_band', 100)};
+const int TRACKER_EXIT_BAND = {config.get('tracking.controller.exit_band', 50)};
+const int TRACKER_MIN_CONFIDENCE = {config.get('tracking.controller.min_confidence', 40)};
+const unsigned long TRACKER_PREDICT_MS = {config.get('tracking.controller.predict_ms', 200)};
+const unsigned long TRACKER_LOST_MS = {config.get('tracking.controller.lost_ms', 400)};
+
+// Firmware Task Configuration
+const int MOTOR_TASK_CORE = {config.get('firmware.motor_task_core', 1)};
+const int MOTOR_TASK_PRIORITY = {config.get('firmware.motor_task_priority', 5)};
+const int COMMAND_QUEUE_DEPTH = {config.get('firmware.command_queue_depth', 16)};
+const unsigned long COMMAND_LEASE_MS = {config.get('firmware.command_lease_ms', 500)};
+const int PWM_SKEW_BENCHMARK_ITERATIONS = {config.get('firmware.pwm_skew_benchmark_iterations', 0)};
+const int LOG_TASK_CORE = {config.get('firmware.log_task_core', 0)};
+const int LOG_TASK_PRIORITY = {config.get('firmware.log_task_priority', 1)};
+const int NETWORK_CORE = {network_core};
+const int NETWORK_TASK_PRIORITY = {network_priority};
+const int SERVICE_TASK_CORE = {config.get('firmware.service_task_core', 0)};
+const int SERVICE_TASK_PRIORITY = {config.get('firmware.service_task_priority', 1)};
+const unsigned long SERVICE_PERIOD_MS = {config.get('firmware.service_period_ms', 10)};
+const int RECORDER_ENTRIES = {config.get('firmware.recorder_entries', 256)};
+#define FIRMWARE_LOG_LEVEL LOG_LEVEL_{log_level}  // see car_log.h
+
+// Control Arbitration (priority per source: ws, control, hand_gesture, person_tracking, udp)
+const int SOURCE_PRIORITIES[5] = {{{', '.join(str(config.get(f'arbiter.priorities.{name}', default)) for name, default in [('ws', 3), ('control', 2), ('hand_gesture', 1), ('person_tracking', 1), ('udp', 2)])}}};
+const unsigned long ARBITER_LEASE_MS = {config.get('arbiter.lease_ms', 1000)};
+
+// Telemetry Configuration
+const int TELEMETRY_RATE_HZ = {config.get('telemetry.rate_hz', 20)};
+const int TELEMETRY_BATCH_SAMPLES = {config.get('telemetry.batch_samples', 5)};
+
+// UDP Fast-Path Configuration
+const int UDP_COMMAND_PORT = {config.get('udp.command_port', 4210)};
+const unsigned long UDP_SESSION_TIMEOUT_MS = {config.get('udp.session_timeout_ms', 1000)};
+
+// Timestamped Command Batches
+const unsigned long JITTER_PLAYOUT_DELAY_MS = {config.get('batch.playout_delay_ms', 60)};
+const unsigned long JITTER_WINDOW_MS = {config.get('batch.window_ms', 2000)};
+const unsigned long JITTER_SESSION_TIMEOUT_MS = {config.get('batch.session_timeout_ms', 1000)};
+
+// Onboard Camera (ESP32-CAM builds)
+#define SMARTCAR_CAMERA {1 if camera_enabled else 0}
+#define CAMERA_MODEL CAMERA_MODEL_{camera_model}  // see camera_pins.h
+const char* const CAMERA_FRAME_SIZE = "{config.get('camera.frame_size', 'vga')}";
+const int CAMERA_FPS = {config.get('camera.fps', 15)};
+const int CAMERA_JPEG_QUALITY = {config.get('camera.jpeg_quality', 12)};
+const int CAMERA_STREAM_PORT = {config.get('camera.stream_port', 81)};
+const int CAMERA_TASK_CORE = {config.get('camera.task_core', 0)};
+const int CAMERA_TASK_PRIORITY = {config.get('camera.task_priority', 1)};
+
+// Runtime Calibration (POST /calibration bearer token; empty disables the endpoint)
+const char* const CALIBRATION_TOKEN = "{config.get('calibration.token', '')}";
 
 // System Configuration
 const bool ENABLE_DEBUG_OUTPUT = {str(config.get('system.enable_debug_output', True)).lower()};
@@ -53,7 +178,9 @@ const bool ENABLE_DEBUG_OUTPUT = {str(config.get('system.enable_debug_output', T
     try:
         with open(config_file_path, 'w') as f:
             f.write(header_content)
-        print(f"✅ Arduino configuration generated: {config_file_path}")
+        with open("build_opt.h", 'w') as f:
+            f.write(build_options)
+        print(f"✅ Arduino configuration generated: {config_file_path}, build_opt.h")
         return True
     except Exception as e:
         print(f"❌ Error generating Arduino configuration: {e}")
@@ -0,0 +1,84 @@
+/*
+ * Thin hardware abstraction for the control logic
+ *
+ * The motor task, ramps, encoders, battery monitor, arbiter, logger and
+ * calibration store only reach the hardware through these calls.
+ * hal_esp32.cpp implements them with LEDC, PCNT, the ADC, NVS, esp_timer
+ * and FreeRTOS; host/hal_mock.cpp
+ * implements them on a simulated clock for the host build, recording
+ * every channel write.
+ *
+ * The web server, WebSockets, UDP and WiFi stay in the device-only files
+ * and reach the control logic through command_ingress.h.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Clock
+uint32_t halMillis();
+uint32_t halMicros();
+int64_t halMicros64();  // never wraps
+void halDelayMicros(uint32_t micros);
+uint32_t halRandom();
+
+// Motor output: LEDC channels on timers in one speed mode. A duty written
+// with halPwmSetDuty() is only output after halPwmUpdate(), at the next
+// period boundary of the channel's timer.
+void halPwmConfigureTimer(int timer, uint32_t frequency, uint8_t resolution);
+void halPwmAttach(int channel, int pin, int timer);
+void halPwmBindTimer(int channel, int timer);
+void halPwmSetDuty(int channel, uint32_t duty);
+void halPwmUpdate(int channel);
+
+// Read back a pin that a peripheral is driving
+void halPinEnableReadback(int pin);
+bool halPinRead(int pin);
+
+// Wheel encoders: one counter unit per wheel; pinB -1 counts rising edges
+// of pinA only
+void halEncoderSetup(int unit, int pinA, int pinB, uint16_t filterCycles);
+int halEncoderTake(int unit);  // counts since the previous call
+
+// Battery sense: one ADC1 input converted continuously into a DMA ring,
+// so sampling costs no CPU time. Take averages whatever arrived since the
+// previous call, in millivolts at the pin; false if nothing did.
+bool halAdcStart(int pin, uint32_t sampleRateHz);
+bool halAdcTakeMillivolts(uint32_t &millivolts);
+
+// Logging sink for formatted lines
+void halLogOutput(const char *text, size_t length);
+
+// Non-volatile settings: binary blobs by namespace and key. Read returns
+// the stored size (0 if missing); writes may block for flash.
+size_t halSettingsRead(const char *space, const char *key, void *data, size_t size);
+bool halSettingsWrite(const char *space, const char *key, const void *data, size_t size);
+void halSettingsErase(const char *space, const char *key);
+
+// Tasks, notifications and timers. Notification bits are or-ed together
+// until the task waits for them.
+typedef void *HalTask;
+typedef void *HalTimer;
+typedef void (*HalTaskFunction)(void *parameter);
+typedef void (*HalTimerCallback)(void *arg);
+
+#define HAL_WAIT_FOREVER UINT32_MAX
+
+void halStartTask(HalTaskFunction function, const char *name, uint32_t stackSize, int priority, int core,
+                  HalTask *handle);
+void halNotify(HalTask task, uint32_t bits);
+uint32_t halWaitForNotify(uint32_t timeoutMillis);  // bits, or 0 on timeout
+void halSleepMillis(uint32_t millis);
+
+// Core a task (by name) is pinned to; -1 if it floats or does not exist
+int halTaskCore(const char *name);
+
+HalTimer halTimerCreate(HalTimerCallback callback, const char *name);
+void halTimerStartOnce(HalTimer timer, uint64_t delayMicros);
+void halTimerStartPeriodic(HalTimer timer, uint64_t periodMicros);
+void halTimerStop(HalTimer timer);
+
+#endif // HAL_H
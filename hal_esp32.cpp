@@ -0,0 +1,319 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <driver/adc.h>
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <driver/pcnt.h>
+#include <esp_adc_cal.h>
+#include <esp_timer.h>
+#include <soc/io_mux_reg.h>
+
+#include "hal.h"
+
+#define PWM_MODE LEDC_HIGH_SPEED_MODE
+
+uint32_t halMillis()
+{
+  return millis();
+}
+
+uint32_t halMicros()
+{
+  return micros();
+}
+
+int64_t halMicros64()
+{
+  return esp_timer_get_time();
+}
+
+void halDelayMicros(uint32_t micros)
+{
+  delayMicroseconds(micros);
+}
+
+uint32_t halRandom()
+{
+  return esp_random();
+}
+
+void halPwmConfigureTimer(int timer, uint32_t frequency, uint8_t resolution)
+{
+  ledc_timer_config_t config = {};
+  config.speed_mode = PWM_MODE;
+  config.duty_resolution = (ledc_timer_bit_t)resolution;
+  config.timer_num = (ledc_timer_t)timer;
+  config.freq_hz = frequency;
+  config.clk_cfg = LEDC_AUTO_CLK;
+  ledc_timer_config(&config);
+}
+
+void halPwmAttach(int channel, int pin, int timer)
+{
+  ledc_channel_config_t config = {};
+  config.gpio_num = pin;
+  config.speed_mode = PWM_MODE;
+  config.channel = (ledc_channel_t)channel;
+  config.intr_type = LEDC_INTR_DISABLE;
+  config.timer_sel = (ledc_timer_t)timer;
+  config.duty = 0;
+  config.hpoint = 0;
+  ledc_channel_config(&config);
+}
+
+void halPwmBindTimer(int channel, int timer)
+{
+  ledc_bind_channel_timer(PWM_MODE, (ledc_channel_t)channel, (ledc_timer_t)timer);
+}
+
+void halPwmSetDuty(int channel, uint32_t duty)
+{
+  ledc_set_duty(PWM_MODE, (ledc_channel_t)channel, duty);
+}
+
+void halPwmUpdate(int channel)
+{
+  ledc_update_duty(PWM_MODE, (ledc_channel_t)channel);
+}
+
+void halPinEnableReadback(int pin)
+{
+  PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[pin]);
+}
+
+bool halPinRead(int pin)
+{
+  return gpio_get_level((gpio_num_t)pin) != 0;
+}
+
+void halEncoderSetup(int unit, int pinA, int pinB, uint16_t filterCycles)
+{
+  bool quadrature = pinB >= 0;
+  pcnt_config_t config = {};
+
+  // Quadrature counts both edges of A with B giving the direction;
+  // single-channel encoders count rising edges of A only
+  config.pulse_gpio_num = pinA;
+  config.ctrl_gpio_num = quadrature ? pinB : PCNT_PIN_NOT_USED;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = (pcnt_unit_t)unit;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = quadrature ? PCNT_COUNT_DEC : PCNT_COUNT_DIS;
+  config.lctrl_mode = quadrature ? PCNT_MODE_REVERSE : PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = INT16_MAX;
+  config.counter_l_lim = INT16_MIN;
+  pcnt_unit_config(&config);
+
+  pcnt_set_filter_value((pcnt_unit_t)unit, filterCycles);
+  pcnt_filter_enable((pcnt_unit_t)unit);
+  pcnt_counter_pause((pcnt_unit_t)unit);
+  pcnt_counter_clear((pcnt_unit_t)unit);
+  pcnt_counter_resume((pcnt_unit_t)unit);
+}
+
+// An edge landing between read and clear is lost
+int halEncoderTake(int unit)
+{
+  int16_t count = 0;
+
+  pcnt_get_counter_value((pcnt_unit_t)unit, &count);
+  pcnt_counter_clear((pcnt_unit_t)unit);
+  return count;
+}
+
+// ADC1 conversions go into the driver's ring by DMA (I2S0 on the ESP32)
+static int adcChannel = -1;
+static esp_adc_cal_characteristics_t adcCharacteristics;
+
+bool halAdcStart(int pin, uint32_t sampleRateHz)
+{
+  int channel = digitalPinToAnalogChannel(pin);
+  if (channel < 0 || channel >= ADC1_CHANNEL_MAX)
+  {
+    return false;
+  }
+
+  adc_digi_init_config_t init = {};
+  init.max_store_buf_size = 4096;  // > 50 ms of samples at 20 kHz
+  init.conv_num_each_intr = 256;
+  init.adc1_chan_mask = BIT(channel);
+  if (adc_digi_initialize(&init) != ESP_OK)
+  {
+    return false;
+  }
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_11;
+  pattern.channel = channel;
+  pattern.unit = 0;  // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t config = {};
+  config.conv_limit_en = true;
+  config.conv_limit_num = 250;
+  config.pattern_num = 1;
+  config.adc_pattern = &pattern;
+  config.sample_freq_hz = sampleRateHz;
+  config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if (adc_digi_controller_configure(&config) != ESP_OK)
+  {
+    return false;
+  }
+
+  esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcCharacteristics);
+  adcChannel = channel;
+  return adc_digi_start() == ESP_OK;
+}
+
+// Never blocks; an overflowed ring (ESP_ERR_INVALID_STATE) still returns data
+bool halAdcTakeMillivolts(uint32_t &millivolts)
+{
+  static uint8_t buffer[256];
+  uint32_t sum = 0;
+  uint32_t count = 0;
+  uint32_t length = 0;
+
+  if (adcChannel < 0)
+  {
+    return false;
+  }
+
+  esp_err_t result;
+  while ((result = adc_digi_read_bytes(buffer, sizeof(buffer), &length, 0)) == ESP_OK ||
+         result == ESP_ERR_INVALID_STATE)
+  {
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES)
+    {
+      const adc_digi_output_data_t *sample = (const adc_digi_output_data_t *)&buffer[i];
+      if (sample->type1.channel == adcChannel)
+      {
+        sum += sample->type1.data;
+        count++;
+      }
+    }
+    if (length == 0)
+    {
+      break;
+    }
+  }
+
+  if (count == 0)
+  {
+    return false;
+  }
+  millivolts = esp_adc_cal_raw_to_voltage(sum / count, &adcCharacteristics);
+  return true;
+}
+
+void halLogOutput(const char *text, size_t length)
+{
+  Serial.write((const uint8_t *)text, length);
+}
+
+size_t halSettingsRead(const char *space, const char *key, void *data, size_t size)
+{
+  Preferences preferences;
+  size_t length = 0;
+
+  if (preferences.begin(space, true))
+  {
+    length = preferences.getBytesLength(key);
+    length = length <= size ? preferences.getBytes(key, data, size) : 0;
+    preferences.end();
+  }
+  return length;
+}
+
+bool halSettingsWrite(const char *space, const char *key, const void *data, size_t size)
+{
+  Preferences preferences;
+  bool written = false;
+
+  if (preferences.begin(space, false))
+  {
+    written = preferences.putBytes(key, data, size) == size;
+    preferences.end();
+  }
+  return written;
+}
+
+void halSettingsErase(const char *space, const char *key)
+{
+  Preferences preferences;
+
+  if (preferences.begin(space, false))
+  {
+    preferences.remove(key);
+    preferences.end();
+  }
+}
+
+void halStartTask(HalTaskFunction function, const char *name, uint32_t stackSize, int priority, int core,
+                  HalTask *handle)
+{
+  xTaskCreatePinnedToCore(function, name, stackSize, nullptr, priority, (TaskHandle_t *)handle, core);
+}
+
+void halNotify(HalTask task, uint32_t bits)
+{
+  xTaskNotify((TaskHandle_t)task, bits, eSetBits);
+}
+
+uint32_t halWaitForNotify(uint32_t timeoutMillis)
+{
+  uint32_t bits = 0;
+  TickType_t ticks = portMAX_DELAY;
+
+  // Round up so the wait never ends before the timeout has passed
+  if (timeoutMillis != HAL_WAIT_FOREVER)
+  {
+    ticks = timeoutMillis > 0 ? pdMS_TO_TICKS(timeoutMillis) + 1 : 0;
+  }
+  xTaskNotifyWait(0, UINT32_MAX, &bits, ticks);
+  return bits;
+}
+
+void halSleepMillis(uint32_t millis)
+{
+  vTaskDelay(pdMS_TO_TICKS(millis));
+}
+
+int halTaskCore(const char *name)
+{
+  TaskHandle_t task = xTaskGetHandle(name);
+  if (task == nullptr)
+  {
+    return -1;
+  }
+
+  BaseType_t core = xTaskGetAffinity(task);
+  return core == tskNO_AFFINITY ? -1 : (int)core;
+}
+
+HalTimer halTimerCreate(HalTimerCallback callback, const char *name)
+{
+  esp_timer_create_args_t args = {};
+  esp_timer_handle_t timer = nullptr;
+
+  args.callback = callback;
+  args.name = name;
+  esp_timer_create(&args, &timer);
+  return timer;
+}
+
+void halTimerStartOnce(HalTimer timer, uint64_t delayMicros)
+{
+  esp_timer_start_once((esp_timer_handle_t)timer, delayMicros);
+}
+
+void halTimerStartPeriodic(HalTimer timer, uint64_t periodMicros)
+{
+  esp_timer_start_periodic((esp_timer_handle_t)timer, periodMicros);
+}
+
+void halTimerStop(HalTimer timer)
+{
+  esp_timer_stop((esp_timer_handle_t)timer);
+}
@@ -0,0 +1,183 @@
+// Deterministic latency and throughput of the command path on the mock HAL.
+//
+// Latency is simulated time from a command being received to its channels
+// latching (first output change) and to them reaching their final duty,
+// with commands arriving at pseudo-random points in the PWM period. As
+// the mock charges no time for code, this is the latency the firmware's
+// scheduling adds: LEDC latch alignment, staged start and ramps.
+//
+// Throughput counts channel writes per command, which is fixed for a given
+// firmware, plus a wall-clock figure for the host CPU for reference only.
+//
+// Usage: bench_motor_path [iterations]
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "arduino_config.h"
+#include "command_ingress.h"
+#include "flight_recorder.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+#define SETTLE_WINDOW_MICROS 450000
+
+struct LatencySamples
+{
+  const char *name;
+  std::vector<uint64_t> latchMicros;
+  std::vector<uint64_t> settleMicros;
+};
+
+static uint64_t percentile(std::vector<uint64_t> values, int percent)
+{
+  if (values.empty())
+  {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+static void report(const LatencySamples &samples)
+{
+  printf("%-12s latch p50 %6llu us p99 %6llu us max %6llu us | settle p50 %6llu us p99 %6llu us max %6llu us\n",
+         samples.name, (unsigned long long)percentile(samples.latchMicros, 50),
+         (unsigned long long)percentile(samples.latchMicros, 99),
+         (unsigned long long)percentile(samples.latchMicros, 100),
+         (unsigned long long)percentile(samples.settleMicros, 50),
+         (unsigned long long)percentile(samples.settleMicros, 99),
+         (unsigned long long)percentile(samples.settleMicros, 100));
+}
+
+static void stopCar()
+{
+  submitCarMovement(STOP, SOURCE_WS, halMicros());
+  simRun(100000);
+}
+
+// Submit one command at a random phase and time its outputs
+static void measure(LatencySamples &samples, const uint8_t *frame, size_t len)
+{
+  stopCar();
+  simRun(halRandom() % (1000000 / MOTOR_PWM_FREQUENCY));
+  mockClearRecords();
+
+  uint64_t received = mockNow();
+  CarCommand command;
+  ingestBinaryFrame(SOURCE_CONTROL_WS, frame, len, halMicros(), command);
+  simRun(SETTLE_WINDOW_MICROS);
+
+  uint64_t firstLatch = 0;
+  uint64_t lastLatch = 0;
+  for (const ChannelWrite &write : mockChannelWrites())
+  {
+    firstLatch = firstLatch == 0 ? write.latchMicros : std::min(firstLatch, write.latchMicros);
+    lastLatch = std::max(lastLatch, write.latchMicros);
+  }
+  samples.latchMicros.push_back(firstLatch - received);
+  samples.settleMicros.push_back(lastLatch - received);
+}
+
+static void benchLatency(int iterations)
+{
+  LatencySamples drive = {"drive"};
+  LatencySamples staged = {"staged_up"};
+  LatencySamples duty = {"motor_duty"};
+  LatencySamples turn = {"turn_rate"};
+
+  for (int i = 0; i < iterations; i++)
+  {
+    const uint8_t driveFrame[] = {PROTO_OP_COMMAND, 0, 0, DOWN};
+    measure(drive, driveFrame, sizeof(driveFrame));
+
+    const uint8_t stagedFrame[] = {PROTO_OP_COMMAND, 0, 0, UP};
+    measure(staged, stagedFrame, sizeof(stagedFrame));
+
+    const uint8_t dutyFrame[] = {PROTO_OP_MOTOR_DUTY, 0, 0, 200, 0, 200, 0, 200, 0, 200, 0};
+    measure(duty, dutyFrame, sizeof(dutyFrame));
+
+    const uint8_t turnFrame[] = {PROTO_OP_TURN, 0, 0, 0xF4, 0x01};  // 500
+    measure(turn, turnFrame, sizeof(turnFrame));
+  }
+
+  report(drive);
+  report(staged);
+  report(duty);
+  report(turn);
+
+  // Unstaged commands reach the outputs within one PWM period
+  CHECK(percentile(drive.latchMicros, 100) <= 1000000 / MOTOR_PWM_FREQUENCY);
+  CHECK(percentile(duty.latchMicros, 100) <= 1000000 / MOTOR_PWM_FREQUENCY);
+  CHECK(percentile(turn.latchMicros, 100) <= 1000000 / MOTOR_PWM_FREQUENCY);
+  // Instant commands settle on that same edge
+  CHECK_EQUAL(percentile(duty.latchMicros, 100), percentile(duty.settleMicros, 100));
+}
+
+// Commands that change every channel, back to back with no ramp ticks between
+static void benchThroughput(int iterations)
+{
+  const int commands = iterations * 100;
+  stopCar();
+  mockClearRecords();
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < commands; i++)
+  {
+    int16_t sign = i % 2 == 0 ? 1 : -1;
+    uint8_t frame[PROTO_HEADER_SIZE + MOTOR_COUNT * 2] = {PROTO_OP_MOTOR_DUTY, (uint8_t)i, (uint8_t)(i >> 8)};
+    for (int motor = 0; motor < MOTOR_COUNT; motor++)
+    {
+      uint16_t value = (uint16_t)(sign * 150);
+      frame[PROTO_HEADER_SIZE + motor * 2] = value & 0xFF;
+      frame[PROTO_HEADER_SIZE + motor * 2 + 1] = value >> 8;
+    }
+    CarCommand command;
+    ingestBinaryFrame(SOURCE_CONTROL_WS, frame, sizeof(frame), halMicros(), command);
+    simSettle();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+  double writesPerCommand = (double)mockChannelWrites().size() / commands;
+  printf("throughput   %d commands, %.2f channel writes per command, host %.0f ns per command\n", commands,
+         writesPerCommand, (double)elapsed.count() / commands);
+
+  // A direct reversal writes each channel of each motor once
+  CHECK(writesPerCommand <= MOTOR_CHANNEL_COUNT);
+  stopCar();
+}
+
+// Host CPU cost of one flight recorder entry, for reference only
+static void benchRecorder(int iterations)
+{
+  const int entries = iterations * 1000;
+  CarCommand command = {};
+  int16_t duty[MOTOR_COUNT] = {};
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < entries; i++)
+  {
+    command.sequence = i;
+    duty[i % MOTOR_COUNT] = i;
+    recordEvent(RECORD_APPLIED, command, duty);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+  printf("recorder     %d entries, host %.1f ns per entry\n", entries, (double)elapsed.count() / entries);
+  CHECK(recorderCount() >= (uint32_t)entries);
+}
+
+int main(int argc, char **argv)
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 100;
+
+  simBegin();
+  benchLatency(iterations);
+  benchThroughput(iterations);
+  benchRecorder(iterations);
+  return testResult("bench_motor_path");
+}
@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <memory>
+
+#include "hal_mock.h"
+
+#define MOCK_TIMER_COUNT 4
+#define MOCK_CHANNEL_COUNT 16
+#define MOCK_ENCODER_COUNT 8
+
+struct MockTask
+{
+  std::string name;
+  uint32_t bits;
+  int core;
+};
+
+struct MockTimer
+{
+  HalTimerCallback callback;
+  std::string name;
+  bool running;
+  bool periodic;
+  uint64_t dueMicros;
+  uint64_t periodMicros;
+};
+
+static uint64_t nowMicros = 0;
+static uint32_t randomState = 1;
+
+static uint32_t timerPeriodMicros[MOCK_TIMER_COUNT];
+static int channelTimer[MOCK_CHANNEL_COUNT];
+static uint32_t channelDuty[MOCK_CHANNEL_COUNT];
+static int channelPins[MOCK_CHANNEL_COUNT];
+static int encoderCounts[MOCK_ENCODER_COUNT];
+static uint32_t adcMillivolts = 0;
+
+static std::vector<ChannelWrite> channelWrites;
+static std::vector<std::string> logLines;
+static std::vector<std::unique_ptr<MockTask>> tasks;
+static std::vector<std::unique_ptr<MockTimer>> timers;
+static std::map<std::string, std::string> settings;
+
+uint64_t mockNow()
+{
+  return nowMicros;
+}
+
+void mockSetNow(uint64_t micros)
+{
+  nowMicros = micros;
+}
+
+const std::vector<ChannelWrite> &mockChannelWrites()
+{
+  return channelWrites;
+}
+
+const std::vector<std::string> &mockLogLines()
+{
+  return logLines;
+}
+
+void mockClearRecords()
+{
+  channelWrites.clear();
+  logLines.clear();
+}
+
+uint32_t mockPwmPeriodMicros(int channel)
+{
+  return timerPeriodMicros[channelTimer[channel]];
+}
+
+uint32_t mockChannelDutyAt(int channel, uint64_t micros)
+{
+  uint32_t duty = 0;
+
+  for (const ChannelWrite &write : channelWrites)
+  {
+    if (write.channel == channel && write.latchMicros <= micros)
+    {
+      duty = write.duty;
+    }
+  }
+  return duty;
+}
+
+void mockSetEncoderCounts(int unit, int counts)
+{
+  encoderCounts[unit] = counts;
+}
+
+void mockSetAdcMillivolts(uint32_t millivolts)
+{
+  adcMillivolts = millivolts;
+}
+
+HalTask mockTaskNamed(const char *name)
+{
+  for (const std::unique_ptr<MockTask> &task : tasks)
+  {
+    if (task->name == name)
+    {
+      return task.get();
+    }
+  }
+  return nullptr;
+}
+
+uint32_t mockTakeNotify(HalTask task)
+{
+  if (task == nullptr)
+  {
+    return 0;
+  }
+
+  MockTask *mockTask = (MockTask *)task;
+  uint32_t bits = mockTask->bits;
+  mockTask->bits = 0;
+  return bits;
+}
+
+bool mockNextTimerDue(uint64_t &dueMicros)
+{
+  bool found = false;
+
+  for (const std::unique_ptr<MockTimer> &timer : timers)
+  {
+    if (timer->running && (!found || timer->dueMicros < dueMicros))
+    {
+      dueMicros = timer->dueMicros;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void mockFireTimers()
+{
+  for (const std::unique_ptr<MockTimer> &timer : timers)
+  {
+    if (!timer->running || timer->dueMicros > nowMicros)
+    {
+      continue;
+    }
+
+    if (timer->periodic)
+    {
+      timer->dueMicros += timer->periodMicros;
+    }
+    else
+    {
+      timer->running = false;
+    }
+    timer->callback(nullptr);
+  }
+}
+
+uint32_t halMillis()
+{
+  return (uint32_t)(nowMicros / 1000);
+}
+
+uint32_t halMicros()
+{
+  return (uint32_t)nowMicros;
+}
+
+int64_t halMicros64()
+{
+  return (int64_t)nowMicros;
+}
+
+void halDelayMicros(uint32_t micros)
+{
+  nowMicros += micros;
+}
+
+uint32_t halRandom()
+{
+  // Fixed-seed LCG so runs are reproducible
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState;
+}
+
+void halPwmConfigureTimer(int timer, uint32_t frequency, uint8_t resolution)
+{
+  timerPeriodMicros[timer] = 1000000 / frequency;
+}
+
+void halPwmAttach(int channel, int pin, int timer)
+{
+  channelPins[channel] = pin;
+  channelTimer[channel] = timer;
+  channelDuty[channel] = 0;
+}
+
+void halPwmBindTimer(int channel, int timer)
+{
+  channelTimer[channel] = timer;
+}
+
+void halPwmSetDuty(int channel, uint32_t duty)
+{
+  channelDuty[channel] = duty;
+}
+
+void halPwmUpdate(int channel)
+{
+  // Takes effect when the channel's timer next overflows
+  uint64_t period = timerPeriodMicros[channelTimer[channel]];
+  uint64_t latch = period > 0 ? (nowMicros / period + 1) * period : nowMicros;
+  channelWrites.push_back(ChannelWrite{nowMicros, latch, channel, channelDuty[channel]});
+}
+
+void halPinEnableReadback(int pin)
+{
+}
+
+bool halPinRead(int pin)
+{
+  for (int channel = 0; channel < MOCK_CHANNEL_COUNT; channel++)
+  {
+    if (channelPins[channel] == pin)
+    {
+      return mockChannelDutyAt(channel, nowMicros) > 0;
+    }
+  }
+  return false;
+}
+
+void halEncoderSetup(int unit, int pinA, int pinB, uint16_t filterCycles)
+{
+  encoderCounts[unit] = 0;
+}
+
+int halEncoderTake(int unit)
+{
+  int counts = encoderCounts[unit];
+  encoderCounts[unit] = 0;
+  return counts;
+}
+
+bool halAdcStart(int pin, uint32_t sampleRateHz)
+{
+  return true;
+}
+
+bool halAdcTakeMillivolts(uint32_t &millivolts)
+{
+  millivolts = adcMillivolts;
+  return millivolts > 0;
+}
+
+void halLogOutput(const char *text, size_t length)
+{
+  std::string line(text, length);
+  while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+  {
+    line.pop_back();
+  }
+  logLines.push_back(line);
+}
+
+static std::string settingsKey(const char *space, const char *key)
+{
+  return std::string(space) + "/" + key;
+}
+
+size_t halSettingsRead(const char *space, const char *key, void *data, size_t size)
+{
+  auto found = settings.find(settingsKey(space, key));
+  if (found == settings.end() || found->second.size() > size)
+  {
+    return 0;
+  }
+  memcpy(data, found->second.data(), found->second.size());
+  return found->second.size();
+}
+
+bool halSettingsWrite(const char *space, const char *key, const void *data, size_t size)
+{
+  settings[settingsKey(space, key)] = std::string((const char *)data, size);
+  return true;
+}
+
+void halSettingsErase(const char *space, const char *key)
+{
+  settings.erase(settingsKey(space, key));
+}
+
+void halStartTask(HalTaskFunction function, const char *name, uint32_t stackSize, int priority, int core,
+                  HalTask *handle)
+{
+  tasks.emplace_back(new MockTask{name, 0, core});
+  if (handle != nullptr)
+  {
+    *handle = tasks.back().get();
+  }
+}
+
+void halNotify(HalTask task, uint32_t bits)
+{
+  ((MockTask *)task)->bits |= bits;
+}
+
+uint32_t halWaitForNotify(uint32_t timeoutMillis)
+{
+  // Task bodies are stepped by the test, never entered
+  fprintf(stderr, "halWaitForNotify: tasks do not run on the host\n");
+  abort();
+}
+
+void halSleepMillis(uint32_t millis)
+{
+  nowMicros += (uint64_t)millis * 1000;
+}
+
+int halTaskCore(const char *name)
+{
+  MockTask *task = (MockTask *)mockTaskNamed(name);
+  return task != nullptr ? task->core : -1;
+}
+
+HalTimer halTimerCreate(HalTimerCallback callback, const char *name)
+{
+  timers.emplace_back(new MockTimer{callback, name, false, false, 0, 0});
+  return timers.back().get();
+}
+
+// Like esp_timer, starting a timer that is already running is refused
+void halTimerStartOnce(HalTimer timer, uint64_t delayMicros)
+{
+  MockTimer *mockTimer = (MockTimer *)timer;
+  if (mockTimer->running)
+  {
+    return;
+  }
+  mockTimer->running = true;
+  mockTimer->periodic = false;
+  mockTimer->dueMicros = nowMicros + delayMicros;
+}
+
+void halTimerStartPeriodic(HalTimer timer, uint64_t periodMicros)
+{
+  MockTimer *mockTimer = (MockTimer *)timer;
+  if (mockTimer->running)
+  {
+    return;
+  }
+  mockTimer->running = true;
+  mockTimer->periodic = true;
+  mockTimer->periodMicros = periodMicros;
+  mockTimer->dueMicros = nowMicros + periodMicros;
+}
+
+void halTimerStop(HalTimer timer)
+{
+  ((MockTimer *)timer)->running = false;
+}
@@ -0,0 +1,57 @@
+/*
+ * Host implementation of hal.h
+ *
+ * Time only moves when a test moves it. Channel writes latch at the next
+ * period boundary of their LEDC timer, exactly like ledc_update_duty(),
+ * and every latch is recorded with the time it takes effect. Tasks never
+ * run on their own: notification bits collect until a test takes them,
+ * and timers fire only from mockFireTimers().
+ */
+
+#ifndef HAL_MOCK_H
+#define HAL_MOCK_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "hal.h"
+
+struct ChannelWrite
+{
+  uint64_t writtenMicros;  // when halPwmUpdate() was called
+  uint64_t latchMicros;    // when the output changes
+  int channel;
+  uint32_t duty;
+};
+
+uint64_t mockNow();
+void mockSetNow(uint64_t micros);
+
+// Recorded channel writes and log lines since the last clear
+const std::vector<ChannelWrite> &mockChannelWrites();
+const std::vector<std::string> &mockLogLines();
+void mockClearRecords();
+
+// Period of the LEDC timer the channel runs on
+uint32_t mockPwmPeriodMicros(int channel);
+
+// Duty the channel outputs at the given time
+uint32_t mockChannelDutyAt(int channel, uint64_t micros);
+
+// Counts the next halEncoderTake() of the unit returns
+void mockSetEncoderCounts(int unit, int counts);
+
+// Pin voltage halAdcTakeMillivolts() returns from now on; 0 for no samples
+void mockSetAdcMillivolts(uint32_t millivolts);
+
+HalTask mockTaskNamed(const char *name);
+uint32_t mockTakeNotify(HalTask task);
+
+// Earliest running timer deadline; false when no timer is running
+bool mockNextTimerDue(uint64_t &dueMicros);
+
+// Run the callbacks of every timer due at mockNow(), rearming periodic ones
+void mockFireTimers();
+
+#endif // HAL_MOCK_H
@@ -0,0 +1,92 @@
+#include "calibration.h"
+#include "car_log.h"
+#include "motor_control.h"
+#include "sim.h"
+
+static HalTask motorTask = nullptr;
+static bool wakeScheduled = false;
+static uint64_t wakeMicros = 0;
+
+void simBegin()
+{
+  loadCalibration();
+  setUpPinModes();
+  startMotorTask();
+  motorTask = mockTaskNamed("motor");
+  simSettle();
+}
+
+// What the task's halWaitForNotify() would time out on
+static void scheduleWake()
+{
+  uint32_t timeout = motorTaskTimeoutMillis();
+
+  wakeScheduled = timeout != HAL_WAIT_FOREVER;
+  wakeMicros = mockNow() + (uint64_t)timeout * 1000;
+}
+
+void simSettle()
+{
+  for (;;)
+  {
+    uint32_t events = mockTakeNotify(motorTask);
+    if (events == 0 && !(wakeScheduled && wakeMicros <= mockNow()))
+    {
+      break;
+    }
+    runMotorTaskOnce(events);
+    scheduleWake();
+  }
+  flushLogs();
+}
+
+void simRun(uint64_t micros)
+{
+  uint64_t end = mockNow() + micros;
+
+  simSettle();
+  for (;;)
+  {
+    uint64_t next = end;
+    uint64_t due = 0;
+    if (mockNextTimerDue(due) && due < next)
+    {
+      next = due;
+    }
+    if (wakeScheduled && wakeMicros < next)
+    {
+      next = wakeMicros;
+    }
+
+    if (next > mockNow())
+    {
+      mockSetNow(next);
+    }
+    mockFireTimers();
+    simSettle();
+
+    if (next >= end)
+    {
+      break;
+    }
+  }
+}
+
+void simStopCar(uint64_t settleMicros)
+{
+  submitCarMovement(STOP, SOURCE_WS, halMicros());
+  simRun(settleMicros);
+  mockClearRecords();
+}
+
+bool simAnyChannelDriving()
+{
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (mockChannelDutyAt(channel, mockNow()) > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
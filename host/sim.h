@@ -0,0 +1,37 @@
+/*
+ * Deterministic stepping of the firmware's control side on the mock HAL
+ *
+ * Stands in for the FreeRTOS scheduler: the motor task is run whenever it
+ * has notification bits or its lease timeout is due, timers fire as
+ * simulated time passes, and the log ring is drained after every pass.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include "arduino_config.h"
+#include "hal_mock.h"
+
+// Set up the pins and the motor task; once per process
+void simBegin();
+
+// Run the motor task until nothing is pending at the current time
+void simSettle();
+
+// Move simulated time forward, handling timers and lease timeouts on the way
+void simRun(uint64_t micros);
+
+// Long enough for any command or control ownership lease to run out
+#define SIM_STOP_SETTLE_MICROS \
+  (((COMMAND_LEASE_MS > ARBITER_LEASE_MS ? COMMAND_LEASE_MS : ARBITER_LEASE_MS) + 100) * 1000ULL)
+
+// Stop the car from the joystick, wait for the leases to run out and
+// start the mock's write records afresh
+void simStopCar(uint64_t settleMicros = SIM_STOP_SETTLE_MICROS);
+
+// Whether any motor PWM channel has a non-zero duty now
+bool simAnyChannelDriving();
+
+#endif // SIM_H
@@ -0,0 +1,133 @@
+// No heap allocation on the command path: every transport callback and
+// the motor task passes that apply the command, ramp and expire the lease
+// run without calling operator new once warmed up.
+
+#include <stdlib.h>
+#include <new>
+
+#include "arduino_config.h"
+#include "command_ingress.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+static bool counting = false;
+static long allocations = 0;
+
+void *operator new(size_t size)
+{
+  if (counting)
+  {
+    allocations++;
+  }
+  void *memory = malloc(size > 0 ? size : 1);
+  if (memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+// Motor task passes over whatever is pending, firing timers up to the
+// given time; unlike simRun() this does not drain the logs, whose mock
+// sink stores strings
+static void runMotorTask(HalTask task, uint64_t untilMicros)
+{
+  for (;;)
+  {
+    uint32_t events = mockTakeNotify(task);
+    if (events != 0 || motorTaskTimeoutMillis() == 0)
+    {
+      runMotorTaskOnce(events);
+      continue;
+    }
+
+    uint64_t dueMicros;
+    if (!mockNextTimerDue(dueMicros) || dueMicros > untilMicros)
+    {
+      break;
+    }
+    mockSetNow(dueMicros);
+    mockFireTimers();
+  }
+  mockSetNow(untilMicros);
+}
+
+// One of everything a client can send, then long enough for ramps to
+// finish and the lease to expire
+static void sendCommands(HalTask task)
+{
+  static const uint8_t command[] = {PROTO_OP_COMMAND, 1, 0, UP};
+  static const uint8_t duty[] = {PROTO_OP_MOTOR_DUTY, 2, 0, 100, 0, 100, 0, 0x9C, 0xFF, 0x9C, 0xFF};
+  static const uint8_t turn[] = {PROTO_OP_TURN, 3, 0, 0xF4, 0x01};
+  static const uint8_t gesture[] = {PROTO_OP_GESTURE, 4, 0, PROTO_GESTURE_LEFT};
+  static const uint8_t observe[] = {PROTO_OP_OBSERVE, 5, 0, 0x2C, 0x01, 200, 0, 90, 0x10, 0x27, 0, 0};
+  static const uint8_t ping[] = {PROTO_OP_PING, 6, 0};
+  static const uint8_t text[] = "9";
+  CarCommand decoded;
+  uint64_t now = mockNow();
+
+  ingestBinaryFrame(SOURCE_CONTROL_WS, command, sizeof(command), halMicros(), decoded);
+  runMotorTask(task, now += 100000);
+  ingestBinaryFrame(SOURCE_CONTROL_WS, duty, sizeof(duty), halMicros(), decoded);
+  runMotorTask(task, now += 100000);
+  ingestBinaryFrame(SOURCE_CONTROL_WS, turn, sizeof(turn), halMicros(), decoded);
+  runMotorTask(task, now += 100000);
+  ingestBinaryFrame(SOURCE_CONTROL_WS, gesture, sizeof(gesture), halMicros(), decoded);
+  ingestBinaryFrame(SOURCE_CONTROL_WS, ping, sizeof(ping), halMicros(), decoded);
+  runMotorTask(task, now += 100000);
+  ingestBinaryFrame(SOURCE_CONTROL_WS, observe, sizeof(observe), halMicros(), decoded);
+  runMotorTask(task, now += 100000);
+  ingestTextFrame(SOURCE_WS, text, 1, halMicros(), decoded);
+  runMotorTask(task, now += 100000);
+  ingestGesture("right", halMicros());
+  ingestTrackingError(-300, halMicros());
+  ingestTrackingAction("track_center", halMicros());
+  runMotorTask(task, now += 100000);
+  ingestDisconnect(SOURCE_WS, halMicros());
+  runMotorTask(task, now += 2000000);
+}
+
+int main()
+{
+  simBegin();
+  HalTask task = mockTaskNamed("motor");
+
+  // First round grows the mock's records and any lazily built state
+  sendCommands(task);
+  simSettle();
+  mockClearRecords();
+
+  counting = true;
+  sendCommands(task);
+  counting = false;
+  simSettle();
+
+  CHECK_EQUAL(0, allocations);
+  return testResult("test_allocations");
+}
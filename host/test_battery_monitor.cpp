@@ -0,0 +1,111 @@
+// Battery compensation: the filter, the duty scale at and below nominal,
+// its cap, the low-battery soft limit with hysteresis, full-PWM clipping
+// and a missing divider.
+
+#include "arduino_config.h"
+#include "calibration.h"
+#include "battery_monitor.h"
+#include "command_ingress.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+// Enough readings for the filter to settle exactly on the new voltage
+static void settleAt(uint32_t packMillivolts)
+{
+  for (int i = 0; i < 200; i++)
+  {
+    batteryAddReading(packMillivolts, BATTERY_UPDATE_MS);
+  }
+  simSettle();
+}
+
+static void driveAll(int duty)
+{
+  const uint8_t frame[] = {PROTO_OP_MOTOR_DUTY, 0, 0, (uint8_t)duty, 0, (uint8_t)duty, 0, (uint8_t)duty, 0,
+                           (uint8_t)duty, 0};
+  CarCommand command;
+  ingestBinaryFrame(SOURCE_WS, frame, sizeof(frame), halMicros(), command);
+  simSettle();
+}
+
+// Every motor's driving input outputs this duty. The scale only follows
+// the filter in steps of 1/256, so allow one duty step either way.
+static bool outputsAre(int duty)
+{
+  for (int motor = 0; motor < MOTOR_COUNT; motor++)
+  {
+    int in = activeCalibration().directionCorrection[motor] > 0 ? motor * 2 : motor * 2 + 1;
+    int output = (int)mockChannelDutyAt(in, mockNow() + 10000);
+    if (output < duty - 1 || output > duty + 1 || mockChannelDutyAt(in ^ 1, mockNow() + 10000) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void testCompensation()
+{
+  settleAt(BATTERY_NOMINAL_MV);
+  BatteryStats stats = getBatteryStats();
+  CHECK_EQUAL(BATTERY_NOMINAL_MV, stats.millivolts);
+  CHECK_EQUAL(BATTERY_OK, stats.state);
+  CHECK_EQUAL(1000, stats.scalePermille);
+
+  driveAll(100);
+  CHECK(outputsAre(100));
+
+  // 7400 / 6800 more duty for the same motor voltage
+  settleAt(6800);
+  CHECK(getBatteryStats().scalePermille >= 1084 && getBatteryStats().scalePermille <= 1092);
+  CHECK(outputsAre(109));
+
+  // Already at full PWM, so nothing is left to compensate with
+  driveAll(250);
+  CHECK(outputsAre(255));
+}
+
+static void testLowBatteryLimit()
+{
+  settleAt(6800);
+  driveAll(100);
+  uint32_t lowEvents = getBatteryStats().lowEvents;
+
+  // Compensation capped at BATTERY_MAX_COMPENSATION, then the soft limit
+  settleAt(5000);
+  BatteryStats stats = getBatteryStats();
+  CHECK_EQUAL(BATTERY_LOW, stats.state);
+  CHECK_EQUAL(lowEvents + 1, stats.lowEvents);
+  CHECK(outputsAre(78));
+
+  // Within the hysteresis the limit stays
+  settleAt(6700);
+  CHECK_EQUAL(BATTERY_LOW, getBatteryStats().state);
+  CHECK(outputsAre(66));
+
+  settleAt(6900);
+  CHECK_EQUAL(BATTERY_OK, getBatteryStats().state);
+  CHECK_EQUAL(lowEvents + 1, getBatteryStats().lowEvents);
+  CHECK(outputsAre(107));
+}
+
+// A reading that low means nothing is connected: outputs are left alone
+static void testAbsentDivider()
+{
+  settleAt(6800);
+  driveAll(100);
+  settleAt(500);
+  CHECK_EQUAL(BATTERY_ABSENT, getBatteryStats().state);
+  CHECK_EQUAL(1000, getBatteryStats().scalePermille);
+  CHECK(outputsAre(100));
+}
+
+int main()
+{
+  simBegin();
+  testCompensation();
+  testLowBatteryLimit();
+  testAbsentDivider();
+  return testResult("test_battery_monitor");
+}
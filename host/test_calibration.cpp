@@ -0,0 +1,171 @@
+// Runtime calibration: request parsing and validation, live apply by the
+// motor task, and the NVS blob surviving a reboot only when it is intact.
+
+#include <string.h>
+#include <string>
+
+#include "arduino_config.h"
+#include "calibration.h"
+#include "car_log.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+static bool logged(const char *text)
+{
+  for (const std::string &line : mockLogLines())
+  {
+    if (line.find(text) != std::string::npos)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void testParseAndValidate()
+{
+  Calibration calibration = defaultCalibration();
+  CHECK(validateCalibration(calibration) == nullptr);
+
+  CHECK(parseCalibrationField(calibration, "direction_correction", "1,-1,1,-1"));
+  CHECK_EQUAL(-1, calibration.directionCorrection[1]);
+  CHECK_EQUAL(-1, calibration.directionCorrection[3]);
+  CHECK(parseCalibrationField(calibration, "startup_offsets", "0,10,20,30"));
+  CHECK_EQUAL(30, calibration.startupOffsets[3]);
+  CHECK(parseCalibrationField(calibration, "max_speed", "1000"));
+  CHECK(parseCalibrationField(calibration, "pwm_resolution", "10"));
+  CHECK(parseCalibrationField(calibration, "pwm_frequency", "5000"));
+  CHECK(validateCalibration(calibration) == nullptr);
+
+  // Malformed values leave the field alone
+  CHECK(!parseCalibrationField(calibration, "direction_correction", "1,1,1"));
+  CHECK(!parseCalibrationField(calibration, "direction_correction", "1,1,1,1,"));
+  CHECK(!parseCalibrationField(calibration, "max_speed", "fast"));
+  CHECK(!parseCalibrationField(calibration, "max_speed", "-5"));
+  CHECK(!parseCalibrationField(calibration, "gain", "1"));
+  CHECK_EQUAL(1000, calibration.maxSpeed);
+
+  Calibration bad = defaultCalibration();
+  bad.directionCorrection[2] = 0;
+  CHECK(validateCalibration(bad) != nullptr);
+
+  bad = defaultCalibration();
+  bad.maxSpeed = 1 << bad.pwmResolution;
+  CHECK(validateCalibration(bad) != nullptr);
+
+  // The LEDC divider cannot reach these
+  bad = defaultCalibration();
+  bad.pwmResolution = 16;
+  bad.maxSpeed = 1000;
+  bad.pwmFrequency = 5000;
+  CHECK(validateCalibration(bad) != nullptr);
+  bad.pwmFrequency = 1;
+  CHECK(validateCalibration(bad) != nullptr);
+
+  bad = defaultCalibration();
+  bad.maxSpeed = TRACKING_MAX_DUTY - 1;
+  CHECK(validateCalibration(bad) != nullptr);
+
+  char text[256];
+  formatCalibration(text, sizeof(text), calibration);
+  CHECK(strstr(text, "direction_correction 1,-1,1,-1\n") != nullptr);
+  CHECK(strstr(text, "pwm_frequency 5000\n") != nullptr);
+}
+
+static void testLiveApply()
+{
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun(400000);
+  CHECK(simAnyChannelDriving());
+
+  Calibration calibration = defaultCalibration();
+  calibration.directionCorrection[FRONT_RIGHT_MOTOR] = -calibration.directionCorrection[FRONT_RIGHT_MOTOR];
+  calibration.pwmResolution = 10;
+  calibration.maxSpeed = 1000;
+  calibration.pwmFrequency = 2000;
+  CHECK(submitCalibration(calibration));
+  CHECK(!submitCalibration(calibration));  // one at a time
+
+  // Applied on the next pass: stopped within a period, without a ramp, and retimed
+  simSettle();
+  CHECK(sameCalibration(calibration, activeCalibration()));
+  Calibration held = calibrationSnapshot();  // what the endpoints read
+  CHECK(sameCalibration(calibration, held));
+  simRun(1000000 / MOTOR_PWM_FREQUENCY);
+  CHECK(!simAnyChannelDriving());
+  CHECK_EQUAL(500, mockPwmPeriodMicros(0));
+  CHECK_EQUAL(500, mockPwmPeriodMicros(MOTOR_CHANNEL_COUNT - 1));
+
+  // The front right motor now drives its other input, at the new full duty
+  int frontRightIn1 = FRONT_RIGHT_MOTOR * 2;
+  bool in1Forward = BACKWARD * calibration.directionCorrection[FRONT_RIGHT_MOTOR] == FORWARD;
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun(400000);
+  CHECK_EQUAL(in1Forward ? 1000 : 0, mockChannelDutyAt(frontRightIn1, mockNow()));
+  CHECK_EQUAL(in1Forward ? 0 : 1000, mockChannelDutyAt(frontRightIn1 + 1, mockNow()));
+  CHECK_EQUAL(in1Forward ? 1000 : 0, motionForCommand(DOWN).duty[frontRightIn1]);
+
+  simStopCar();
+}
+
+static void testPersistence()
+{
+  Calibration stored = activeCalibration();
+  serviceCalibration();
+
+  uint8_t blob[64];
+  size_t size = halSettingsRead("calib", "motors", blob, sizeof(blob));
+  CHECK(size > sizeof(Calibration));
+
+  // Reboot: the stored values come back
+  Calibration defaults = defaultCalibration();
+  loadCalibration();
+  CHECK(sameCalibration(stored, activeCalibration()));
+
+  // A flipped bit or another version falls back to the defaults
+  blob[size - 1] ^= 0x01;
+  halSettingsWrite("calib", "motors", blob, size);
+  mockClearRecords();
+  loadCalibration();
+  flushLogs();
+  CHECK(sameCalibration(defaults, activeCalibration()));
+  CHECK(sameCalibration(defaults, calibrationSnapshot()));
+  CHECK(logged("corrupt"));
+
+  blob[size - 1] ^= 0x01;
+  blob[0] = CALIBRATION_BLOB_VERSION + 1;
+  halSettingsWrite("calib", "motors", blob, size);
+  loadCalibration();
+  CHECK(sameCalibration(defaults, activeCalibration()));
+
+  // Going back to the defaults erases the blob
+  blob[0] = CALIBRATION_BLOB_VERSION;
+  halSettingsWrite("calib", "motors", blob, size);
+  loadCalibration();
+  CHECK(sameCalibration(stored, activeCalibration()));
+  CHECK(submitCalibration(defaults));
+  simSettle();
+  serviceCalibration();
+  CHECK_EQUAL(0, halSettingsRead("calib", "motors", blob, sizeof(blob)));
+}
+
+static void testToken()
+{
+  // No token configured: the endpoint stays closed
+  CHECK_EQUAL(0, strlen(CALIBRATION_TOKEN));
+  CHECK(!calibrationTokenMatches(""));
+  CHECK(!calibrationTokenMatches("secret"));
+  CHECK(!calibrationTokenMatches(nullptr));
+}
+
+int main()
+{
+  simBegin();
+  testParseAndValidate();
+  testLiveApply();
+  testPersistence();
+  testToken();
+  return testResult("test_calibration");
+}
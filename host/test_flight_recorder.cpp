@@ -0,0 +1,179 @@
+// Flight recorder: what gets recorded for commands, lease expiries and
+// stops, ring wrap-around and the binary dump.
+
+#include <string.h>
+#include <vector>
+
+#include "arduino_config.h"
+#include "calibration.h"
+#include "command_ingress.h"
+#include "control_arbiter.h"
+#include "flight_recorder.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+static RecorderEntry lastEntry()
+{
+  RecorderEntry entry = {};
+  CHECK(recorderEntry(recorderCount() - 1, entry));
+  return entry;
+}
+
+// The signed per-motor targets a motion table row drives towards
+static bool dutyMatches(const RecorderEntry &entry, int command)
+{
+  const MotionRow &row = motionForCommand(command);
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    int target = (row.duty[i * 2] - row.duty[i * 2 + 1]) * activeCalibration().directionCorrection[i];
+    if (entry.duty[i] != target)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void testRecordsCommands()
+{
+  simStopCar();
+  uint32_t before = recorderCount();
+
+  uint32_t received = halMicros();
+  const uint8_t frame[] = {PROTO_OP_COMMAND, 0x34, 0x12, UP};
+  CarCommand command;
+  ingestBinaryFrame(SOURCE_CONTROL_WS, frame, sizeof(frame), received, command);
+  simSettle();
+  CHECK_EQUAL(before + 1, recorderCount());
+
+  RecorderEntry entry = lastEntry();
+  CHECK_EQUAL(before, entry.number);
+  CHECK_EQUAL(RECORD_APPLIED, entry.kind);
+  CHECK_EQUAL(SOURCE_CONTROL_WS, entry.source);
+  CHECK_EQUAL(PROTO_OP_COMMAND, entry.opcode);
+  CHECK_EQUAL(UP, entry.command);
+  CHECK_EQUAL(0x1234, entry.sequence);
+  CHECK_EQUAL(received, entry.receivedMicros);
+  CHECK(entry.doneMicros >= received);
+  // Motors still waiting for their staged start show where they are heading
+  CHECK(dutyMatches(entry, UP));
+
+  ingestBinaryFrame(SOURCE_CONTROL_WS, frame, sizeof(frame), halMicros(), command);
+  simSettle();
+  CHECK_EQUAL(RECORD_REPEATED, lastEntry().kind);
+
+  // The vision host owns control, so a gesture is turned away
+  submitCarMovement(HAND_LEFT_RAISED, SOURCE_HTTP_GESTURE, halMicros());
+  simSettle();
+  entry = lastEntry();
+  CHECK_EQUAL(RECORD_REJECTED, entry.kind);
+  CHECK_EQUAL(SOURCE_HTTP_GESTURE, entry.source);
+  CHECK(dutyMatches(entry, UP));
+}
+
+static void testStops()
+{
+  simStopCar();
+  uint32_t received = halMicros();
+  submitCarMovement(DOWN, SOURCE_WS, received);
+  simRun((COMMAND_LEASE_MS + 10) * 1000);
+  RecorderEntry entry = lastEntry();
+  CHECK_EQUAL(RECORD_LEASE_EXPIRED, entry.kind);
+  CHECK_EQUAL(SOURCE_WS, entry.source);
+  CHECK_EQUAL(DOWN, entry.command);
+  CHECK_EQUAL(received, entry.receivedMicros);
+  CHECK(dutyMatches(entry, STOP));
+
+  simStopCar();
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simSettle();
+  ingestDisconnect(SOURCE_WS, halMicros());
+  simSettle();
+  entry = lastEntry();
+  CHECK_EQUAL(RECORD_DISCONNECT_STOP, entry.kind);
+  CHECK_EQUAL(SOURCE_WS, entry.source);
+  CHECK_EQUAL(STOP, entry.command);
+
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simSettle();
+  requestMotorStop();
+  simSettle();
+  entry = lastEntry();
+  CHECK_EQUAL(RECORD_STOP_REQUESTED, entry.kind);
+  CHECK_EQUAL(OWNER_NONE, entry.source);
+  CHECK(dutyMatches(entry, STOP));
+}
+
+static std::vector<uint8_t> dumpInPieces(const RecorderDump &dump, size_t piece)
+{
+  std::vector<uint8_t> bytes(recorderDumpSize(dump));
+  size_t offset = 0;
+
+  while (offset < bytes.size())
+  {
+    size_t written = encodeRecorderDump(dump, offset, bytes.data() + offset, std::min(piece, bytes.size() - offset));
+    CHECK(written > 0);
+    offset += written;
+  }
+  return bytes;
+}
+
+static uint32_t readUint32(const uint8_t *data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void testDump()
+{
+  CarCommand command = {};
+  command.source = SOURCE_UDP;
+  command.opcode = PROTO_OP_MOTOR_DUTY;
+  const int16_t duty[MOTOR_COUNT] = {100, -100, 255, -255};
+  for (int i = 0; i < RECORDER_ENTRIES + 10; i++)
+  {
+    command.sequence = i;
+    recordEvent(RECORD_APPLIED, command, duty);
+  }
+
+  // The ring holds the newest entries, oldest first
+  RecorderDump dump = startRecorderDump();
+  CHECK_EQUAL(RECORDER_ENTRIES, dump.count);
+  CHECK_EQUAL(recorderCount() - RECORDER_ENTRIES, dump.first);
+  RecorderEntry entry;
+  CHECK(!recorderEntry(dump.first - 1, entry));
+
+  std::vector<uint8_t> whole = dumpInPieces(dump, recorderDumpSize(dump));
+  CHECK(whole == dumpInPieces(dump, 7));
+  CHECK_EQUAL(RECORDER_HEADER_SIZE + RECORDER_ENTRIES * RECORDER_ENTRY_SIZE, whole.size());
+  CHECK_EQUAL(RECORDER_FORMAT_VERSION, whole[0]);
+  CHECK_EQUAL(RECORDER_ENTRY_SIZE, whole[1]);
+  CHECK_EQUAL(RECORDER_ENTRIES, whole[2] | (whole[3] << 8));
+  CHECK_EQUAL(recorderCount(), readUint32(&whole[4]));
+
+  const uint8_t *last = &whole[RECORDER_HEADER_SIZE + (RECORDER_ENTRIES - 1) * RECORDER_ENTRY_SIZE];
+  CHECK_EQUAL(recorderCount() - 1, readUint32(last));
+  CHECK_EQUAL(RECORD_APPLIED, last[4]);
+  CHECK_EQUAL(SOURCE_UDP, last[5]);
+  CHECK_EQUAL(PROTO_OP_MOTOR_DUTY, last[6]);
+  CHECK_EQUAL(RECORDER_ENTRIES + 9, last[8] | (last[9] << 8));
+  CHECK_EQUAL(-255, (int16_t)(last[24] | (last[25] << 8)));
+
+  // An entry overwritten before it was sent is marked lost
+  recordEvent(RECORD_APPLIED, command, duty);
+  uint8_t first[RECORDER_ENTRY_SIZE];
+  encodeRecorderDump(dump, RECORDER_HEADER_SIZE, first, sizeof(first));
+  CHECK_EQUAL(dump.first, readUint32(first));
+  CHECK_EQUAL(RECORD_LOST, first[4]);
+}
+
+int main()
+{
+  simBegin();
+  testRecordsCommands();
+  testStops();
+  testDump();
+  return testResult("test_flight_recorder");
+}
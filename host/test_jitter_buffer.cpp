@@ -0,0 +1,244 @@
+// Timestamped batches: decoding, play-out at the sent spacing however the
+// batch arrived, late and stale commands, underruns, overflow, a new
+// sender clock and disconnects.
+
+#include <algorithm>
+#include <vector>
+
+#include "arduino_config.h"
+#include "command_ingress.h"
+#include "control_arbiter.h"
+#include "flight_recorder.h"
+#include "jitter_buffer.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+struct BatchBuilder
+{
+  std::vector<uint8_t> bytes;
+
+  explicit BatchBuilder(uint16_t sequence)
+    : bytes{PROTO_OP_BATCH, (uint8_t)(sequence & 0xFF), (uint8_t)(sequence >> 8)}
+  {
+  }
+
+  void item(uint32_t senderMillis, uint8_t opcode)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      bytes.push_back((senderMillis >> (i * 8)) & 0xFF);
+    }
+    bytes.push_back(opcode);
+  }
+
+  BatchBuilder &command(uint32_t senderMillis, uint8_t id)
+  {
+    item(senderMillis, PROTO_OP_COMMAND);
+    bytes.push_back(id);
+    return *this;
+  }
+
+  BatchBuilder &turn(uint32_t senderMillis, int rate)
+  {
+    item(senderMillis, PROTO_OP_TURN);
+    bytes.push_back(rate & 0xFF);
+    bytes.push_back(((uint16_t)rate) >> 8);
+    return *this;
+  }
+};
+
+// The sender's clock runs this far ahead of the car's
+static const uint32_t SENDER_OFFSET_MS = 50000;
+
+static uint32_t senderNow()
+{
+  return (uint32_t)(mockNow() / 1000) + SENDER_OFFSET_MS;
+}
+
+static IngressResult deliver(const BatchBuilder &batch)
+{
+  CarCommand command;
+  IngressResult result =
+    ingestBinaryFrame(SOURCE_CONTROL_WS, batch.bytes.data(), batch.bytes.size(), halMicros(), command);
+  simSettle();
+  return result;
+}
+
+// Stopping also has to outlast the batch session, so each test starts a new baseline
+static const uint64_t STOP_SETTLE_MICROS =
+  std::max<uint64_t>(SIM_STOP_SETTLE_MICROS, (JITTER_SESSION_TIMEOUT_MS + 100) * 1000ULL);
+
+static void testDecode()
+{
+  CommandBatch batch;
+
+  BatchBuilder valid(9);
+  valid.command(1000, UP).turn(1020, -300);
+  valid.item(1040, PROTO_OP_GESTURE);
+  valid.bytes.push_back(PROTO_GESTURE_LEFT);
+  CHECK(decodeCommandBatch(valid.bytes.data(), valid.bytes.size(), batch));
+  CHECK_EQUAL(3, batch.count);
+  CHECK_EQUAL(1020, batch.senderMillis[1]);
+  CHECK_EQUAL(UP, batch.commands[0].command);
+  CHECK_EQUAL(-300, batch.commands[1].turnRate);
+  CHECK_EQUAL(PROTO_OP_COMMAND, batch.commands[2].opcode);
+  CHECK_EQUAL(HAND_LEFT_RAISED, batch.commands[2].command);
+  CHECK_EQUAL(9, batch.commands[2].sequence);
+
+  BatchBuilder empty(1);
+  CHECK(!decodeCommandBatch(empty.bytes.data(), empty.bytes.size(), batch));
+
+  BatchBuilder truncated(1);
+  truncated.turn(1000, 100);
+  CHECK(!decodeCommandBatch(truncated.bytes.data(), truncated.bytes.size() - 1, batch));
+
+  BatchBuilder notMotion(1);
+  notMotion.item(1000, PROTO_OP_PING);
+  CHECK(!decodeCommandBatch(notMotion.bytes.data(), notMotion.bytes.size(), batch));
+
+  BatchBuilder tooMany(1);
+  for (int i = 0; i <= BATCH_MAX_COMMANDS; i++)
+  {
+    tooMany.command(1000 + i, UP);
+  }
+  CHECK(!decodeCommandBatch(tooMany.bytes.data(), tooMany.bytes.size(), batch));
+  CHECK_EQUAL(INGRESS_MALFORMED, deliver(tooMany));
+}
+
+// Commands taken 10 ms apart arrive together and still run 10 ms apart,
+// the newest one JITTER_PLAYOUT_DELAY_MS after it arrived
+static void testPlaysAtSentSpacing()
+{
+  simStopCar(STOP_SETTLE_MICROS);
+  uint32_t sent = senderNow();
+  uint64_t arrived = mockNow();
+  uint32_t before = recorderCount();
+  CHECK_EQUAL(INGRESS_QUEUED, deliver(BatchBuilder(1).command(sent - 30, UP).command(sent - 20, DOWN)
+                                        .command(sent - 10, UP).command(sent, DOWN)));
+  CHECK_EQUAL(before, recorderCount());
+  CHECK_EQUAL(4, getJitterStats().depth);
+
+  simRun((JITTER_PLAYOUT_DELAY_MS + 5) * 1000);
+  CHECK_EQUAL(before + 4, recorderCount());
+  const uint8_t expected[] = {UP, DOWN, UP, DOWN};
+  for (int i = 0; i < 4; i++)
+  {
+    RecorderEntry entry;
+    CHECK(recorderEntry(before + i, entry));
+    CHECK_EQUAL(RECORD_APPLIED, entry.kind);
+    CHECK_EQUAL(SOURCE_CONTROL_WS, entry.source);
+    CHECK_EQUAL(expected[i], entry.command);
+    CHECK_EQUAL((uint32_t)arrived, entry.receivedMicros);
+    CHECK_EQUAL((uint32_t)(arrived + (JITTER_PLAYOUT_DELAY_MS - 30 + i * 10) * 1000), entry.doneMicros);
+  }
+  CHECK_EQUAL(0, getJitterStats().depth);
+}
+
+static void testLateAndStale()
+{
+  simStopCar(STOP_SETTLE_MICROS);
+  uint32_t sent = senderNow();
+  deliver(BatchBuilder(1).command(sent - 10, UP).command(sent, DOWN));
+  simRun((JITTER_PLAYOUT_DELAY_MS + 5) * 1000);
+
+  // The next batch is held up well past the playout delay: it runs at
+  // once, and finding the buffer empty counts as an underrun
+  JitterStats before = getJitterStats();
+  simRun((JITTER_PLAYOUT_DELAY_MS + 200) * 1000);
+  uint32_t recorded = recorderCount();
+  deliver(BatchBuilder(2).command(sent + 10, UP).command(sent + 20, DOWN));
+  CHECK_EQUAL(recorded + 2, recorderCount());
+  JitterStats after = getJitterStats();
+  CHECK_EQUAL(before.late + 2, after.late);
+  CHECK_EQUAL(before.underruns + 1, after.underruns);
+  CHECK_EQUAL(before.stale, after.stale);
+
+  // One that is older than a command already played is dropped
+  deliver(BatchBuilder(3).command(sent + 15, UP));
+  CHECK_EQUAL(recorded + 2, recorderCount());
+  CHECK_EQUAL(after.stale + 1, getJitterStats().stale);
+}
+
+static void testOverflow()
+{
+  simStopCar(STOP_SETTLE_MICROS);
+  uint32_t sent = senderNow();
+  JitterStats before = getJitterStats();
+
+  for (int batch = 0; batch < 3; batch++)
+  {
+    BatchBuilder frame(batch);
+    for (int i = 0; i < BATCH_MAX_COMMANDS; i++)
+    {
+      frame.command(sent + batch * BATCH_MAX_COMMANDS + i, i % 2 == 0 ? UP : DOWN);
+    }
+    deliver(frame);
+  }
+
+  JitterStats after = getJitterStats();
+  CHECK_EQUAL(JITTER_BUFFER_SLOTS, after.depth);
+  CHECK_EQUAL(before.overflows + 3 * BATCH_MAX_COMMANDS - JITTER_BUFFER_SLOTS, after.overflows);
+}
+
+// After a pause the baseline starts over, so a sender whose clock jumped
+// back is not taken for a very late one
+static void testNewSession()
+{
+  simStopCar(STOP_SETTLE_MICROS);
+  uint32_t sent = senderNow() - 30000;
+  JitterStats before = getJitterStats();
+  uint32_t recorded = recorderCount();
+
+  deliver(BatchBuilder(1).command(sent, UP));
+  CHECK_EQUAL(recorded, recorderCount());
+  simRun((JITTER_PLAYOUT_DELAY_MS + 5) * 1000);
+  CHECK_EQUAL(recorded + 1, recorderCount());
+  CHECK_EQUAL(before.late, getJitterStats().late);
+}
+
+static void testDisconnectDropsBuffered()
+{
+  simStopCar(STOP_SETTLE_MICROS);
+  uint32_t sent = senderNow();
+  deliver(BatchBuilder(1).command(sent - 10, UP).command(sent, DOWN));
+  ingestDisconnect(SOURCE_CONTROL_WS, halMicros());
+  simSettle();
+  CHECK_EQUAL(0, getJitterStats().depth);
+
+  uint32_t recorded = recorderCount();
+  simRun((JITTER_PLAYOUT_DELAY_MS + 5) * 1000);
+  CHECK_EQUAL(recorded, recorderCount());
+
+  // So does a stop requested outside the queues
+  sent = senderNow();
+  deliver(BatchBuilder(2).command(sent, UP));
+  requestMotorStop();
+  simSettle();
+  CHECK_EQUAL(0, getJitterStats().depth);
+
+  // Even when the batch is still queued for the motor task
+  sent = senderNow();
+  recorded = recorderCount();
+  BatchBuilder queued(3);
+  queued.command(sent - 10, UP).command(sent, DOWN);
+  CarCommand command;
+  CHECK_EQUAL(INGRESS_QUEUED, ingestBinaryFrame(SOURCE_CONTROL_WS, queued.bytes.data(), queued.bytes.size(),
+                                                halMicros(), command));
+  requestMotorStop();
+  simRun((JITTER_PLAYOUT_DELAY_MS + 5) * 1000);
+  CHECK_EQUAL(0, getJitterStats().depth);
+  CHECK_EQUAL(recorded + 1, recorderCount());  // only the stop itself
+}
+
+int main()
+{
+  simBegin();
+  testDecode();
+  testPlaysAtSentSpacing();
+  testLateAndStale();
+  testOverflow();
+  testNewSession();
+  testDisconnectDropsBuffered();
+  return testResult("test_jitter_buffer");
+}
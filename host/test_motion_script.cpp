@@ -0,0 +1,243 @@
+// Motion scripts: decoding, segment timing against the schedule, the car
+// stopping at the end, aborts and arbitration.
+
+#include <string>
+#include <vector>
+
+#include "arduino_config.h"
+#include "command_ingress.h"
+#include "control_arbiter.h"
+#include "motion_script.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+struct ScriptBuilder
+{
+  std::vector<uint8_t> bytes;
+
+  explicit ScriptBuilder(uint16_t id) : bytes{PROTO_OP_SCRIPT, (uint8_t)(id & 0xFF), (uint8_t)(id >> 8)} {}
+
+  void segment(uint16_t durationMs, uint8_t opcode)
+  {
+    bytes.push_back(durationMs & 0xFF);
+    bytes.push_back(durationMs >> 8);
+    bytes.push_back(opcode);
+  }
+
+  void int16(int value)
+  {
+    bytes.push_back(value & 0xFF);
+    bytes.push_back(((uint16_t)value) >> 8);
+  }
+
+  ScriptBuilder &command(uint16_t durationMs, uint8_t id)
+  {
+    segment(durationMs, PROTO_OP_COMMAND);
+    bytes.push_back(id);
+    return *this;
+  }
+
+  ScriptBuilder &duty(uint16_t durationMs, int frontRight, int backRight, int frontLeft, int backLeft)
+  {
+    segment(durationMs, PROTO_OP_MOTOR_DUTY);
+    int16(frontRight);
+    int16(backRight);
+    int16(frontLeft);
+    int16(backLeft);
+    return *this;
+  }
+
+  ScriptBuilder &turn(uint16_t durationMs, int rate)
+  {
+    segment(durationMs, PROTO_OP_TURN);
+    int16(rate);
+    return *this;
+  }
+};
+
+static IngressResult upload(uint8_t source, const ScriptBuilder &script)
+{
+  CarCommand command;
+  IngressResult result = ingestBinaryFrame(source, script.bytes.data(), script.bytes.size(), halMicros(), command);
+  simSettle();
+  return result;
+}
+
+static bool outputsMatch(int command)
+{
+  const MotionRow &row = motionForCommand(command);
+
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (mockChannelDutyAt(channel, mockNow()) != row.duty[channel])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Earliest time something was written at or after the given time
+static uint64_t firstWriteFrom(uint64_t micros)
+{
+  for (const ChannelWrite &write : mockChannelWrites())
+  {
+    if (write.writtenMicros >= micros)
+    {
+      return write.writtenMicros;
+    }
+  }
+  return 0;
+}
+
+static void testDecode()
+{
+  MotionScript script;
+
+  ScriptBuilder valid(7);
+  valid.command(1200, UP).turn(400, 500).duty(300, 100, -100, 100, -100);
+  CHECK(decodeMotionScript(valid.bytes.data(), valid.bytes.size(), script));
+  CHECK_EQUAL(7, script.id);
+  CHECK_EQUAL(3, script.count);
+  CHECK_EQUAL(1200, script.segments[0].durationMs);
+  CHECK_EQUAL(500, script.segments[1].turnRate);
+  CHECK_EQUAL(-100, script.segments[2].motorDuty[3]);
+
+  // Gestures are stored as the command they decode to
+  ScriptBuilder gesture(1);
+  gesture.segment(100, PROTO_OP_GESTURE);
+  gesture.bytes.push_back(PROTO_GESTURE_LEFT);
+  CHECK(decodeMotionScript(gesture.bytes.data(), gesture.bytes.size(), script));
+  CHECK_EQUAL(PROTO_OP_COMMAND, script.segments[0].opcode);
+  CHECK_EQUAL(HAND_LEFT_RAISED, script.segments[0].command);
+
+  CHECK(!decodeMotionScript(valid.bytes.data(), valid.bytes.size() - 1, script));
+  ScriptBuilder empty(1);
+  CHECK(!decodeMotionScript(empty.bytes.data(), empty.bytes.size(), script));
+  ScriptBuilder ping(1);
+  ping.segment(100, PROTO_OP_PING);
+  CHECK(!decodeMotionScript(ping.bytes.data(), ping.bytes.size(), script));
+  ScriptBuilder badCommand(1);
+  badCommand.command(100, LAST_COMMAND + 1);
+  CHECK(!decodeMotionScript(badCommand.bytes.data(), badCommand.bytes.size(), script));
+
+  ScriptBuilder tooLong(1);
+  for (int i = 0; i <= MOTION_SCRIPT_MAX_SEGMENTS; i++)
+  {
+    tooLong.command(10, DOWN);
+  }
+  CHECK(!decodeMotionScript(tooLong.bytes.data(), tooLong.bytes.size(), script));
+}
+
+static void testRunsOnSchedule()
+{
+  simStopCar();
+  ScriptBuilder script(21);
+  script.command(1200, DOWN).command(400, TURN_RIGHT).turn(300, -600);
+
+  uint64_t start = mockNow();
+  CHECK_EQUAL(INGRESS_QUEUED, upload(SOURCE_CONTROL_WS, script));
+  CHECK_EQUAL(SCRIPT_RUNNING, getScriptProgress().state);
+  CHECK_EQUAL(21, getScriptProgress().id);
+  CHECK_EQUAL(3, getScriptProgress().count);
+
+  // Well past the command lease: the script keeps driving on its own
+  simRun(1100000);
+  CHECK(outputsMatch(DOWN));
+  CHECK_EQUAL(0, getScriptProgress().segment);
+
+  // Segments switch exactly on the schedule
+  simRun(300000);
+  CHECK_EQUAL(1, getScriptProgress().segment);
+  CHECK_EQUAL(start + 1200000, firstWriteFrom(start + 1100000));
+  simRun(300000);
+  CHECK_EQUAL(2, getScriptProgress().segment);
+  CHECK_EQUAL(start + 1600000, firstWriteFrom(start + 1500000));
+
+  // The end stops the car and hands back control
+  simRun(200000);
+  CHECK_EQUAL(SCRIPT_DONE, getScriptProgress().state);
+  CHECK_EQUAL(OWNER_NONE, getControlState().owner);
+  simRun(400000);
+  CHECK(outputsMatch(STOP));
+}
+
+static void testStopAborts()
+{
+  simStopCar();
+  ScriptBuilder script(22);
+  script.command(2000, DOWN);
+  upload(SOURCE_CONTROL_WS, script);
+  simRun(300000);
+
+  requestMotorStop();
+  simSettle();
+  CHECK_EQUAL(SCRIPT_ABORTED, getScriptProgress().state);
+  simRun(400000);
+  CHECK(outputsMatch(STOP));
+
+  // A live command that wins arbitration takes over too
+  upload(SOURCE_CONTROL_WS, script);
+  simRun(300000);
+  submitCarMovement(TURN_LEFT, SOURCE_WS, halMicros());
+  simRun(400000);
+  CHECK_EQUAL(SCRIPT_ABORTED, getScriptProgress().state);
+  CHECK(outputsMatch(TURN_LEFT));
+}
+
+static void testArbitration()
+{
+  // The joystick outranks the vision host's script
+  simStopCar();
+  submitCarMovement(TURN_LEFT, SOURCE_WS, halMicros());
+  simRun(10000);
+  ScriptBuilder rejected(23);
+  rejected.command(500, DOWN);
+  upload(SOURCE_CONTROL_WS, rejected);
+  CHECK_EQUAL(SCRIPT_REJECTED, getScriptProgress().state);
+  CHECK_EQUAL(SOURCE_WS, getControlState().owner);
+
+  // A segment longer than the ownership lease still keeps lower sources out
+  simStopCar();
+  ScriptBuilder script(24);
+  script.command(ARBITER_LEASE_MS + 1000, DOWN).command(200, STOP);
+  upload(SOURCE_CONTROL_WS, script);
+  simRun((ARBITER_LEASE_MS + 500) * 1000);
+  submitCarMovement(HAND_RIGHT_RAISED, SOURCE_HTTP_GESTURE, halMicros());
+  simRun(10000);
+  CHECK_EQUAL(SCRIPT_RUNNING, getScriptProgress().state);
+  CHECK_EQUAL(SOURCE_CONTROL_WS, getControlState().owner);
+  CHECK(outputsMatch(DOWN));
+  simRun(1000000);
+  CHECK_EQUAL(SCRIPT_DONE, getScriptProgress().state);
+}
+
+static void testProgressEncoding()
+{
+  ScriptProgress progress = {0x1234, 3, 5, SCRIPT_RUNNING};
+  uint8_t frame[PROTO_SCRIPT_STATE_SIZE];
+  CHECK_EQUAL(PROTO_SCRIPT_STATE_SIZE, encodeScriptProgress(frame, progress));
+  CHECK_EQUAL(PROTO_OP_SCRIPT_STATE, frame[0]);
+  CHECK_EQUAL(0x34, frame[1]);
+  CHECK_EQUAL(0x12, frame[2]);
+  CHECK_EQUAL(3, frame[3]);
+  CHECK_EQUAL(5, frame[4]);
+  CHECK_EQUAL(SCRIPT_RUNNING, frame[5]);
+
+  char text[96];
+  formatScriptProgress(progress, text, sizeof(text));
+  CHECK(std::string(text) == "{\"script\":4660,\"segment\":3,\"segments\":5,\"state\":\"running\"}");
+}
+
+int main()
+{
+  simBegin();
+  testDecode();
+  testRunsOnSchedule();
+  testStopAborts();
+  testArbitration();
+  testProgressEncoding();
+  return testResult("test_motion_script");
+}
@@ -0,0 +1,176 @@
+// Regression test for the motion table: every command id against a
+// hand-written expectation, both as table rows and as the duties the
+// channels end up outputting once the command has been applied. Velocity
+// frames are checked against the same expectations.
+
+#include <string.h>
+
+#include "car_commands.h"
+#include "command_ingress.h"
+#include "mecanum_mix.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+struct ExpectedMotion
+{
+  int command;
+  const char *directions;  // FRONT_RIGHT BACK_RIGHT FRONT_LEFT BACK_LEFT: F, B or - for stopped
+  bool stagedStart;
+  uint8_t ramp;
+};
+
+static const ExpectedMotion EXPECTED_MOTIONS[] = {
+  {STOP, "----", false, RAMP_STOP},
+  {UP, "FFFF", true, RAMP_DRIVE},
+  {DOWN, "BBBB", false, RAMP_DRIVE},
+  {LEFT, "FBBF", false, RAMP_DRIVE},
+  {RIGHT, "BFFB", false, RAMP_DRIVE},
+  {UP_LEFT, "F--F", false, RAMP_DRIVE},
+  {UP_RIGHT, "-FF-", false, RAMP_DRIVE},
+  {DOWN_LEFT, "-BB-", false, RAMP_DRIVE},
+  {DOWN_RIGHT, "B--B", false, RAMP_DRIVE},
+  {TURN_LEFT, "FFBB", false, RAMP_TURN},
+  {TURN_RIGHT, "BBFF", false, RAMP_TURN},
+  {HAND_LEFT_RAISED, "FFFF", true, RAMP_DRIVE},
+  {HAND_RIGHT_RAISED, "BBBB", false, RAMP_DRIVE},
+  {HAND_BOTH_RAISED, "----", false, RAMP_DRIVE},
+  {HAND_NONE_RAISED, "----", false, RAMP_DRIVE},
+  {TRACK_LEFT, "FFBB", false, RAMP_TURN},
+  {TRACK_RIGHT, "BBFF", false, RAMP_TURN},
+  {TRACK_CENTER, "----", false, RAMP_TURN},
+};
+
+// Expected IN1/IN2 duty of a channel under the active calibration
+static int expectedDuty(const ExpectedMotion &motion, int channel)
+{
+  int motor = channel / 2;
+  int direction = motion.directions[motor] == 'F' ? FORWARD : motion.directions[motor] == 'B' ? BACKWARD : 0;
+  int corrected = direction * activeCalibration().directionCorrection[motor];
+  bool in1 = channel % 2 == 0;
+
+  if (corrected == 0)
+  {
+    return 0;
+  }
+  return (corrected == FORWARD) == in1 ? activeCalibration().maxSpeed : 0;
+}
+
+static void testTableRows()
+{
+  CHECK_EQUAL(LAST_COMMAND + 1, sizeof(EXPECTED_MOTIONS) / sizeof(EXPECTED_MOTIONS[0]));
+
+  for (const ExpectedMotion &motion : EXPECTED_MOTIONS)
+  {
+    const MotionRow &row = motionForCommand(motion.command);
+    CHECK_EQUAL(motion.stagedStart, row.stagedStart);
+    CHECK_EQUAL(motion.ramp, row.ramp);
+    for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+    {
+      CHECK_EQUAL(expectedDuty(motion, channel), row.duty[channel]);
+    }
+  }
+
+  // Unknown ids stop the car
+  CHECK(&motionForCommand(-1) == &motionForCommand(STOP));
+  CHECK(&motionForCommand(LAST_COMMAND + 1) == &motionForCommand(STOP));
+}
+
+static void testAppliedOutputs()
+{
+  for (const ExpectedMotion &motion : EXPECTED_MOTIONS)
+  {
+    submitCarMovement(STOP, SOURCE_WS, halMicros());
+    simRun(100000);
+
+    mockClearRecords();
+    submitCarMovement(motion.command, SOURCE_WS, halMicros());
+
+    // Staged start and the slowest ramp are done well inside the lease
+    simRun(450000);
+    for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+    {
+      CHECK_EQUAL(expectedDuty(motion, channel), mockChannelDutyAt(channel, mockNow()));
+    }
+  }
+}
+
+static void testMixing()
+{
+  int duty[MOTOR_COUNT];
+
+  // Half speed forward rounds to nearest
+  mixBodyVelocity({500, 0, 0}, 255, duty);
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    CHECK_EQUAL(128, duty[i]);
+  }
+
+  // One wheel would need three times full speed: all four scale together
+  mixBodyVelocity({1000, 1000, 1000}, 255, duty);
+  CHECK_EQUAL(-85, duty[FRONT_RIGHT_MOTOR]);
+  CHECK_EQUAL(85, duty[BACK_RIGHT_MOTOR]);
+  CHECK_EQUAL(255, duty[FRONT_LEFT_MOTOR]);
+  CHECK_EQUAL(85, duty[BACK_LEFT_MOTOR]);
+
+  // Out-of-range inputs saturate; a 16-bit duty range still fits
+  mixBodyVelocity({-30000, 0, 0}, 65535, duty);
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    CHECK_EQUAL(-65535, duty[i]);
+  }
+}
+
+// Unit velocities of the table's driving and turning rows
+struct VelocityMotion
+{
+  int command;
+  BodyVelocity velocity;
+};
+
+static const VelocityMotion VELOCITY_MOTIONS[] = {
+  {STOP, {0, 0, 0}},
+  {UP, {1000, 0, 0}},
+  {DOWN, {-1000, 0, 0}},
+  {LEFT, {0, -1000, 0}},
+  {RIGHT, {0, 1000, 0}},
+  {UP_LEFT, {1000, -1000, 0}},
+  {UP_RIGHT, {1000, 1000, 0}},
+  {DOWN_LEFT, {-1000, -1000, 0}},
+  {DOWN_RIGHT, {-1000, 1000, 0}},
+  {TURN_LEFT, {0, 0, -1000}},
+  {TURN_RIGHT, {0, 0, 1000}},
+};
+
+static void testVelocityFrames()
+{
+  for (const VelocityMotion &motion : VELOCITY_MOTIONS)
+  {
+    submitCarMovement(STOP, SOURCE_WS, halMicros());
+    simRun(100000);
+
+    const BodyVelocity &velocity = motion.velocity;
+    const uint8_t frame[] = {PROTO_OP_VELOCITY, 0, 0,
+                             (uint8_t)velocity.vx, (uint8_t)(velocity.vx >> 8),
+                             (uint8_t)velocity.vy, (uint8_t)(velocity.vy >> 8),
+                             (uint8_t)velocity.omega, (uint8_t)(velocity.omega >> 8)};
+    CarCommand command;
+    CHECK_EQUAL(INGRESS_QUEUED, ingestBinaryFrame(SOURCE_WS, frame, sizeof(frame), halMicros(), command));
+    simRun(450000);
+    for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+    {
+      CHECK_EQUAL(expectedDuty(EXPECTED_MOTIONS[motion.command], channel), mockChannelDutyAt(channel, mockNow()));
+    }
+  }
+}
+
+int main()
+{
+  simBegin();
+  testTableRows();
+  testAppliedOutputs();
+  testMixing();
+  testVelocityFrames();
+  return testResult("test_motion_table");
+}
@@ -0,0 +1,261 @@
+// Motor task behaviour on the mock HAL: commit frames, staged start,
+// reversal, the command lease, arbitration, the transport callbacks and
+// the loop timing metrics.
+
+#include <string.h>
+#include <map>
+
+#include "arduino_config.h"
+#include "command_ingress.h"
+#include "control_arbiter.h"
+#include "metrics.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "sim.h"
+#include "test_support.h"
+
+// Time of the first non-zero latch on either input of a motor, 0 if none
+static uint64_t firstDriveMicros(int motor)
+{
+  for (const ChannelWrite &write : mockChannelWrites())
+  {
+    if (write.channel / 2 == motor && write.duty > 0)
+    {
+      return write.latchMicros;
+    }
+  }
+  return 0;
+}
+
+static void testCommitLatchesTogether()
+{
+  simStopCar();
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun(400000);
+
+  // Writes issued in the same pass all take effect on the same edge
+  std::map<uint64_t, uint64_t> latchForPass;
+  for (const ChannelWrite &write : mockChannelWrites())
+  {
+    auto found = latchForPass.find(write.writtenMicros);
+    if (found == latchForPass.end())
+    {
+      latchForPass[write.writtenMicros] = write.latchMicros;
+    }
+    else
+    {
+      CHECK_EQUAL(found->second, write.latchMicros);
+    }
+  }
+  CHECK(latchForPass.size() > 1);
+}
+
+static void testStagedStart()
+{
+  simStopCar();
+  uint64_t start = mockNow();
+  submitCarMovement(UP, SOURCE_WS, halMicros());
+  simRun(400000);
+
+  for (int motor = 0; motor < MOTOR_COUNT; motor++)
+  {
+    uint64_t driveMicros = firstDriveMicros(motor);
+    CHECK(driveMicros != 0);
+    CHECK(driveMicros >= start + MOTOR_STARTUP_OFFSETS[motor] * 1000ULL);
+    CHECK(driveMicros <= start + MOTOR_STARTUP_OFFSETS[motor] * 1000ULL + RAMP_TICK_MS * 1000ULL +
+                             1000000ULL / MOTOR_PWM_FREQUENCY);
+  }
+}
+
+// Reversing never drives both inputs of a motor at once
+static void testReversalNeverOverlaps()
+{
+  simStopCar();
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun(400000);
+  submitCarMovement(UP, SOURCE_WS, halMicros());
+  simRun(400000);
+
+  for (const ChannelWrite &write : mockChannelWrites())
+  {
+    int motor = write.channel / 2;
+    CHECK(mockChannelDutyAt(motor * 2, write.latchMicros) == 0 ||
+          mockChannelDutyAt(motor * 2 + 1, write.latchMicros) == 0);
+  }
+}
+
+static void testLeaseExpiry()
+{
+  simStopCar();
+  uint32_t expiries = getLeaseExpiryCount();
+
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun((COMMAND_LEASE_MS - 50) * 1000);
+  CHECK(simAnyChannelDriving());
+  CHECK_EQUAL(expiries, getLeaseExpiryCount());
+
+  // Renewing moves the deadline
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun((COMMAND_LEASE_MS - 50) * 1000);
+  CHECK(simAnyChannelDriving());
+
+  simRun(100000);
+  CHECK(!simAnyChannelDriving());
+  CHECK_EQUAL(expiries + 1, getLeaseExpiryCount());
+}
+
+// Repeating the active motion renews the lease without touching the outputs
+static void testRepeatedCommandCached()
+{
+  simStopCar();
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun(400000);
+  size_t writes = mockChannelWrites().size();
+  size_t logLines = mockLogLines().size();
+  OutputCacheMetrics before = getOutputCacheMetrics();
+
+  submitCarMovement(DOWN, SOURCE_WS, halMicros());
+  simRun(COMMAND_LEASE_MS * 1000 - 50000);
+  CHECK_EQUAL(writes, mockChannelWrites().size());
+  CHECK_EQUAL(logLines, mockLogLines().size());
+  CHECK(simAnyChannelDriving());
+  CHECK_EQUAL(before.commandHits + 1, getOutputCacheMetrics().commandHits);
+  CHECK_EQUAL(before.commandMisses, getOutputCacheMetrics().commandMisses);
+
+  // A different motion is applied, and only its changed channels are written
+  mockClearRecords();
+  submitCarMovement(TURN_LEFT, SOURCE_WS, halMicros());
+  simRun(400000);
+  CHECK_EQUAL(before.commandMisses + 1, getOutputCacheMetrics().commandMisses);
+  CHECK(!mockChannelWrites().empty());
+  for (const ChannelWrite &write : mockChannelWrites())
+  {
+    CHECK(write.channel / 2 == FRONT_RIGHT_MOTOR || write.channel / 2 == BACK_RIGHT_MOTOR);
+  }
+}
+
+static void testArbitration()
+{
+  simStopCar();
+  uint32_t rejections = getArbiterRejections();
+
+  // The joystick outranks gestures while it holds the car
+  submitCarMovement(TURN_LEFT, SOURCE_WS, halMicros());
+  simRun(10000);
+  CHECK_EQUAL(SOURCE_WS, getControlState().owner);
+
+  submitCarMovement(HAND_LEFT_RAISED, SOURCE_HTTP_GESTURE, halMicros());
+  simRun(10000);
+  CHECK_EQUAL(rejections + 1, getArbiterRejections());
+  CHECK_EQUAL(SOURCE_WS, getControlState().owner);
+
+  // ...but anyone may stop it, which also releases ownership
+  submitCarMovement(STOP, SOURCE_HTTP_GESTURE, halMicros());
+  simRun(10000);
+  CHECK_EQUAL(OWNER_NONE, getControlState().owner);
+  CHECK(!simAnyChannelDriving());
+}
+
+static void testIngress()
+{
+  simStopCar();
+  CarCommand command;
+
+  const uint8_t text[] = "3";
+  CHECK_EQUAL(INGRESS_QUEUED, ingestTextFrame(SOURCE_WS, text, 1, halMicros(), command));
+  CHECK_EQUAL(LEFT, command.command);
+
+  const uint8_t shortFrame[] = {PROTO_OP_COMMAND, 0};
+  CHECK_EQUAL(INGRESS_MALFORMED, ingestBinaryFrame(SOURCE_CONTROL_WS, shortFrame, sizeof(shortFrame), halMicros(),
+                                                   command));
+
+  const uint8_t ping[] = {PROTO_OP_PING, 0x34, 0x12};
+  CHECK_EQUAL(INGRESS_PING, ingestBinaryFrame(SOURCE_CONTROL_WS, ping, sizeof(ping), halMicros(), command));
+  CHECK_EQUAL(0x1234, command.sequence);
+
+  const uint8_t subscribe[] = {PROTO_OP_SUBSCRIBE, 1, 0, 1};
+  CHECK_EQUAL(INGRESS_SUBSCRIBE, ingestBinaryFrame(SOURCE_CONTROL_WS, subscribe, sizeof(subscribe), halMicros(),
+                                                   command));
+  CHECK_EQUAL(1, command.command);
+
+  // Only the text frame reached the motor task
+  MotorQueueStats before = getMotorQueueStats();
+  simRun(10000);
+  CHECK_EQUAL(before.processed + 1, getMotorQueueStats().processed);
+  CHECK(simAnyChannelDriving());
+
+  CHECK_EQUAL(INGRESS_QUEUED, ingestGesture("wave", halMicros()));
+  simRun(10000);
+  CHECK(!simAnyChannelDriving());
+}
+
+// A full queue refuses commands but still lets a STOP through, and the
+// commands queued before it do not drive the car again
+static void testQueueFullStop()
+{
+  simStopCar();
+  MotorQueueStats before = getMotorQueueStats();
+  for (int i = 0; i < COMMAND_QUEUE_DEPTH; i++)
+  {
+    CHECK(submitCarMovement(UP, SOURCE_WS, halMicros()));
+  }
+  CHECK(!submitCarMovement(UP, SOURCE_WS, halMicros()));
+  CHECK(!submitCarMovement(STOP, SOURCE_WS, halMicros()));
+
+  simRun(400000);
+  CHECK(!simAnyChannelDriving());
+  MotorQueueStats after = getMotorQueueStats();
+  CHECK_EQUAL(0, after.depth);
+  CHECK_EQUAL(before.discarded + COMMAND_QUEUE_DEPTH, after.discarded);
+
+  // Likewise for a stop requested outside the queues, such as on WiFi loss
+  submitCarMovement(UP, SOURCE_WS, halMicros());
+  submitCarMovement(UP, SOURCE_WS, halMicros());
+  requestMotorStop();
+  simRun(400000);
+  CHECK(!simAnyChannelDriving());
+  CHECK_EQUAL(after.discarded + 2, getMotorQueueStats().discarded);
+  simStopCar();
+}
+
+// The mock runs the motor task the moment a timer fires, so ramp ticks
+// come exactly one period apart with no wake latency
+static void testLoopTiming()
+{
+  CHECK_EQUAL(MOTOR_TASK_CORE, halTaskCore("motor"));
+  CHECK_EQUAL(-1, halTaskCore("async_tcp"));
+
+  simStopCar();
+  submitCarMovement(UP, SOURCE_WS, halMicros());
+  simRun(400000);
+
+  static char text[8192];
+  formatMetrics(text, sizeof(text));
+  const char *jitter = strstr(text, "loop_jitter_us{loop=\"ramp\"}");
+  const char *wake = strstr(text, "loop_wake_us{loop=\"ramp\"}");
+  CHECK(jitter != nullptr);
+  CHECK(wake != nullptr);
+  CHECK(strstr(text, "response_latency_us count=") != nullptr);
+  CHECK(strstr(text, "motor_pass_us count=") != nullptr);
+  if (jitter != nullptr && wake != nullptr)
+  {
+    CHECK(strstr(jitter, "max=0\n") == strchr(jitter, '\n') - 5);
+    CHECK(strstr(wake, "max=0\n") == strchr(wake, '\n') - 5);
+  }
+  simStopCar();
+}
+
+int main()
+{
+  simBegin();
+  testCommitLatchesTogether();
+  testStagedStart();
+  testReversalNeverOverlaps();
+  testLeaseExpiry();
+  testRepeatedCommandCached();
+  testArbitration();
+  testIngress();
+  testQueueFullStop();
+  testLoopTiming();
+  return testResult("test_motor_control");
+}
@@ -0,0 +1,40 @@
+/*
+ * Minimal checks for the host tests: each failed CHECK prints its
+ * location, and the test exits non-zero if any failed.
+ */
+
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <stdio.h>
+
+static int testFailures = 0;
+
+static inline void checkTrue(bool passed, const char *expression, const char *file, int line)
+{
+  if (!passed)
+  {
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+    testFailures++;
+  }
+}
+
+static inline void checkEqual(long long expected, long long actual, const char *expression, const char *file, int line)
+{
+  if (expected != actual)
+  {
+    fprintf(stderr, "%s:%d: %s: expected %lld, got %lld\n", file, line, expression, expected, actual);
+    testFailures++;
+  }
+}
+
+#define CHECK(condition) checkTrue((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) checkEqual((expected), (actual), #actual, __FILE__, __LINE__)
+
+static inline int testResult(const char *name)
+{
+  printf("%s: %s (%d failed checks)\n", name, testFailures == 0 ? "PASS" : "FAIL", testFailures);
+  return testFailures == 0 ? 0 : 1;
+}
+
+#endif // TEST_SUPPORT_H
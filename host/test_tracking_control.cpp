@@ -0,0 +1,159 @@
+// On-device tracking controller: observation decoding, error clamping,
+// dead-band with hysteresis, prediction across dropped frames, and the
+// motor task stopping the car once the target is lost.
+
+#include <limits.h>
+#include <vector>
+
+#include "arduino_config.h"
+#include "command_ingress.h"
+#include "control_arbiter.h"
+#include "motor_control.h"
+#include "motor_ramp.h"
+#include "sim.h"
+#include "test_support.h"
+#include "tracking_control.h"
+
+static TargetObservation observation(int x, uint32_t frameMillis, uint8_t confidence = 90)
+{
+  TargetObservation target;
+  target.x = x;
+  target.width = 200;
+  target.confidence = confidence;
+  target.frameMillis = frameMillis;
+  return target;
+}
+
+static std::vector<uint8_t> observeFrame(int x, uint16_t width, uint8_t confidence, uint32_t frameMillis)
+{
+  return {PROTO_OP_OBSERVE, 1, 0, (uint8_t)(x & 0xFF), (uint8_t)((uint16_t)x >> 8), (uint8_t)(width & 0xFF),
+          (uint8_t)(width >> 8), confidence, (uint8_t)(frameMillis & 0xFF), (uint8_t)(frameMillis >> 8),
+          (uint8_t)(frameMillis >> 16), (uint8_t)(frameMillis >> 24)};
+}
+
+static void observe(int x, uint32_t frameMillis)
+{
+  std::vector<uint8_t> frame = observeFrame(x, 200, 90, frameMillis);
+  CarCommand command;
+  ingestBinaryFrame(SOURCE_CONTROL_WS, frame.data(), frame.size(), halMicros(), command);
+  simSettle();
+}
+
+// Signed duty the left side is heading for; positive turns right
+static int leftTurnDuty()
+{
+  return rampTargetDuty(FRONT_LEFT_MOTOR);
+}
+
+static void testDecode()
+{
+  std::vector<uint8_t> frame = observeFrame(-350, 180, 77, 0x12345678);
+  CarCommand command = {};
+  CHECK(decodeBinaryCommand(frame.data(), frame.size(), command));
+  CHECK_EQUAL(PROTO_OP_OBSERVE, command.opcode);
+  CHECK_EQUAL(-350, command.target.x);
+  CHECK_EQUAL(180, command.target.width);
+  CHECK_EQUAL(77, command.target.confidence);
+  CHECK_EQUAL(0x12345678, command.target.frameMillis);
+  CHECK(!decodeBinaryCommand(frame.data(), frame.size() - 1, command));
+}
+
+// Errors beyond the frame edge, however large, turn at the limit
+static void testErrorClamp()
+{
+  CHECK_EQUAL(trackingErrorToTurnRate(TRACKING_RATE_LIMIT), trackingErrorToTurnRate(INT_MAX));
+  CHECK_EQUAL(trackingErrorToTurnRate(-TRACKING_RATE_LIMIT), trackingErrorToTurnRate(INT_MIN));
+  CHECK(trackingErrorToTurnRate(INT_MAX / 2 + 1) > 0);
+}
+
+static void testHysteresis()
+{
+  trackerReset();
+  CHECK(trackerObserve(observation(80, 1000), 0));
+  CHECK_EQUAL(0, trackerStep(0));  // inside the enter band
+
+  CHECK(trackerObserve(observation(300, 1033), 33));
+  CHECK_EQUAL(trackingErrorToTurnRate(300), trackerStep(33));
+
+  // Between the bands: keeps turning on the way back, no velocity left to extrapolate
+  trackerReset();
+  trackerObserve(observation(300, 2000), 100);
+  trackerStep(100);
+  trackerObserve(observation(80, 2400), 500);
+  CHECK_EQUAL(trackingErrorToTurnRate(80), trackerStep(500));
+  trackerObserve(observation(30, 2800), 900);
+  CHECK_EQUAL(0, trackerStep(900));
+}
+
+static void testPredictionAndLoss()
+{
+  trackerReset();
+  CHECK(trackerObserve(observation(200, 0), 0));
+  CHECK(trackerObserve(observation(300, 100), 100));  // 1000 per second, smoothed to 500
+  CHECK_EQUAL(trackingErrorToTurnRate(300), trackerStep(100));
+
+  // Dropped frames: the target keeps moving, but only for predict_ms
+  CHECK_EQUAL(trackingErrorToTurnRate(350), trackerStep(200));
+  CHECK_EQUAL(trackingErrorToTurnRate(300 + 500 * (int)TRACKER_PREDICT_MS / 1000), trackerStep(350));
+
+  // Out of order, unsure and empty frames are ignored
+  CHECK(!trackerObserve(observation(-900, 50), 360));
+  CHECK(!trackerObserve(observation(-900, 400, TRACKER_MIN_CONFIDENCE - 1), 360));
+  TargetObservation empty = observation(-900, 400);
+  empty.width = 0;
+  CHECK(!trackerObserve(empty, 360));
+
+  uint32_t lost = getTrackerStats().targetsLost;
+  CHECK_EQUAL(0, trackerStep(100 + TRACKER_LOST_MS));
+  CHECK(!trackerActive());
+  CHECK_EQUAL(lost + 1, getTrackerStats().targetsLost);
+  trackerReset();
+}
+
+static void testMotorTask()
+{
+  simStopCar();
+  uint32_t frameMillis = 5000;
+
+  // The first observation steers at once, then ticks keep it going
+  observe(400, frameMillis);
+  CHECK(leftTurnDuty() > 0);
+  CHECK_EQUAL(SOURCE_CONTROL_WS, getControlState().owner);
+
+  // Streaming at 30 fps: the car follows the target through the band
+  for (int i = 1; i <= 15; i++)
+  {
+    simRun(33000);
+    observe(400 - i * 25, frameMillis + i * 33);
+  }
+  simRun(20000);
+  CHECK_EQUAL(0, leftTurnDuty());
+
+  // A target to the left turns left; then the stream stops
+  observe(-500, frameMillis + 600);
+  simRun(20000);
+  CHECK(leftTurnDuty() < 0);
+  simRun(TRACKER_LOST_MS * 1000);
+  CHECK_EQUAL(0, leftTurnDuty());
+  CHECK_EQUAL(OWNER_NONE, getControlState().owner);
+
+  // The joystick outranks the tracker and switches it off
+  observe(500, frameMillis + 2000);
+  CHECK(leftTurnDuty() > 0);
+  submitCarMovement(UP, SOURCE_WS, halMicros());
+  simRun(100000);
+  CHECK_EQUAL(SOURCE_WS, getControlState().owner);
+  CHECK(!trackerActive());
+  simStopCar();
+}
+
+int main()
+{
+  simBegin();
+  testDecode();
+  testErrorClamp();
+  testHysteresis();
+  testPredictionAndLoss();
+  testMotorTask();
+  return testResult("test_tracking_control");
+}
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <atomic>
+
+#include "arduino_config.h"
+#include "jitter_buffer.h"
+
+struct ScheduledCommand
+{
+  int64_t playoutMicros;
+  uint32_t senderMillis;
+  CarCommand command;
+};
+
+// Sorted by play-out time, earliest first. Motor task only.
+static ScheduledCommand scheduled[JITTER_BUFFER_SLOTS];
+static int depth = 0;
+
+// Sender clock -> local clock, motor task only
+static bool sessionActive = false;
+static int64_t lastBatchMicros = 0;
+static int64_t windowStartMicros = 0;
+static int64_t windowMinTransit[2];  // current window, previous window
+static bool havePlayed = false;
+static uint32_t lastPlayedSenderMillis = 0;
+
+static std::atomic<uint32_t> batches{0};
+static std::atomic<uint32_t> commandsReceived{0};
+static std::atomic<uint32_t> played{0};
+static std::atomic<uint32_t> late{0};
+static std::atomic<uint32_t> stale{0};
+static std::atomic<uint32_t> underruns{0};
+static std::atomic<uint32_t> overflows{0};
+static std::atomic<uint32_t> depthNow{0};
+static std::atomic<int32_t> transitMillis{0};
+
+static uint32_t readUint32(const uint8_t *data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+bool decodeCommandBatch(const uint8_t *data, size_t len, CommandBatch &batch)
+{
+  if (len < PROTO_HEADER_SIZE || data[0] != PROTO_OP_BATCH)
+  {
+    return false;
+  }
+
+  uint16_t sequence = (uint16_t)(data[1] | (data[2] << 8));
+  batch.count = 0;
+
+  size_t offset = PROTO_HEADER_SIZE;
+  while (offset < len)
+  {
+    if (batch.count == BATCH_MAX_COMMANDS || len - offset < BATCH_ITEM_HEADER)
+    {
+      return false;
+    }
+
+    uint8_t opcode = data[offset + 4];
+    size_t payloadSize = motionPayloadSize(opcode);
+    CarCommand &command = batch.commands[batch.count];
+    command = {};
+    if (payloadSize == 0 || len - offset - BATCH_ITEM_HEADER < payloadSize ||
+        !decodeCommandPayload(opcode, data + offset + BATCH_ITEM_HEADER, payloadSize, command))
+    {
+      return false;
+    }
+
+    command.sequence = sequence;
+    batch.senderMillis[batch.count++] = readUint32(data + offset);
+    offset += BATCH_ITEM_HEADER + payloadSize;
+  }
+  return batch.count > 0;
+}
+
+static void publishDepth()
+{
+  depthNow.store(depth, std::memory_order_relaxed);
+}
+
+// Windowed minimum of arrival - sender time; the newest item of a batch
+// has the shortest transit
+static int64_t updateBaseline(int64_t transit, int64_t nowMicros)
+{
+  if (!sessionActive || nowMicros - lastBatchMicros > (int64_t)JITTER_SESSION_TIMEOUT_MS * 1000)
+  {
+    sessionActive = true;
+    havePlayed = false;
+    windowStartMicros = nowMicros;
+    windowMinTransit[0] = windowMinTransit[1] = transit;
+  }
+  else if (nowMicros - windowStartMicros >= (int64_t)JITTER_WINDOW_MS * 1000)
+  {
+    windowStartMicros = nowMicros;
+    windowMinTransit[1] = windowMinTransit[0];
+    windowMinTransit[0] = transit;
+  }
+  else
+  {
+    windowMinTransit[0] = std::min(windowMinTransit[0], transit);
+  }
+  lastBatchMicros = nowMicros;
+
+  int64_t baseline = std::min(windowMinTransit[0], windowMinTransit[1]);
+  transitMillis.store((int32_t)(baseline / 1000), std::memory_order_relaxed);
+  return baseline;
+}
+
+static void removeAt(int index)
+{
+  std::move(scheduled + index + 1, scheduled + depth, scheduled + index);
+  depth--;
+}
+
+// After any command due at the same time, so equal times keep their order
+static void insert(int64_t playoutMicros, uint32_t senderMillis, const CarCommand &command)
+{
+  if (depth == JITTER_BUFFER_SLOTS)
+  {
+    removeAt(0);
+    overflows.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  int index = depth;
+  while (index > 0 && scheduled[index - 1].playoutMicros > playoutMicros)
+  {
+    scheduled[index] = scheduled[index - 1];
+    index--;
+  }
+  scheduled[index].playoutMicros = playoutMicros;
+  scheduled[index].senderMillis = senderMillis;
+  scheduled[index].command = command;
+  depth++;
+}
+
+void jitterAddBatch(const CommandBatch &batch, int64_t nowMicros)
+{
+  uint32_t newest = batch.senderMillis[0];
+  for (int i = 1; i < batch.count; i++)
+  {
+    if ((int32_t)(batch.senderMillis[i] - newest) > 0)
+    {
+      newest = batch.senderMillis[i];
+    }
+  }
+
+  // Sender times are taken relative to the newest so a wrapping clock is harmless
+  int64_t baseline = updateBaseline(nowMicros - (int64_t)newest * 1000, nowMicros);
+  int64_t newestPlayout = (int64_t)newest * 1000 + baseline + (int64_t)JITTER_PLAYOUT_DELAY_MS * 1000;
+  bool wasEmpty = depth == 0;
+
+  batches.fetch_add(1, std::memory_order_relaxed);
+  commandsReceived.fetch_add(batch.count, std::memory_order_relaxed);
+  for (int i = 0; i < batch.count; i++)
+  {
+    int64_t playout = newestPlayout + (int64_t)(int32_t)(batch.senderMillis[i] - newest) * 1000;
+    if (playout <= nowMicros)
+    {
+      late.fetch_add(1, std::memory_order_relaxed);
+      if (i == 0 && wasEmpty && havePlayed)
+      {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (havePlayed && (int32_t)(batch.senderMillis[i] - lastPlayedSenderMillis) <= 0)
+      {
+        stale.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      playout = nowMicros;
+    }
+
+    CarCommand command = batch.commands[i];
+    command.source = batch.source;
+    command.receivedMicros = batch.receivedMicros;
+    command.decodedMicros = batch.decodedMicros;
+    insert(playout, batch.senderMillis[i], command);
+  }
+  publishDepth();
+}
+
+bool jitterNextDue(int64_t &dueMicros)
+{
+  if (depth == 0)
+  {
+    return false;
+  }
+  dueMicros = scheduled[0].playoutMicros;
+  return true;
+}
+
+bool jitterTakeDue(int64_t nowMicros, CarCommand &command)
+{
+  if (depth == 0 || scheduled[0].playoutMicros > nowMicros)
+  {
+    return false;
+  }
+
+  command = scheduled[0].command;
+  havePlayed = true;
+  lastPlayedSenderMillis = scheduled[0].senderMillis;
+  removeAt(0);
+  played.fetch_add(1, std::memory_order_relaxed);
+  publishDepth();
+  return true;
+}
+
+void jitterDropSource(uint8_t source)
+{
+  for (int i = depth - 1; i >= 0; i--)
+  {
+    if (scheduled[i].command.source == source)
+    {
+      removeAt(i);
+    }
+  }
+  publishDepth();
+}
+
+void jitterClear()
+{
+  depth = 0;
+  sessionActive = false;
+  publishDepth();
+}
+
+JitterStats getJitterStats()
+{
+  JitterStats stats;
+
+  stats.batches = batches.load(std::memory_order_relaxed);
+  stats.commands = commandsReceived.load(std::memory_order_relaxed);
+  stats.played = played.load(std::memory_order_relaxed);
+  stats.late = late.load(std::memory_order_relaxed);
+  stats.stale = stale.load(std::memory_order_relaxed);
+  stats.underruns = underruns.load(std::memory_order_relaxed);
+  stats.overflows = overflows.load(std::memory_order_relaxed);
+  stats.depth = depthNow.load(std::memory_order_relaxed);
+  stats.transitMillis = transitMillis.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,76 @@
+/*
+ * Timestamped command batches and the jitter buffer that plays them out
+ *
+ * WiFi delivers in bursts, so commands a host sends at a steady rate can
+ * arrive bunched. A PROTO_OP_BATCH frame instead carries several commands,
+ * each with the sender's timestamp, in one packet. The motor task keeps
+ * them in a small buffer sorted by play-out time and applies each one from
+ * a one-shot timer at
+ *
+ *   sender timestamp + baseline transit + JITTER_PLAYOUT_DELAY_MS
+ *
+ * The baseline transit is the smallest arrival minus sender time seen
+ * over the last two JITTER_WINDOW_MS windows, so it follows drift between
+ * the two clocks. Commands come out at the spacing they were taken,
+ * delayed by the playout delay, however they arrived.
+ *
+ * A command arriving after its play-out time is late: it runs at once
+ * unless a newer command already ran, in which case it is dropped as
+ * stale. An underrun is a batch finding the buffer empty with its first
+ * command already late, i.e. the network stalled for more than the
+ * playout delay. If the buffer is full the earliest command is dropped
+ * to make room. After JITTER_SESSION_TIMEOUT_MS without a batch the
+ * baseline starts over, so a restarted sender is picked up.
+ *
+ * Played commands go through arbitration like live ones.
+ */
+
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define BATCH_MAX_COMMANDS 8
+#define BATCH_ITEM_HEADER 5  // sender timestamp u32 + opcode
+#define JITTER_BUFFER_SLOTS 16
+
+struct CommandBatch
+{
+  uint8_t source;
+  uint8_t count;
+  uint32_t receivedMicros;
+  uint32_t decodedMicros;
+  uint32_t senderMillis[BATCH_MAX_COMMANDS];
+  CarCommand commands[BATCH_MAX_COMMANDS];  // all carry the frame's sequence
+};
+
+struct JitterStats
+{
+  uint32_t batches;
+  uint32_t commands;
+  uint32_t played;
+  uint32_t late;       // arrived after their play-out time
+  uint32_t stale;      // late and older than a command already played: dropped
+  uint32_t underruns;
+  uint32_t overflows;  // dropped for lack of room
+  uint32_t depth;
+  int32_t transitMillis;  // baseline arrival - sender time
+};
+
+// Decode a whole PROTO_OP_BATCH frame, header included. False if an item
+// is truncated or not a motion, or there are none or too many.
+bool decodeCommandBatch(const uint8_t *data, size_t len, CommandBatch &batch);
+
+// Motor task only
+void jitterAddBatch(const CommandBatch &batch, int64_t nowMicros);
+bool jitterNextDue(int64_t &dueMicros);
+bool jitterTakeDue(int64_t nowMicros, CarCommand &command);
+void jitterDropSource(uint8_t source);  // its connection closed
+void jitterClear();                     // car stopped outside the queues
+
+JitterStats getJitterStats();
+
+#endif // JITTER_BUFFER_H
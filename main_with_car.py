@@ -36,6 +36,7 @@ class GestureDetector:
         car_ip = car_ip or self.car_config['ip']
         self.car_controller = SmartCarController(car_ip, self.car_config['port'])
         self.car_connected = False
+        self.stream_observations = config.get_controller_config()['tracking_mode'] == 'observations'
         
         # Add frame flipping option from config
         self.flip_frame = self.vision_config['camera']['flip_horizontal']
@@ -177,6 +178,8 @@ class GestureDetector:
         # Process first detected person
         has_raised_hand = False
         hand_side = None
+        tracked_box = None
+        tracked_confidence = 0.0
         
         for result in results:
             boxes = result.boxes.cpu().numpy()
@@ -199,12 +202,20 @@ class GestureDetector:
                     # Draw visualization
                     self.draw_pose_keypoints(frame, kpts.data[0], (x1, y1, x2, y2))
                     
+                    tracked_box = (x1, y1, x2, y2)
+                    tracked_confidence = float(box.conf[0])
+                    
                     # Send commands to car if connected and enabled
-                    if self.car_connected and config.get('system.enable_car_control', True):
+                    if (self.car_connected and config.get('system.enable_car_control', True)
+                            and not self.stream_observations):
                         self.car_controller.handle_gesture(has_raised_hand, hand_side)
                     
                     break  # Only process first person
         
+        # Observation mode: every frame goes to the car's tracking controller, empty ones included
+        if self.stream_observations and self.car_connected and config.get('system.enable_car_control', True):
+            self.car_controller.send_target_observation(tracked_box, frame.shape[1], tracked_confidence)
+        
         # Draw status text with movement direction using config
         display_cfg = self.display_config
         if has_raised_hand and hand_side:
@@ -226,8 +237,8 @@ class GestureDetector:
     
     def run_webcam(self):
         """Run detection on webcam feed"""
-        # Initialize webcam
-        cap = cv2.VideoCapture(0)
+        # Initialize webcam, or the car's MJPEG stream
+        cap = cv2.VideoCapture(self.vision_config['camera']['source'])
         cap.set(cv2.CAP_PROP_FRAME_WIDTH, self.frame_dimensions[0])
         cap.set(cv2.CAP_PROP_FRAME_HEIGHT, self.frame_dimensions[1])
         
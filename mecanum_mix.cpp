@@ -0,0 +1,38 @@
+#include <stdlib.h>
+#include <algorithm>
+
+#include "car_commands.h"
+#include "mecanum_mix.h"
+
+static int clampVelocity(int value)
+{
+  return std::min(std::max(value, -VELOCITY_FULL_SCALE), VELOCITY_FULL_SCALE);
+}
+
+void mixBodyVelocity(const BodyVelocity &velocity, int maxDuty, int *duty)
+{
+  int vx = clampVelocity(velocity.vx);
+  int vy = clampVelocity(velocity.vy);
+  int omega = clampVelocity(velocity.omega);
+  int wheel[MOTOR_COUNT];
+
+  wheel[FRONT_RIGHT_MOTOR] = vx - vy - omega;
+  wheel[BACK_RIGHT_MOTOR] = vx + vy - omega;
+  wheel[FRONT_LEFT_MOTOR] = vx + vy + omega;
+  wheel[BACK_LEFT_MOTOR] = vx - vy + omega;
+
+  int peak = VELOCITY_FULL_SCALE;
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    peak = std::max(peak, abs(wheel[i]));
+  }
+
+  // Rounded, so full scale lands on maxDuty; maxDuty < 2^16 and every
+  // |wheel| <= peak keep the products in 32 bits
+  uint32_t scale = (((uint32_t)maxDuty << 16) + peak / 2) / peak;
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    int magnitude = std::min((int)(((uint32_t)abs(wheel[i]) * scale + 0x8000) >> 16), maxDuty);
+    duty[i] = wheel[i] < 0 ? -magnitude : magnitude;
+  }
+}
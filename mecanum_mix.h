@@ -0,0 +1,34 @@
+/*
+ * Mecanum mixing: a body velocity to four signed wheel duties
+ *
+ * With forward vx, rightward vy and clockwise omega, the wheels of this
+ * chassis take
+ *
+ *   front right  vx - vy - omega     back right  vx + vy - omega
+ *   front left   vx + vy + omega     back left   vx - vy + omega
+ *
+ * which reproduces every row of the motion table (UP is vx alone, RIGHT
+ * vy, UP_RIGHT vx and vy together, TURN_RIGHT omega) and everything in
+ * between. Inputs are clamped to -VELOCITY_FULL_SCALE..VELOCITY_FULL_SCALE.
+ * When a wheel would need more than full scale all four are scaled down
+ * by the same factor, so the direction of travel is kept and only the
+ * speed saturates.
+ *
+ * Integer only: one division per command builds a Q16 duty-per-unit
+ * factor, then each wheel is a multiply, a round and a shift.
+ */
+
+#ifndef MECANUM_MIX_H
+#define MECANUM_MIX_H
+
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define VELOCITY_FULL_SCALE 1000
+
+// Signed duties -maxDuty..maxDuty per motor, positive forward as seen
+// from the car; direction correction is left to setMotorDuty()
+void mixBodyVelocity(const BodyVelocity &velocity, int maxDuty, int *duty);
+
+#endif // MECANUM_MIX_H
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <atomic>
+
+#include "metrics.h"
+
+static const char *const typeNames[METRIC_TYPE_COUNT] = {
+  "STOP", "UP", "DOWN", "LEFT", "RIGHT", "UP_LEFT", "UP_RIGHT", "DOWN_LEFT", "DOWN_RIGHT",
+  "TURN_LEFT", "TURN_RIGHT", "HAND_LEFT_RAISED", "HAND_RIGHT_RAISED", "HAND_BOTH_RAISED",
+  "HAND_NONE_RAISED", "TRACK_LEFT", "TRACK_RIGHT", "TRACK_CENTER", "MOTOR_DUTY", "TURN",
+  "VELOCITY",
+};
+
+// Written by the motor task only; readers see each 32-bit counter atomically
+static LatencyHistogram totalLatency[METRIC_TYPE_COUNT];  // receive -> applied
+static LatencyHistogram decodeLatency;                    // receive -> decoded
+static LatencyHistogram dispatchLatency;                  // decoded -> applied
+static uint32_t sourceCounts[SOURCE_COUNT];
+static std::atomic<uint32_t> lastCommand{0};  // type << 24 | latency, so readers never see a torn pair
+static OutputCacheMetrics outputCache;
+static LatencyHistogram responseLatency;  // receive -> applied, every command
+static LatencyHistogram loopJitter[LOOP_COUNT];
+static LatencyHistogram loopWakeLatency[LOOP_COUNT];
+static LatencyHistogram motorPassTime;
+static uint32_t lastTickMicros[LOOP_COUNT];
+static bool lastTickValid[LOOP_COUNT];
+
+static const char *const loopNames[LOOP_COUNT] = {"ramp", "speed", "tracker"};
+
+static void recordLatency(LatencyHistogram &histogram, uint32_t micros)
+{
+  int bucket = micros == 0 ? 0 : 32 - __builtin_clz(micros);
+  if (bucket >= LATENCY_BUCKET_COUNT)
+  {
+    bucket = LATENCY_BUCKET_COUNT - 1;
+  }
+
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  if (micros > histogram.maxMicros)
+  {
+    histogram.maxMicros = micros;
+  }
+}
+
+static int metricType(const CarCommand &command)
+{
+  switch (command.opcode)
+  {
+    case PROTO_OP_MOTOR_DUTY:
+      return METRIC_TYPE_MOTOR_DUTY;
+    case PROTO_OP_TURN:
+      return METRIC_TYPE_TURN;
+    case PROTO_OP_VELOCITY:
+      return METRIC_TYPE_VELOCITY;
+    default:
+      return command.command <= LAST_COMMAND ? command.command : STOP;
+  }
+}
+
+void recordCommandApplied(const CarCommand &command, uint32_t appliedMicros)
+{
+  if (command.source < SOURCE_COUNT)
+  {
+    sourceCounts[command.source]++;
+  }
+
+  // Unsigned differences stay correct across the 32-bit micros() wrap
+  uint32_t latency = appliedMicros - command.receivedMicros;
+  recordLatency(totalLatency[metricType(command)], latency);
+  recordLatency(responseLatency, latency);
+  lastCommand.store((uint32_t)metricType(command) << 24 | (latency < 0xFFFFFF ? latency : 0xFFFFFF),
+                    std::memory_order_relaxed);
+  recordLatency(decodeLatency, command.decodedMicros - command.receivedMicros);
+  recordLatency(dispatchLatency, appliedMicros - command.decodedMicros);
+}
+
+LastCommandMetrics getLastCommandMetrics()
+{
+  uint32_t packed = lastCommand.load(std::memory_order_relaxed);
+  LastCommandMetrics last = {(uint8_t)(packed >> 24), packed & 0xFFFFFF};
+  return last;
+}
+
+void recordCommandCache(bool hit)
+{
+  if (hit)
+  {
+    outputCache.commandHits++;
+  }
+  else
+  {
+    outputCache.commandMisses++;
+  }
+}
+
+void recordChannelWrite(bool changed)
+{
+  if (changed)
+  {
+    outputCache.channelWrites++;
+  }
+  else
+  {
+    outputCache.channelWritesSkipped++;
+  }
+}
+
+OutputCacheMetrics getOutputCacheMetrics()
+{
+  return outputCache;
+}
+
+void recordLoopTick(uint8_t loop, uint32_t periodMicros, uint32_t firedMicros, uint32_t runMicros)
+{
+  if (lastTickValid[loop])
+  {
+    int32_t stray = (int32_t)(runMicros - lastTickMicros[loop] - periodMicros);
+    recordLatency(loopJitter[loop], stray < 0 ? -stray : stray);
+  }
+  recordLatency(loopWakeLatency[loop], runMicros - firedMicros);
+  lastTickMicros[loop] = runMicros;
+  lastTickValid[loop] = true;
+}
+
+void restartLoopTiming(uint8_t loop)
+{
+  lastTickValid[loop] = false;
+}
+
+void recordMotorPass(uint32_t micros)
+{
+  recordLatency(motorPassTime, micros);
+}
+
+uint32_t histogramPercentile(const LatencyHistogram &histogram, uint32_t percent)
+{
+  if (histogram.count == 0)
+  {
+    return 0;
+  }
+
+  // Smallest bucket whose cumulative count reaches percent of the samples
+  uint64_t target = ((uint64_t)histogram.count * percent + 99) / 100;
+  uint64_t cumulative = 0;
+  for (int bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+  {
+    cumulative += histogram.buckets[bucket];
+    if (cumulative >= target && cumulative > 0)
+    {
+      return 1UL << bucket;
+    }
+  }
+  return histogram.maxMicros;
+}
+
+static size_t appendHistogram(char *buffer, size_t size, size_t used, const char *name, const char *label,
+                              const LatencyHistogram &histogram)
+{
+  if (used >= size)
+  {
+    return used;
+  }
+
+  int written = snprintf(buffer + used, size - used, "%s%s count=%u p50=%u p95=%u p99=%u max=%u\n", name, label,
+                         (unsigned)histogram.count, (unsigned)histogramPercentile(histogram, 50),
+                         (unsigned)histogramPercentile(histogram, 95), (unsigned)histogramPercentile(histogram, 99),
+                         (unsigned)histogram.maxMicros);
+  return written > 0 ? used + written : used;
+}
+
+size_t formatMetrics(char *buffer, size_t size)
+{
+  size_t used = 0;
+  char label[40];
+
+  for (int source = 0; source < SOURCE_COUNT && used < size; source++)
+  {
+    int written = snprintf(buffer + used, size - used, "commands_total{source=\"%s\"} %u\n", sourceName(source),
+                           (unsigned)sourceCounts[source]);
+    used += written > 0 ? written : 0;
+  }
+
+  if (used < size)
+  {
+    int written = snprintf(buffer + used, size - used,
+                           "output_cache_hits %u\noutput_cache_misses %u\npwm_writes %u\npwm_writes_skipped %u\n",
+                           (unsigned)outputCache.commandHits, (unsigned)outputCache.commandMisses,
+                           (unsigned)outputCache.channelWrites, (unsigned)outputCache.channelWritesSkipped);
+    used += written > 0 ? written : 0;
+  }
+
+  used = appendHistogram(buffer, size, used, "decode_latency_us", "", decodeLatency);
+  used = appendHistogram(buffer, size, used, "dispatch_latency_us", "", dispatchLatency);
+  used = appendHistogram(buffer, size, used, "response_latency_us", "", responseLatency);
+  used = appendHistogram(buffer, size, used, "motor_pass_us", "", motorPassTime);
+
+  for (int loop = 0; loop < LOOP_COUNT; loop++)
+  {
+    if (loopWakeLatency[loop].count == 0)
+    {
+      continue;
+    }
+    snprintf(label, sizeof(label), "{loop=\"%s\"}", loopNames[loop]);
+    used = appendHistogram(buffer, size, used, "loop_jitter_us", label, loopJitter[loop]);
+    used = appendHistogram(buffer, size, used, "loop_wake_us", label, loopWakeLatency[loop]);
+  }
+
+  for (int type = 0; type < METRIC_TYPE_COUNT; type++)
+  {
+    if (totalLatency[type].count == 0)
+    {
+      continue;
+    }
+    snprintf(label, sizeof(label), "{type=\"%s\"}", typeNames[type]);
+    used = appendHistogram(buffer, size, used, "command_latency_us", label, totalLatency[type]);
+  }
+
+  return used < size ? used : size - 1;
+}
@@ -0,0 +1,96 @@
+/*
+ * Command latency metrics.
+ *
+ * Every command is stamped when a handler receives it and when it has
+ * been decoded; the motor task records it once the last channel write of
+ * the command completed. Latencies go into fixed log2 buckets (bucket i
+ * holds values below 2^i us), so recording is a few instructions and
+ * never allocates. Reported percentiles are bucket upper bounds; max is
+ * exact.
+ *
+ * The output-state cache is counted here too: commands that repeat the
+ * motion already set up, and channel writes skipped because the duty did
+ * not change.
+ *
+ * So is the motor task's timing, to check the core partitioning under
+ * load: for each periodic control loop, how far each tick's interval
+ * strays from the nominal period (jitter) and how long the motor task
+ * took to run after the loop's timer fired (wake latency), plus the time
+ * each motor task pass takes and the receive -> applied latency over all
+ * commands (worst-case response time).
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define LATENCY_BUCKET_COUNT 24  // up to ~8 s
+
+// Histogram slots: one per command id, then the non-table opcodes
+#define METRIC_TYPE_MOTOR_DUTY (LAST_COMMAND + 1)
+#define METRIC_TYPE_TURN (LAST_COMMAND + 2)
+#define METRIC_TYPE_VELOCITY (LAST_COMMAND + 3)
+#define METRIC_TYPE_COUNT (LAST_COMMAND + 4)
+
+// Periodic loops on the motor task
+enum ControlLoop
+{
+  LOOP_RAMP,     // ramp ticks, RAMP_TICK_MS
+  LOOP_SPEED,    // wheel speed PID, SPEED_LOOP_HZ
+  LOOP_TRACKER,  // tracking controller, TRACKER_RATE_HZ
+  LOOP_COUNT
+};
+
+struct LatencyHistogram
+{
+  uint32_t buckets[LATENCY_BUCKET_COUNT];
+  uint32_t count;
+  uint32_t maxMicros;
+};
+
+// Motor task only: record a command whose outputs were written at appliedMicros
+void recordCommandApplied(const CarCommand &command, uint32_t appliedMicros);
+
+// Most recently applied command, for telemetry
+struct LastCommandMetrics
+{
+  uint8_t type;            // METRIC_TYPE_* slot
+  uint32_t latencyMicros;  // receive -> applied
+};
+
+LastCommandMetrics getLastCommandMetrics();
+
+struct OutputCacheMetrics
+{
+  uint32_t commandHits;    // repeated motion: lease renewed, outputs untouched
+  uint32_t commandMisses;  // new motion, applied
+  uint32_t channelWrites;  // duties that changed and were written
+  uint32_t channelWritesSkipped;
+};
+
+// Motor task only
+void recordCommandCache(bool hit);
+void recordChannelWrite(bool changed);
+
+OutputCacheMetrics getOutputCacheMetrics();
+
+// Motor task only: a tick of the loop ran at runMicros, its timer having
+// fired at firedMicros. Restart when the loop's timer is (re)started, so
+// the pause before does not count as jitter.
+void recordLoopTick(uint8_t loop, uint32_t periodMicros, uint32_t firedMicros, uint32_t runMicros);
+void restartLoopTiming(uint8_t loop);
+
+// Motor task only: one pass over its events took this long
+void recordMotorPass(uint32_t micros);
+
+// Upper bound of the bucket holding the given percentile (0..100), 0 if empty
+uint32_t histogramPercentile(const LatencyHistogram &histogram, uint32_t percent);
+
+// Render all metrics as text; returns the length written (truncated to size - 1)
+size_t formatMetrics(char *buffer, size_t size);
+
+#endif // METRICS_H
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <atomic>
+
+#include "motion_script.h"
+
+static_assert(MOTION_SCRIPT_MAX_SEGMENTS < 64, "script progress packs segment indexes into 6 bits");
+
+static const char *const stateNames[] = {"idle", "running", "done", "aborted", "rejected"};
+
+// id << 16 | segment << 10 | count << 4 | state, so readers never see a torn update
+static std::atomic<uint32_t> progressPacked{0};
+
+bool decodeMotionScript(const uint8_t *data, size_t len, MotionScript &script)
+{
+  if (len < PROTO_HEADER_SIZE || data[0] != PROTO_OP_SCRIPT)
+  {
+    return false;
+  }
+
+  script.id = (uint16_t)(data[1] | (data[2] << 8));
+  script.count = 0;
+
+  size_t offset = PROTO_HEADER_SIZE;
+  while (offset < len)
+  {
+    if (script.count == MOTION_SCRIPT_MAX_SEGMENTS || len - offset < MOTION_SCRIPT_SEGMENT_HEADER)
+    {
+      return false;
+    }
+
+    uint8_t opcode = data[offset + 2];
+    size_t payloadSize = motionPayloadSize(opcode);
+    CarCommand command = {};
+    if (payloadSize == 0 || len - offset - MOTION_SCRIPT_SEGMENT_HEADER < payloadSize ||
+        !decodeCommandPayload(opcode, data + offset + MOTION_SCRIPT_SEGMENT_HEADER, payloadSize, command))
+    {
+      return false;
+    }
+
+    // Gestures and tracking errors are stored as what they decode to
+    MotionSegment &segment = script.segments[script.count++];
+    segment.durationMs = (uint16_t)(data[offset] | (data[offset + 1] << 8));
+    segment.opcode = command.opcode;
+    segment.command = command.command;
+    for (int i = 0; i < MOTOR_COUNT; i++)
+    {
+      segment.motorDuty[i] = command.motorDuty[i];
+    }
+    segment.turnRate = command.turnRate;
+    segment.velocity = command.velocity;
+    offset += MOTION_SCRIPT_SEGMENT_HEADER + payloadSize;
+  }
+  return script.count > 0;
+}
+
+CarCommand segmentCommand(const MotionScript &script, int index)
+{
+  const MotionSegment &segment = script.segments[index];
+  CarCommand command = {};
+
+  command.opcode = segment.opcode;
+  command.sequence = script.id;
+  command.command = segment.command;
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    command.motorDuty[i] = segment.motorDuty[i];
+  }
+  command.turnRate = segment.turnRate;
+  command.velocity = segment.velocity;
+  command.source = script.source;
+  command.receivedMicros = script.receivedMicros;
+  command.decodedMicros = script.receivedMicros;
+  return command;
+}
+
+void publishScriptProgress(const ScriptProgress &progress)
+{
+  progressPacked.store((uint32_t)progress.id << 16 | (uint32_t)(progress.segment & 0x3F) << 10 |
+                           (uint32_t)(progress.count & 0x3F) << 4 | (progress.state & 0x0F),
+                       std::memory_order_relaxed);
+}
+
+ScriptProgress getScriptProgress()
+{
+  uint32_t packed = progressPacked.load(std::memory_order_relaxed);
+  ScriptProgress progress;
+
+  progress.id = (uint16_t)(packed >> 16);
+  progress.segment = (packed >> 10) & 0x3F;
+  progress.count = (packed >> 4) & 0x3F;
+  progress.state = packed & 0x0F;
+  return progress;
+}
+
+size_t encodeScriptProgress(uint8_t *buffer, const ScriptProgress &progress)
+{
+  buffer[0] = PROTO_OP_SCRIPT_STATE;
+  buffer[1] = (uint8_t)(progress.id & 0xFF);
+  buffer[2] = (uint8_t)(progress.id >> 8);
+  buffer[3] = progress.segment;
+  buffer[4] = progress.count;
+  buffer[5] = progress.state;
+  return PROTO_SCRIPT_STATE_SIZE;
+}
+
+void formatScriptProgress(const ScriptProgress &progress, char *buffer, size_t size)
+{
+  const char *state = progress.state <= SCRIPT_REJECTED ? stateNames[progress.state] : "unknown";
+
+  snprintf(buffer, size, "{\"script\":%u,\"segment\":%u,\"segments\":%u,\"state\":\"%s\"}", progress.id,
+           progress.segment, progress.count, state);
+}
@@ -0,0 +1,85 @@
+/*
+ * Motion scripts: timed segments the car runs on its own
+ *
+ * A PROTO_OP_SCRIPT frame uploads a whole manoeuvre such as "forward
+ * 1.2 s, turn right 0.4 s, stop" in one message. Each segment is a
+ * command, gesture, motor duty, turn or velocity segment in the same
+ * encoding as the live frames, plus its duration. The motor task runs the segments
+ * back to back from a one-shot timer, against a schedule fixed at the
+ * start, so the timing does not depend on the network. Every segment
+ * goes through the motion table and the ramps like a live command.
+ *
+ * The motor task stops the car once the last segment ends. Any live
+ * command that wins arbitration aborts the script, and so do a STOP,
+ * a disconnect and a calibration change. The command lease is suspended
+ * while a script runs. Progress is published for the service task to push to the
+ * WebSocket clients.
+ */
+
+#ifndef MOTION_SCRIPT_H
+#define MOTION_SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define MOTION_SCRIPT_MAX_SEGMENTS 32
+#define MOTION_SCRIPT_SEGMENT_HEADER 3  // duration u16 + opcode
+
+#define PROTO_SCRIPT_STATE_SIZE 6
+
+enum ScriptState : uint8_t
+{
+  SCRIPT_IDLE,
+  SCRIPT_RUNNING,
+  SCRIPT_DONE,      // last segment ended, car stopped
+  SCRIPT_ABORTED,   // live command, STOP or disconnect
+  SCRIPT_REJECTED,  // another source owns control
+};
+
+// A segment holds the decoded command in a compact form
+struct MotionSegment
+{
+  uint16_t durationMs;
+  uint8_t opcode;  // PROTO_OP_COMMAND, PROTO_OP_MOTOR_DUTY, PROTO_OP_TURN or PROTO_OP_VELOCITY
+  uint8_t command;
+  int16_t motorDuty[MOTOR_COUNT];
+  int16_t turnRate;
+  BodyVelocity velocity;
+};
+
+struct MotionScript
+{
+  uint16_t id;  // sequence of the uploading frame
+  uint8_t source;
+  uint8_t count;
+  uint32_t receivedMicros;
+  MotionSegment segments[MOTION_SCRIPT_MAX_SEGMENTS];
+};
+
+struct ScriptProgress
+{
+  uint16_t id;
+  uint8_t segment;  // index of the running segment, or of the last one run
+  uint8_t count;
+  uint8_t state;    // ScriptState
+};
+
+// Decode a whole PROTO_OP_SCRIPT frame, header included. False if any
+// segment is truncated or not a motion, or there are none or too many.
+bool decodeMotionScript(const uint8_t *data, size_t len, MotionScript &script);
+
+// The live command a segment stands for
+CarCommand segmentCommand(const MotionScript &script, int index);
+
+// Motor task: publish progress. Any task: read the latest.
+void publishScriptProgress(const ScriptProgress &progress);
+ScriptProgress getScriptProgress();
+
+// Progress frame for /control (PROTO_SCRIPT_STATE_SIZE bytes) and JSON
+// text for /ws
+size_t encodeScriptProgress(uint8_t *buffer, const ScriptProgress &progress);
+void formatScriptProgress(const ScriptProgress &progress, char *buffer, size_t size);
+
+#endif // MOTION_SCRIPT_H
@@ -0,0 +1,27 @@
+#include "motion_table.h"
+
+static MotionRow motionTable[LAST_COMMAND + 1];
+
+void rebuildMotionTable(const Calibration &calibration)
+{
+  for (int command = 0; command <= LAST_COMMAND; command++)
+  {
+    const MotionSpec &spec = MOTION_SPECS[command];
+    MotionRow &row = motionTable[command];
+
+    for (int motor = 0; motor < MOTOR_COUNT; motor++)
+    {
+      int direction = spec.direction[motor] * calibration.directionCorrection[motor];
+      row.duty[motor * 2] = direction == FORWARD ? calibration.maxSpeed : 0;       // IN1
+      row.duty[motor * 2 + 1] = direction == BACKWARD ? calibration.maxSpeed : 0;  // IN2
+    }
+    row.stagedStart = spec.stagedStart;
+    row.ramp = spec.ramp;
+    row.description = spec.description;
+  }
+}
+
+const MotionRow &motionForCommand(int command)
+{
+  return motionTable[(command >= 0 && command <= LAST_COMMAND) ? command : STOP];
+}
@@ -0,0 +1,70 @@
+/*
+ * Motion table
+ *
+ * One row per command id (STOP..TRACK_CENTER) holding the final IN1/IN2
+ * duty of all eight LEDC channels, with the direction correction and max
+ * speed of the active calibration already applied. Dispatching a command
+ * is a table lookup plus one write per channel. The rows are rebuilt from
+ * MOTION_SPECS whenever the calibration changes (calibration.h).
+ *
+ * To add a command: give it an id in car_commands.h, bump LAST_COMMAND
+ * and append a spec here in id order.
+ */
+
+#ifndef MOTION_TABLE_H
+#define MOTION_TABLE_H
+
+#include <stdint.h>
+
+#include "calibration.h"
+#include "car_commands.h"
+#include "motor_ramp.h"
+
+struct MotionSpec
+{
+  int8_t direction[MOTOR_COUNT];  // FORWARD, BACKWARD or STOP as seen from the car
+  bool stagedStart;               // apply the calibration's startup offsets per motor
+  uint8_t ramp;                   // RampClass used to reach these duties
+  const char *description;
+};
+
+struct MotionRow
+{
+  uint16_t duty[MOTOR_CHANNEL_COUNT];  // channel motor*2 = IN1, motor*2+1 = IN2
+  bool stagedStart;
+  uint8_t ramp;
+  const char *description;
+};
+
+//                                     FRONT_RIGHT BACK_RIGHT FRONT_LEFT BACK_LEFT staged ramp
+constexpr MotionSpec MOTION_SPECS[] = {
+  /* STOP              */ {{STOP,     STOP,     STOP,     STOP},     false, RAMP_STOP,   "Stopping all motors"},
+  /* UP                */ {{FORWARD,  FORWARD,  FORWARD,  FORWARD},  true,  RAMP_DRIVE,  "Starting staged forward movement"},
+  /* DOWN              */ {{BACKWARD, BACKWARD, BACKWARD, BACKWARD}, false, RAMP_DRIVE,  "Starting synchronized backward movement"},
+  /* LEFT              */ {{FORWARD,  BACKWARD, BACKWARD, FORWARD},  false, RAMP_DRIVE,  "Moving left"},
+  /* RIGHT             */ {{BACKWARD, FORWARD,  FORWARD,  BACKWARD}, false, RAMP_DRIVE,  "Moving right"},
+  /* UP_LEFT           */ {{FORWARD,  STOP,     STOP,     FORWARD},  false, RAMP_DRIVE,  "Moving forward left"},
+  /* UP_RIGHT          */ {{STOP,     FORWARD,  FORWARD,  STOP},     false, RAMP_DRIVE,  "Moving forward right"},
+  /* DOWN_LEFT         */ {{STOP,     BACKWARD, BACKWARD, STOP},     false, RAMP_DRIVE,  "Moving backward left"},
+  /* DOWN_RIGHT        */ {{BACKWARD, STOP,     STOP,     BACKWARD}, false, RAMP_DRIVE,  "Moving backward right"},
+  /* TURN_LEFT         */ {{FORWARD,  FORWARD,  BACKWARD, BACKWARD}, false, RAMP_TURN,   "Turning left"},
+  /* TURN_RIGHT        */ {{BACKWARD, BACKWARD, FORWARD,  FORWARD},  false, RAMP_TURN,   "Turning right"},
+  /* HAND_LEFT_RAISED  */ {{FORWARD,  FORWARD,  FORWARD,  FORWARD},  true,  RAMP_DRIVE,  "Left hand raised - Moving forward with staged startup"},
+  /* HAND_RIGHT_RAISED */ {{BACKWARD, BACKWARD, BACKWARD, BACKWARD}, false, RAMP_DRIVE,  "Right hand raised - Moving backward"},
+  /* HAND_BOTH_RAISED  */ {{STOP,     STOP,     STOP,     STOP},     false, RAMP_DRIVE,  "Both hands raised - Stopping"},
+  /* HAND_NONE_RAISED  */ {{STOP,     STOP,     STOP,     STOP},     false, RAMP_DRIVE,  "No hands raised - Stopping"},
+  /* TRACK_LEFT        */ {{FORWARD,  FORWARD,  BACKWARD, BACKWARD}, false, RAMP_TURN,   "Tracking left - adjusting car orientation"},
+  /* TRACK_RIGHT       */ {{BACKWARD, BACKWARD, FORWARD,  FORWARD},  false, RAMP_TURN,   "Tracking right - adjusting car orientation"},
+  /* TRACK_CENTER      */ {{STOP,     STOP,     STOP,     STOP},     false, RAMP_TURN,   "Target centered - stopping orientation adjustment"},
+};
+
+static_assert(sizeof(MOTION_SPECS) / sizeof(MOTION_SPECS[0]) == LAST_COMMAND + 1,
+              "MOTION_SPECS needs exactly one row per command id");
+
+// Motor task only (and before it starts)
+void rebuildMotionTable(const Calibration &calibration);
+
+// Unknown ids fall back to the STOP row
+const MotionRow &motionForCommand(int command);
+
+#endif // MOTION_TABLE_H
@@ -0,0 +1,994 @@
+/*
+ * SMART CAR MOTOR DIRECTION CALIBRATION
+ * 
+ * If any motor rotates backwards during the startup test:
+ * 1. Find the motor number from the test output
+ * 2. Set its entry in motors.direction_correction in config.yaml to -1
+ * 3. Run generate_arduino_config.py and reflash, or try it live first
+ *    with POST /calibration direction_correction=-1,1,1,1 (calibration.h)
+ * 
+ * Example: If FRONT_RIGHT_MOTOR (motor 0) rotates backwards:
+ * Change: direction_correction: [1, 1, 1, 1]
+ * To:     direction_correction: [-1, 1, 1, 1]
+ * 
+ * Motor Numbers:
+ * 0 = FRONT_RIGHT_MOTOR
+ * 1 = BACK_RIGHT_MOTOR  
+ * 2 = FRONT_LEFT_MOTOR
+ * 3 = BACK_LEFT_MOTOR
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#include "arduino_config.h"
+#include "battery_monitor.h"
+#include "calibration.h"
+#include "car_commands.h"
+#include "car_log.h"
+#include "hal.h"
+#include "metrics.h"
+#include "command_queue.h"
+#include "control_arbiter.h"
+#include "flight_recorder.h"
+#include "jitter_buffer.h"
+#include "mecanum_mix.h"
+#include "motion_script.h"
+#include "motion_table.h"
+#include "motor_control.h"
+#include "motor_ramp.h"
+#include "pwm_frame.h"
+#include "tracking_control.h"
+#include "wheel_speed.h"
+
+// IN1/IN2 pins per motor come from motor_pins in config.yaml
+static_assert(sizeof(MOTOR_PINS) / sizeof(MOTOR_PINS[0]) == MOTOR_COUNT, "MOTOR_PINS needs one pin pair per motor");
+
+// Motor task notification bits
+#define MOTOR_EVENT_COMMAND (1UL << 0)
+#define MOTOR_EVENT_STOP (1UL << 1)
+#define MOTOR_EVENT_STAGE (1UL << 2)
+#define MOTOR_EVENT_RAMP (1UL << 3)
+#define MOTOR_EVENT_SPEED (1UL << 4)
+#define MOTOR_EVENT_CALIBRATE (1UL << 5)
+#define MOTOR_EVENT_SCRIPT (1UL << 6)
+#define MOTOR_EVENT_TRACK (1UL << 7)
+#define MOTOR_EVENT_BATCH (1UL << 8)
+#define MOTOR_EVENT_BATTERY (1UL << 9)
+
+// Commands from the network tasks to the motor task, which owns the LEDC channels
+static SpscQueue<CarCommand, COMMAND_QUEUE_DEPTH> commandQueues[PRODUCER_COUNT];
+static std::atomic<uint32_t> commandsProcessed[PRODUCER_COUNT];
+static std::atomic<uint32_t> commandsDiscarded[PRODUCER_COUNT];
+static HalTask motorTaskHandle = nullptr;
+static std::atomic<bool> stopRequested{false};
+
+// When each periodic loop's timer last fired, for the wake latency metric
+static std::atomic<uint32_t> loopFiredMicros[LOOP_COUNT];
+
+// Staged start-up state, only touched by the motor task
+static HalTimer stagedStartTimer = nullptr;
+static int64_t stagedStartMicros = 0;
+static const MotionRow *stagedRow = nullptr;
+static uint8_t stagedMotorsPending = 0;
+
+// Ramp tick timer, runs only while a ramp is in progress
+static HalTimer rampTimer = nullptr;
+static bool rampTimerRunning = false;
+
+// Wheel speed loop timer, only created when encoders are enabled
+static HalTimer speedLoopTimer = nullptr;
+
+// Command lease state, only touched by the motor task
+static bool leaseActive = false;
+static uint32_t leaseDeadlineMillis = 0;
+static std::atomic<uint32_t> leaseExpiries{0};
+
+// Output-state cache: the motion the channels are currently heading for,
+// so a repeated command only renews the lease. Motor task only.
+static CarCommand activeMotion;
+static bool activeMotionValid = false;
+
+// Motion script state: uploads come from the AsyncTCP task, the rest is
+// only touched by the motor task
+static SpscQueue<MotionScript, 1> scriptQueue;
+static MotionScript runningScript;
+static bool scriptRunning = false;
+static int scriptSegment = 0;
+static int64_t scriptSegmentEndMicros = 0;
+static HalTimer scriptTimer = nullptr;
+
+// On-device tracking controller tick, runs only while a target is tracked.
+// Motor task only.
+static HalTimer trackerTimer = nullptr;
+static bool trackerTimerRunning = false;
+static bool trackerDriving = false;  // last tick applied a turn
+static bool trackerFresh = false;    // an observation arrived since the last tick
+static CarCommand trackerObservation;
+
+// Timestamped batches from the network tasks; the jitter buffer and its
+// play-out timer belong to the motor task
+static SpscQueue<CommandBatch, 2> batchQueues[PRODUCER_COUNT];
+static CommandBatch arrivingBatch;
+static HalTimer playoutTimer = nullptr;
+
+static void writeMotorChannels(int motorNumber, const uint16_t *duty, uint8_t rampClass)
+{
+  rampSetMotor(motorNumber, duty[motorNumber * 2],  // pinIN1
+               duty[motorNumber * 2 + 1],           // pinIN2
+               rampClass);
+}
+
+static void writeMotionRow(const MotionRow &row)
+{
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    writeMotorChannels(i, row.duty, row.ramp);
+  }
+}
+
+// Drive one motor at a signed duty; positive is forward after direction correction
+void setMotorDuty(int motorNumber, int duty, uint8_t rampClass)
+{
+  const Calibration &calibration = activeCalibration();
+  int maxSpeed = calibration.maxSpeed;
+  int correctedDuty = std::min(std::max(duty, -maxSpeed), maxSpeed) * calibration.directionCorrection[motorNumber];
+
+  rampSetMotor(motorNumber, correctedDuty > 0 ? correctedDuty : 0,  // pinIN1
+               correctedDuty < 0 ? -correctedDuty : 0,              // pinIN2
+               rampClass);
+}
+
+static void onRampTimer(void *arg)
+{
+  loopFiredMicros[LOOP_RAMP].store(halMicros(), std::memory_order_relaxed);
+  halNotify(motorTaskHandle, MOTOR_EVENT_RAMP);
+}
+
+static void onSpeedLoopTimer(void *arg)
+{
+  loopFiredMicros[LOOP_SPEED].store(halMicros(), std::memory_order_relaxed);
+  halNotify(motorTaskHandle, MOTOR_EVENT_SPEED);
+}
+
+static void recordTick(uint8_t loop, uint32_t periodMicros, uint32_t passMicros)
+{
+  recordLoopTick(loop, periodMicros, loopFiredMicros[loop].load(std::memory_order_relaxed), passMicros);
+}
+
+// Keep the tick timer running exactly as long as some channel is still ramping
+static void updateRampTimer()
+{
+  bool ramping = rampInProgress();
+
+  if (ramping && !rampTimerRunning)
+  {
+    restartLoopTiming(LOOP_RAMP);
+    halTimerStartPeriodic(rampTimer, RAMP_TICK_MS * 1000);
+  }
+  else if (!ramping && rampTimerRunning)
+  {
+    halTimerStop(rampTimer);
+  }
+  rampTimerRunning = ramping;
+}
+
+// Staged start-up: each motor starts its calibrated startup offset after the
+// command, driven by a one-shot esp_timer so the motor task never sleeps.
+// Any new command cancels a stagger that is still in progress.
+void cancelStagedStart()
+{
+  if (stagedMotorsPending != 0)
+  {
+    halTimerStop(stagedStartTimer);
+    stagedMotorsPending = 0;
+  }
+}
+
+static void armStagedStart()
+{
+  int64_t elapsedMs = (halMicros64() - stagedStartMicros) / 1000;
+  int nextOffset = INT_MAX;
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if (stagedMotorsPending & (1 << i))
+    {
+      nextOffset = std::min(nextOffset, (int)activeCalibration().startupOffsets[i]);
+    }
+  }
+
+  int64_t waitMs = nextOffset - elapsedMs;
+  halTimerStartOnce(stagedStartTimer, waitMs > 0 ? waitMs * 1000 : 0);
+}
+
+static void runStagedStart()
+{
+  int64_t elapsedMs = (halMicros64() - stagedStartMicros) / 1000;
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if ((stagedMotorsPending & (1 << i)) && activeCalibration().startupOffsets[i] <= elapsedMs)
+    {
+      writeMotorChannels(i, stagedRow->duty, stagedRow->ramp);
+      stagedMotorsPending &= ~(1 << i);
+    }
+  }
+  pwmFrameCommit();
+
+  if (stagedMotorsPending != 0)
+  {
+    armStagedStart();
+  }
+  else
+  {
+    LOG_DEBUG("Staged start-up complete");
+  }
+}
+
+static void onStagedStartTimer(void *arg)
+{
+  halNotify(motorTaskHandle, MOTOR_EVENT_STAGE);
+}
+
+static void startMotionStaged(const MotionRow &row)
+{
+  stagedStartMicros = halMicros64();
+  stagedRow = &row;
+  stagedMotorsPending = (1 << MOTOR_COUNT) - 1;
+
+  // Motors waiting for their slot hold still rather than keep the previous motion
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if (activeCalibration().startupOffsets[i] > 0)
+    {
+      writeMotorChannels(i, motionForCommand(STOP).duty, row.ramp);
+    }
+  }
+  runStagedStart();
+}
+
+void processCarMovement(int command)
+{
+  const MotionRow &row = motionForCommand(command);
+
+  activeMotion = CarCommand();
+  activeMotion.opcode = PROTO_OP_COMMAND;
+  activeMotion.command = command;
+  activeMotionValid = true;
+
+  LOG_DEBUG("Got value as %d: %s", command, row.description);
+  cancelStagedStart();
+
+  if (row.stagedStart)
+  {
+    startMotionStaged(row);
+  }
+  else
+  {
+    writeMotionRow(row);
+  }
+  pwmFrameCommit();
+}
+
+void executeCarCommand(const CarCommand &command)
+{
+  switch (command.opcode)
+  {
+    case PROTO_OP_MOTOR_DUTY:
+      LOG_DEBUG("Got motor duty %d %d %d %d (seq %u)", command.motorDuty[0], command.motorDuty[1],
+                    command.motorDuty[2], command.motorDuty[3], command.sequence);
+      cancelStagedStart();
+      for (int i = 0; i < MOTOR_COUNT; i++)
+      {
+        setMotorDuty(i, command.motorDuty[i], RAMP_DIRECT);
+      }
+      break;
+
+    case PROTO_OP_TURN:
+    {
+      int duty = turnRateToDuty(command.turnRate);
+      LOG_DEBUG("Got turn rate %d -> duty %d (seq %u)", command.turnRate, duty, command.sequence);
+      cancelStagedStart();
+      setMotorDuty(FRONT_RIGHT_MOTOR, -duty, RAMP_TURN);
+      setMotorDuty(BACK_RIGHT_MOTOR, -duty, RAMP_TURN);
+      setMotorDuty(FRONT_LEFT_MOTOR, duty, RAMP_TURN);
+      setMotorDuty(BACK_LEFT_MOTOR, duty, RAMP_TURN);
+      break;
+    }
+
+    case PROTO_OP_VELOCITY:
+    {
+      int duty[MOTOR_COUNT];
+      mixBodyVelocity(command.velocity, activeCalibration().maxSpeed, duty);
+      LOG_DEBUG("Got velocity %d %d %d -> duty %d %d %d %d (seq %u)", command.velocity.vx, command.velocity.vy,
+                command.velocity.omega, duty[0], duty[1], duty[2], duty[3], command.sequence);
+      cancelStagedStart();
+      for (int i = 0; i < MOTOR_COUNT; i++)
+      {
+        setMotorDuty(i, duty[i], RAMP_DRIVE);
+      }
+      break;
+    }
+
+    case PROTO_OP_COMMAND:
+    default:
+      processCarMovement(command.command);
+      break;
+  }
+  activeMotion = command;
+  activeMotionValid = true;
+  pwmFrameCommit();
+}
+
+// Same outputs as the motion already set up, whatever the source or sequence
+static bool repeatsActiveMotion(const CarCommand &command)
+{
+  if (!activeMotionValid || command.opcode != activeMotion.opcode)
+  {
+    return false;
+  }
+
+  switch (command.opcode)
+  {
+    case PROTO_OP_MOTOR_DUTY:
+      return memcmp(command.motorDuty, activeMotion.motorDuty, sizeof(command.motorDuty)) == 0;
+
+    case PROTO_OP_TURN:
+      return command.turnRate == activeMotion.turnRate;
+
+    case PROTO_OP_VELOCITY:
+      return command.velocity.vx == activeMotion.velocity.vx && command.velocity.vy == activeMotion.velocity.vy &&
+             command.velocity.omega == activeMotion.velocity.omega;
+
+    case PROTO_OP_COMMAND:
+    default:
+      return command.command == activeMotion.command;
+  }
+}
+
+// A repeat of the active motion leaves the outputs alone; false then
+static bool applyMotion(const CarCommand &command)
+{
+  bool repeated = repeatsActiveMotion(command);
+
+  recordCommandCache(repeated);
+  if (!repeated)
+  {
+    executeCarCommand(command);
+  }
+  return !repeated;
+}
+
+void setUpPinModes()
+{
+  // One LEDC timer for every motor channel so a frame latches on a single edge
+  pwmFrameSetup();
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    // Attach pins to PWM channels
+    pwmFrameAttach(i * 2, MOTOR_PINS[i][0]);
+    pwmFrameAttach(i * 2 + 1, MOTOR_PINS[i][1]);
+    
+    // Initialize motors to stop
+    writeMotorChannels(i, motionForCommand(STOP).duty, RAMP_STOP);
+  }
+  pwmFrameCommit();
+  setUpWheelEncoders();
+}
+
+// Command lease: a command that moves the car is only valid for
+// COMMAND_LEASE_MS; the motor task stops the car itself unless a newer
+// command renews it. 0 disables the lease.
+static bool commandMoves(const CarCommand &command)
+{
+  switch (command.opcode)
+  {
+    case PROTO_OP_MOTOR_DUTY:
+      for (int i = 0; i < MOTOR_COUNT; i++)
+      {
+        if (command.motorDuty[i] != 0)
+        {
+          return true;
+        }
+      }
+      return false;
+
+    case PROTO_OP_TURN:
+      return turnRateToDuty(command.turnRate) != 0;
+
+    case PROTO_OP_VELOCITY:
+      return command.velocity.vx != 0 || command.velocity.vy != 0 || command.velocity.omega != 0;
+
+    case PROTO_OP_COMMAND:
+    default:
+    {
+      const MotionRow &row = motionForCommand(command.command);
+      for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+      {
+        if (row.duty[channel] != 0)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+}
+
+// Flight recorder entry with the targets the motors are heading for,
+// including those still waiting for their staged start
+static void record(uint8_t kind, const CarCommand &command)
+{
+  const Calibration &calibration = activeCalibration();
+  int16_t duty[MOTOR_COUNT];
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    int target = (stagedMotorsPending & (1 << i)) ? stagedRow->duty[i * 2] - stagedRow->duty[i * 2 + 1]
+                                                   : rampTargetDuty(i);
+    duty[i] = target * calibration.directionCorrection[i];
+  }
+  recordEvent(kind, command, duty);
+}
+
+static void renewLease(bool moves)
+{
+  leaseActive = COMMAND_LEASE_MS > 0 && moves;
+  leaseDeadlineMillis = halMillis() + COMMAND_LEASE_MS;
+}
+
+uint32_t motorTaskTimeoutMillis()
+{
+  if (!leaseActive)
+  {
+    return HAL_WAIT_FOREVER;
+  }
+
+  int32_t remaining = (int32_t)(leaseDeadlineMillis - halMillis());
+  return remaining > 0 ? remaining : 0;
+}
+
+static void expireLease()
+{
+  if (leaseActive && (int32_t)(halMillis() - leaseDeadlineMillis) >= 0)
+  {
+    LOG_WARN("Command lease expired after %lu ms, stopping", (unsigned long)COMMAND_LEASE_MS);
+    leaseActive = false;
+    leaseExpiries.fetch_add(1, std::memory_order_relaxed);
+    CarCommand expired = activeMotion;
+    processCarMovement(STOP);
+    record(RECORD_LEASE_EXPIRED, expired);
+  }
+}
+
+// Target duty per motor, positive = forward, for the control state broadcast
+static void publishMotorState()
+{
+  int16_t duty[MOTOR_COUNT];
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    duty[i] = rampTargetDuty(i) * activeCalibration().directionCorrection[i];
+  }
+  publishControlState(duty);
+}
+
+static void onScriptTimer(void *arg)
+{
+  halNotify(motorTaskHandle, MOTOR_EVENT_SCRIPT);
+}
+
+static void publishScript(uint8_t state)
+{
+  ScriptProgress progress = {runningScript.id, (uint8_t)scriptSegment, runningScript.count, state};
+  publishScriptProgress(progress);
+}
+
+static void abortScript()
+{
+  if (scriptRunning)
+  {
+    scriptRunning = false;
+    halTimerStop(scriptTimer);
+    publishScript(SCRIPT_ABORTED);
+    LOG_INFO("Script %u aborted in segment %d", runningScript.id, scriptSegment);
+  }
+}
+
+// Wake at the end of the segment, and often enough in between to keep the
+// script's ownership of control from lapsing during a long segment
+static void armScriptTimer()
+{
+  int64_t now = halMicros64();
+  int64_t wake = scriptSegmentEndMicros;
+
+  if (ARBITER_LEASE_MS > 0)
+  {
+    wake = std::min(wake, now + (int64_t)ARBITER_LEASE_MS * 500);
+  }
+  halTimerStop(scriptTimer);
+  halTimerStartOnce(scriptTimer, wake > now ? wake - now : 0);
+}
+
+static void onTrackerTimer(void *arg)
+{
+  loopFiredMicros[LOOP_TRACKER].store(halMicros(), std::memory_order_relaxed);
+  halNotify(motorTaskHandle, MOTOR_EVENT_TRACK);
+}
+
+static void stopTracking()
+{
+  trackerReset();
+  if (trackerTimerRunning)
+  {
+    halTimerStop(trackerTimer);
+    trackerTimerRunning = false;
+  }
+  trackerDriving = false;
+}
+
+// One control tick: the turn goes through arbitration and the output
+// cache like a PROTO_OP_TURN frame from the observing source
+static void stepTracker()
+{
+  CarCommand command = {};
+  command.opcode = PROTO_OP_TURN;
+  command.turnRate = (int16_t)trackerStep(halMillis());
+  command.source = trackerObservation.source;
+  command.receivedMicros = trackerObservation.receivedMicros;
+  command.decodedMicros = trackerObservation.decodedMicros;
+
+  bool moves = commandMoves(command);
+  bool wasDriving = trackerDriving;
+  if (!trackerActive())
+  {
+    LOG_INFO("Tracking target lost, stopping");
+    stopTracking();
+  }
+
+  // Centred ticks only matter when they end a turn; otherwise they would
+  // keep taking control back from other sources
+  if ((!moves && !wasDriving) || !arbitrateCommand(command, moves))
+  {
+    return;
+  }
+
+  abortScript();
+  applyMotion(command);
+  if (trackerFresh)
+  {
+    recordCommandApplied(command, halMicros());
+    trackerFresh = false;
+  }
+  trackerDriving = moves;
+  renewLease(moves);
+}
+
+// The first usable observation starts the ticks and steers at once
+static void observeTarget(const CarCommand &command)
+{
+  if (!trackerObserve(command.target, halMillis()))
+  {
+    return;
+  }
+
+  trackerObservation = command;
+  trackerFresh = true;
+  if (!trackerTimerRunning)
+  {
+    restartLoopTiming(LOOP_TRACKER);
+    halTimerStartPeriodic(trackerTimer, 1000000 / TRACKER_RATE_HZ);
+    trackerTimerRunning = true;
+    stepTracker();
+  }
+}
+
+// A new upload replaces whatever script is running
+static void startQueuedScript()
+{
+  if (scriptQueue.size() == 0)
+  {
+    return;
+  }
+  abortScript();
+  scriptQueue.pop(runningScript);
+  scriptSegment = 0;
+
+  // Stopped segments still hold control, so arbitrate every segment as moving
+  CarCommand command = segmentCommand(runningScript, 0);
+  if (!arbitrateCommand(command, true))
+  {
+    record(RECORD_REJECTED, command);
+    publishScript(SCRIPT_REJECTED);
+    LOG_WARN("Script %u rejected: %s owns control", runningScript.id, sourceName(getControlState().owner));
+    return;
+  }
+
+  LOG_INFO("Script %u started: %u segments", runningScript.id, runningScript.count);
+  stopTracking();
+  scriptRunning = true;
+  leaseActive = false;
+  scriptSegmentEndMicros = halMicros64() + runningScript.segments[0].durationMs * 1000LL;
+  bool changed = applyMotion(command);
+  recordCommandApplied(command, halMicros());
+  record(changed ? RECORD_APPLIED : RECORD_REPEATED, command);
+  publishScript(SCRIPT_RUNNING);
+  armScriptTimer();
+}
+
+// The schedule is fixed when the script starts, so late wakeups never
+// stretch the segments after them
+static void stepScript()
+{
+  int64_t now = halMicros64();
+  int segment = scriptSegment;
+
+  while (now >= scriptSegmentEndMicros && ++segment < runningScript.count)
+  {
+    scriptSegmentEndMicros += runningScript.segments[segment].durationMs * 1000LL;
+  }
+
+  CarCommand command = segmentCommand(runningScript, std::min(segment, runningScript.count - 1));
+  if (segment == runningScript.count)
+  {
+    // Finished: stop the car and hand back control
+    scriptRunning = false;
+    command.opcode = PROTO_OP_COMMAND;
+    command.command = STOP;
+    arbitrateCommand(command, false);
+    applyMotion(command);
+    publishScript(SCRIPT_DONE);
+    LOG_INFO("Script %u done", runningScript.id);
+    return;
+  }
+
+  arbitrateCommand(command, true);
+  if (segment != scriptSegment)
+  {
+    scriptSegment = segment;
+    applyMotion(command);
+    publishScript(SCRIPT_RUNNING);
+  }
+  armScriptTimer();
+}
+
+static void handleLiveCommand(const CarCommand &command)
+{
+  if (command.opcode == PROTO_OP_OBSERVE)
+  {
+    observeTarget(command);
+    record(RECORD_OBSERVATION, command);
+    return;
+  }
+
+  bool moves = commandMoves(command);
+  if (!arbitrateCommand(command, moves))
+  {
+    record(RECORD_REJECTED, command);
+    return;
+  }
+
+  // Live control always wins over a running script or the tracker
+  abortScript();
+  stopTracking();
+  bool changed = applyMotion(command);
+  recordCommandApplied(command, halMicros());
+  renewLease(moves);
+  record(command.disconnect ? RECORD_DISCONNECT_STOP : changed ? RECORD_APPLIED : RECORD_REPEATED, command);
+}
+
+static void onPlayoutTimer(void *arg)
+{
+  halNotify(motorTaskHandle, MOTOR_EVENT_BATCH);
+}
+
+// Buffer new batches, play whatever is due and wake again for the next
+static void serviceJitterBuffer()
+{
+  for (int producer = 0; producer < PRODUCER_COUNT; producer++)
+  {
+    while (batchQueues[producer].pop(arrivingBatch))
+    {
+      jitterAddBatch(arrivingBatch, halMicros64());
+    }
+  }
+
+  CarCommand command;
+  while (jitterTakeDue(halMicros64(), command))
+  {
+    handleLiveCommand(command);
+  }
+
+  int64_t due;
+  halTimerStop(playoutTimer);
+  if (jitterNextDue(due))
+  {
+    int64_t now = halMicros64();
+    halTimerStartOnce(playoutTimer, due > now ? due - now : 0);
+  }
+}
+
+// New calibration: the car stops at once, without ramps, and the outputs
+// are retimed before any further command sees the new values
+static void applyQueuedCalibration()
+{
+  Calibration calibration;
+
+  if (!takeQueuedCalibration(calibration))
+  {
+    return;
+  }
+
+  abortScript();
+  stopTracking();
+  jitterClear();
+  cancelStagedStart();
+  leaseActive = false;
+  activeMotionValid = false;
+  rampReset();
+  setActiveCalibration(calibration);
+  pwmFrameSetup();
+  pwmFrameCommit();
+  LOG_INFO("Calibration applied: max speed %u, %lu Hz, %u bits", calibration.maxSpeed,
+           (unsigned long)calibration.pwmFrequency, calibration.pwmResolution);
+}
+
+// Everything the network tasks queued, batches and buffered play-out included
+static void discardQueuedCommands()
+{
+  CarCommand command;
+  for (int producer = 0; producer < PRODUCER_COUNT; producer++)
+  {
+    while (commandQueues[producer].pop(command))
+    {
+      commandsDiscarded[producer].fetch_add(1, std::memory_order_relaxed);
+    }
+    while (batchQueues[producer].pop(arrivingBatch))
+    {
+    }
+  }
+  jitterClear();
+}
+
+void runMotorTaskOnce(uint32_t events)
+{
+  uint32_t passMicros = halMicros();
+
+  if (events & MOTOR_EVENT_RAMP)
+  {
+    recordTick(LOOP_RAMP, RAMP_TICK_MS * 1000, passMicros);
+    rampStep();
+    pwmFrameCommit();
+  }
+
+  // After the ramp tick, so the loop trims this period's feed-forward duty
+  if (events & MOTOR_EVENT_SPEED)
+  {
+    recordTick(LOOP_SPEED, 1000000 / SPEED_LOOP_HZ, passMicros);
+    wheelSpeedStep();
+    pwmFrameCommit();
+  }
+
+  // A STOP that could not be queued still wins over anything pending:
+  // the commands and batches queued before it are dropped, not replayed
+  // after it
+  if (stopRequested.exchange(false))
+  {
+    discardQueuedCommands();
+    abortScript();
+    stopTracking();
+    processCarMovement(STOP);
+    leaseActive = false;
+    CarCommand stop = activeMotion;
+    stop.source = OWNER_NONE;
+    stop.receivedMicros = passMicros;
+    record(RECORD_STOP_REQUESTED, stop);
+  }
+
+  if (events & MOTOR_EVENT_CALIBRATE)
+  {
+    applyQueuedCalibration();
+  }
+
+  if (events & MOTOR_EVENT_BATTERY)
+  {
+    rampSetOutputScale(batteryOutputScale());
+    pwmFrameCommit();
+  }
+
+  CarCommand command;
+  for (int producer = 0; producer < PRODUCER_COUNT; producer++)
+  {
+    while (commandQueues[producer].pop(command))
+    {
+      commandsProcessed[producer].fetch_add(1, std::memory_order_relaxed);
+      // Batched commands still waiting would only fight the next source
+      if (command.disconnect)
+      {
+        jitterDropSource(command.source);
+      }
+      handleLiveCommand(command);
+    }
+  }
+
+  // Batches and play-out times; a stale timer event finds nothing due
+  if (events & MOTOR_EVENT_BATCH)
+  {
+    serviceJitterBuffer();
+  }
+
+  // A stale tick after the tracker stopped finds it idle
+  if ((events & MOTOR_EVENT_TRACK) && trackerTimerRunning)
+  {
+    recordTick(LOOP_TRACKER, 1000000 / TRACKER_RATE_HZ, passMicros);
+    stepTracker();
+  }
+
+  // Uploads and segment ends; a stale timer event finds no script running
+  if (events & MOTOR_EVENT_SCRIPT)
+  {
+    startQueuedScript();
+    if (scriptRunning)
+    {
+      stepScript();
+    }
+  }
+
+  // Skip stale timer events for a stagger a newer command already cancelled
+  if ((events & MOTOR_EVENT_STAGE) && stagedMotorsPending != 0)
+  {
+    runStagedStart();
+  }
+
+  expireLease();
+  updateRampTimer();
+  publishMotorState();
+  recordMotorPass(halMicros() - passMicros);
+}
+
+static void motorTask(void *parameter)
+{
+  for (;;)
+  {
+    runMotorTaskOnce(halWaitForNotify(motorTaskTimeoutMillis()));
+  }
+}
+
+void startMotorTask()
+{
+  stagedStartTimer = halTimerCreate(onStagedStartTimer, "staged_start");
+  rampTimer = halTimerCreate(onRampTimer, "motor_ramp");
+  scriptTimer = halTimerCreate(onScriptTimer, "motion_script");
+  trackerTimer = halTimerCreate(onTrackerTimer, "tracker");
+  playoutTimer = halTimerCreate(onPlayoutTimer, "jitter_playout");
+
+  halStartTask(motorTask, "motor", 4096, MOTOR_TASK_PRIORITY, MOTOR_TASK_CORE, &motorTaskHandle);
+
+  if (ENCODERS_ENABLED)
+  {
+    speedLoopTimer = halTimerCreate(onSpeedLoopTimer, "speed_loop");
+    restartLoopTiming(LOOP_SPEED);
+    halTimerStartPeriodic(speedLoopTimer, 1000000 / SPEED_LOOP_HZ);
+  }
+}
+
+bool submitCarCommand(const CarCommand &command, CommandProducer producer)
+{
+  bool queued = commandQueues[producer].push(command);
+  uint32_t event = MOTOR_EVENT_COMMAND;
+
+  if (!queued && command.opcode == PROTO_OP_COMMAND && command.command == STOP)
+  {
+    stopRequested.store(true);
+    event = MOTOR_EVENT_STOP;
+  }
+
+  if (motorTaskHandle != nullptr)
+  {
+    halNotify(motorTaskHandle, event);
+  }
+  return queued;
+}
+
+bool submitTurnRate(int turnRate, uint8_t source, uint32_t receivedMicros)
+{
+  CarCommand command = {};
+  command.opcode = PROTO_OP_TURN;
+  command.turnRate = (int16_t)std::min(std::max(turnRate, -TRACKING_RATE_LIMIT), TRACKING_RATE_LIMIT);
+  command.source = source;
+  command.receivedMicros = receivedMicros;
+  command.decodedMicros = halMicros();
+  return submitCarCommand(command);
+}
+
+bool submitCarMovement(uint8_t movement, uint8_t source, uint32_t receivedMicros)
+{
+  CarCommand command = {};
+  command.opcode = PROTO_OP_COMMAND;
+  command.command = movement;
+  command.source = source;
+  command.receivedMicros = receivedMicros;
+  command.decodedMicros = halMicros();
+  return submitCarCommand(command);
+}
+
+bool submitCommandBatch(const CommandBatch &batch, CommandProducer producer)
+{
+  if (!batchQueues[producer].push(batch))
+  {
+    return false;
+  }
+
+  if (motorTaskHandle != nullptr)
+  {
+    halNotify(motorTaskHandle, MOTOR_EVENT_BATCH);
+  }
+  return true;
+}
+
+bool submitMotionScript(const MotionScript &script)
+{
+  if (!scriptQueue.push(script))
+  {
+    return false;
+  }
+
+  if (motorTaskHandle != nullptr)
+  {
+    halNotify(motorTaskHandle, MOTOR_EVENT_SCRIPT);
+  }
+  return true;
+}
+
+bool submitCalibration(const Calibration &calibration)
+{
+  if (!queueCalibration(calibration))
+  {
+    return false;
+  }
+
+  if (motorTaskHandle != nullptr)
+  {
+    halNotify(motorTaskHandle, MOTOR_EVENT_CALIBRATE);
+  }
+  return true;
+}
+
+void requestOutputRescale()
+{
+  if (motorTaskHandle != nullptr)
+  {
+    halNotify(motorTaskHandle, MOTOR_EVENT_BATTERY);
+  }
+}
+
+void requestMotorStop()
+{
+  stopRequested.store(true);
+  if (motorTaskHandle != nullptr)
+  {
+    halNotify(motorTaskHandle, MOTOR_EVENT_STOP);
+  }
+}
+
+uint32_t getLeaseExpiryCount()
+{
+  return leaseExpiries.load(std::memory_order_relaxed);
+}
+
+MotorQueueStats getMotorQueueStats(CommandProducer producer)
+{
+  const SpscQueue<CarCommand, COMMAND_QUEUE_DEPTH> &queue = commandQueues[producer];
+  MotorQueueStats stats;
+  stats.depth = queue.size();
+  stats.capacity = queue.capacity();
+  stats.highWatermark = queue.highWatermark();
+  stats.overflows = queue.overflows();
+  stats.processed = commandsProcessed[producer].load(std::memory_order_relaxed);
+  stats.discarded = commandsDiscarded[producer].load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,86 @@
+/*
+ * Motor layer: LEDC channel setup, motion commands and the motor task.
+ *
+ * Network handlers never touch the LEDC channels. They push decoded
+ * commands into a lock-free queue that the motor task drains.
+ *
+ * Every command that moves the car holds a lease of COMMAND_LEASE_MS:
+ * if no further command arrives in that time the motor task stops the
+ * car on its own, so clients can stream without waiting for replies.
+ */
+
+#ifndef MOTOR_CONTROL_H
+#define MOTOR_CONTROL_H
+
+#include <stdint.h>
+
+#include "calibration.h"
+#include "command_protocol.h"
+#include "jitter_buffer.h"
+#include "motion_script.h"
+
+struct MotorQueueStats
+{
+  uint32_t depth;
+  uint32_t capacity;
+  uint32_t highWatermark;
+  uint32_t overflows;
+  uint32_t processed;
+  uint32_t discarded;  // dropped by a STOP that could not be queued
+};
+
+// Every task that submits commands gets its own single-producer queue
+enum CommandProducer
+{
+  PRODUCER_ASYNC_TCP,  // WebSocket events and HTTP handlers
+  PRODUCER_UDP,        // AsyncUDP packet callback
+  PRODUCER_COUNT
+};
+
+void setUpPinModes();
+void startMotorTask();
+
+// One pass of the motor task over the notification bits it woke up with,
+// and how long it may then wait for the next ones (HAL_WAIT_FOREVER when
+// no lease is running). The task loops over these; the host build calls
+// them directly to step the task deterministically.
+void runMotorTaskOnce(uint32_t events);
+uint32_t motorTaskTimeoutMillis();
+
+// Queue a decoded command for the motor task. Only call these from the
+// task that owns the given producer slot. Returns false when the queue was
+// full; a STOP that does not fit is still applied, and the commands
+// queued before it are dropped.
+// Commands must carry their source and receive/decode timestamps.
+bool submitCarCommand(const CarCommand &command, CommandProducer producer = PRODUCER_ASYNC_TCP);
+bool submitCarMovement(uint8_t movement, uint8_t source, uint32_t receivedMicros);
+bool submitTurnRate(int turnRate, uint8_t source, uint32_t receivedMicros);
+
+// Hand a decoded batch to the motor task's jitter buffer. Only call from
+// the task that owns the producer slot; false when two batches are
+// already waiting. The batch must carry its source and timestamps.
+bool submitCommandBatch(const CommandBatch &batch, CommandProducer producer = PRODUCER_ASYNC_TCP);
+
+// Run a decoded script on the motor task, replacing any that is running.
+// Only call from the AsyncTCP task; false while an earlier upload has not
+// been picked up yet.
+bool submitMotionScript(const MotionScript &script);
+
+// Hand validated calibration values to the motor task, which stops the car
+// and applies them before its next command. Only call from the AsyncTCP
+// task; false while an earlier calibration is still waiting.
+bool submitCalibration(const Calibration &calibration);
+
+// Stop the car ahead of anything queued; safe to call from any task
+void requestMotorStop();
+
+// The battery monitor's output scale changed: the motor task restages
+// every channel with it. Safe to call from any task.
+void requestOutputRescale();
+
+MotorQueueStats getMotorQueueStats(CommandProducer producer = PRODUCER_ASYNC_TCP);
+
+// Times the car stopped itself because no command renewed the lease
+uint32_t getLeaseExpiryCount();
+
+#endif // MOTOR_CONTROL_H
@@ -0,0 +1,179 @@
+#include <algorithm>
+
+#include "arduino_config.h"
+#include "car_commands.h"
+#include "calibration.h"
+#include "motor_ramp.h"
+#include "pwm_frame.h"
+
+static_assert(RAMP_CLASS_COUNT == sizeof(RAMP_ACCEL_MS) / sizeof(RAMP_ACCEL_MS[0]),
+              "RAMP_ACCEL_MS needs one entry per ramp class");
+static_assert(RAMP_CLASS_COUNT == sizeof(RAMP_DECEL_MS) / sizeof(RAMP_DECEL_MS[0]),
+              "RAMP_DECEL_MS needs one entry per ramp class");
+
+// Duties are kept in 1/256 steps so slow slopes still move every tick
+#define RAMP_FRACTION_BITS 8
+
+static int32_t currentDuty[MOTOR_CHANNEL_COUNT];
+static int32_t targetDuty[MOTOR_CHANNEL_COUNT];
+static int32_t stepDuty[MOTOR_CHANNEL_COUNT];
+static int trimDuty[MOTOR_COUNT];
+static uint32_t outputScale = RAMP_SCALE_ONE;
+
+// Closed-loop trim only applies to an input that is already driving
+static uint32_t outputDuty(int channel, int32_t current)
+{
+  int duty = current >> RAMP_FRACTION_BITS;
+
+  if (duty > 0 && trimDuty[channel / 2] != 0)
+  {
+    duty = std::min(std::max(duty + trimDuty[channel / 2], 0), (int)activeCalibration().maxSpeed);
+  }
+  if (duty > 0 && outputScale != RAMP_SCALE_ONE)
+  {
+    uint32_t fullScale = (1UL << activeCalibration().pwmResolution) - 1;
+    duty = (int)std::min((uint32_t)(((uint64_t)duty * outputScale + RAMP_SCALE_ONE / 2) >> 16), fullScale);
+  }
+  return duty;
+}
+
+static int32_t stepForSlope(int slopeMs)
+{
+  if (slopeMs <= 0)
+  {
+    return INT32_MAX;
+  }
+
+  int32_t step = ((int32_t)activeCalibration().maxSpeed << RAMP_FRACTION_BITS) * RAMP_TICK_MS / slopeMs;
+  return step > 0 ? step : 1;
+}
+
+static void moveChannel(int channel)
+{
+  int32_t current = currentDuty[channel];
+  int32_t target = targetDuty[channel];
+
+  if (current == target)
+  {
+    return;
+  }
+
+  if (target > current)
+  {
+    // Reversing: wait for the other input of this motor to reach zero first
+    if (currentDuty[channel ^ 1] > 0)
+    {
+      return;
+    }
+    current = (target - current > stepDuty[channel]) ? current + stepDuty[channel] : target;
+  }
+  else
+  {
+    current = (current - target > stepDuty[channel]) ? current - stepDuty[channel] : target;
+  }
+
+  currentDuty[channel] = current;
+  pwmFrameStage(channel, outputDuty(channel, current));
+}
+
+static void stepMotor(int motorNumber)
+{
+  int in1 = motorNumber * 2;
+
+  // Falling input first, so a reversal with instant slopes completes in one step
+  int first = targetDuty[in1] < currentDuty[in1] ? in1 : in1 + 1;
+  moveChannel(first);
+  moveChannel(first ^ 1);
+}
+
+void rampSetMotor(int motorNumber, int in1Duty, int in2Duty, uint8_t rampClass)
+{
+  const int duty[2] = {in1Duty, in2Duty};
+
+  if (rampClass >= RAMP_CLASS_COUNT)
+  {
+    rampClass = RAMP_STOP;
+  }
+
+  for (int side = 0; side < 2; side++)
+  {
+    int channel = motorNumber * 2 + side;
+    int32_t target = (int32_t)duty[side] << RAMP_FRACTION_BITS;
+
+    targetDuty[channel] = target;
+    stepDuty[channel] = stepForSlope(target > currentDuty[channel] ? RAMP_ACCEL_MS[rampClass]
+                                                                   : RAMP_DECEL_MS[rampClass]);
+  }
+  stepMotor(motorNumber);
+}
+
+void rampStep()
+{
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    stepMotor(i);
+  }
+}
+
+int rampActiveDuty(int motorNumber, int &channel)
+{
+  int in1 = motorNumber * 2;
+
+  channel = currentDuty[in1 + 1] > currentDuty[in1] ? in1 + 1 : in1;
+  return currentDuty[channel] >> RAMP_FRACTION_BITS;
+}
+
+int rampTargetDuty(int motorNumber)
+{
+  return (targetDuty[motorNumber * 2] - targetDuty[motorNumber * 2 + 1]) >> RAMP_FRACTION_BITS;
+}
+
+void rampSetTrim(int motorNumber, int trim)
+{
+  trimDuty[motorNumber] = trim;
+  for (int channel = motorNumber * 2; channel <= motorNumber * 2 + 1; channel++)
+  {
+    if (currentDuty[channel] > 0)
+    {
+      pwmFrameStage(channel, outputDuty(channel, currentDuty[channel]));
+    }
+  }
+}
+
+void rampSetOutputScale(uint32_t scale)
+{
+  outputScale = scale;
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (currentDuty[channel] > 0)
+    {
+      pwmFrameStage(channel, outputDuty(channel, currentDuty[channel]));
+    }
+  }
+}
+
+void rampReset()
+{
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    currentDuty[channel] = 0;
+    targetDuty[channel] = 0;
+    pwmFrameStage(channel, 0);
+  }
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    trimDuty[i] = 0;
+  }
+}
+
+bool rampInProgress()
+{
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (currentDuty[channel] != targetDuty[channel])
+    {
+      return true;
+    }
+  }
+  return false;
+}
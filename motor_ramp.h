@@ -0,0 +1,59 @@
+/*
+ * Acceleration ramps for the motor LEDC channels
+ *
+ * Every channel write goes through here and is staged into the PWM frame
+ * (pwm_frame.h); the caller commits it. A new target is reached at the
+ * slope of its command class (RAMP_ACCEL_MS / RAMP_DECEL_MS from
+ * arduino_config.h, milliseconds for a full 0..MAX_SPEED change); a slope
+ * of 0 writes the target at once. The motor task calls rampStep() from a
+ * periodic RAMP_TICK_MS timer while rampInProgress().
+ *
+ * A motor that reverses ramps its old input down to zero before the
+ * other input starts to rise, so both inputs are never driven together.
+ *
+ * What reaches the channels is the ramped duty plus any trim, times the
+ * output scale (battery voltage compensation, battery_monitor.h), capped
+ * at full PWM. Ramps, trims and targets are all in unscaled duty.
+ */
+
+#ifndef MOTOR_RAMP_H
+#define MOTOR_RAMP_H
+
+#include <stdint.h>
+
+// Command classes, in the order of the RAMP_ACCEL_MS / RAMP_DECEL_MS entries
+enum RampClass : uint8_t
+{
+  RAMP_STOP,    // STOP, lease expiry, disconnect: normally instant
+  RAMP_DRIVE,   // forward/backward/strafe/diagonal and hand gestures
+  RAMP_TURN,    // turn and tracking rows, turn-rate frames
+  RAMP_DIRECT,  // raw motor duty frames, shaped by the client
+  RAMP_CLASS_COUNT
+};
+
+// Set new IN1/IN2 targets for one motor; stages the first step immediately
+void rampSetMotor(int motorNumber, int in1Duty, int in2Duty, uint8_t rampClass);
+
+// Advance every channel by one tick
+void rampStep();
+
+bool rampInProgress();
+
+// Zero every channel and trim at once, ignoring the slopes
+void rampReset();
+
+// Ramped (feed-forward) duty of the motor's driving input, and which channel that is
+int rampActiveDuty(int motorNumber, int &channel);
+
+// Signed duty the motor is ramping towards: IN1 positive, IN2 negative
+int rampTargetDuty(int motorNumber);
+
+// Closed-loop duty correction added to the motor's driving input; stages it at once
+void rampSetTrim(int motorNumber, int trim);
+
+// Q16 factor on every channel output (RAMP_SCALE_ONE = none); restages
+// the driven channels at once
+#define RAMP_SCALE_ONE 65536
+void rampSetOutputScale(uint32_t scale);
+
+#endif // MOTOR_RAMP_H
@@ -0,0 +1,188 @@
+#include <algorithm>
+
+#include "car_commands.h"
+#include "hal.h"
+#include "metrics.h"
+#include "calibration.h"
+#include "pwm_frame.h"
+
+#define PWM_TIMER 0
+#define PWM_TIMER_COUNT 4
+#define PWM_PERIOD_MICROS (1000000UL / activeCalibration().pwmFrequency)
+
+static uint32_t stagedDuty[MOTOR_CHANNEL_COUNT];
+static uint8_t dirtyChannels = 0;
+static int channelPins[MOTOR_CHANNEL_COUNT];
+
+void pwmFrameSetup()
+{
+  halPwmConfigureTimer(PWM_TIMER, activeCalibration().pwmFrequency, activeCalibration().pwmResolution);
+}
+
+void pwmFrameAttach(int channel, int pin)
+{
+  halPwmAttach(channel, pin, PWM_TIMER);
+  channelPins[channel] = pin;
+  stagedDuty[channel] = 0;  // attached stopped
+}
+
+// Shadow copy: a channel already set to this duty is not written again
+void pwmFrameStage(int channel, uint32_t duty)
+{
+  bool changed = duty != stagedDuty[channel];
+
+  recordChannelWrite(changed);
+  if (changed)
+  {
+    stagedDuty[channel] = duty;
+    dirtyChannels |= 1 << channel;
+  }
+}
+
+uint32_t pwmFrameDuty(int channel)
+{
+  return stagedDuty[channel];
+}
+
+void pwmFrameCommit()
+{
+  if (dirtyChannels == 0)
+  {
+    return;
+  }
+
+  // Duty registers only take effect once their update bit is set
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (dirtyChannels & (1 << channel))
+    {
+      halPwmSetDuty(channel, stagedDuty[channel]);
+    }
+  }
+
+  // Back to back, so every channel latches at the same timer overflow
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (dirtyChannels & (1 << channel))
+    {
+      halPwmUpdate(channel);
+    }
+  }
+  dirtyChannels = 0;
+}
+
+// Channel pairs on timers 0..3, as ledcSetup() assigned them, or all on one
+static void bindChannels(bool timerPerPair)
+{
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    halPwmBindTimer(channel, timerPerPair ? (channel / 2) % PWM_TIMER_COUNT : PWM_TIMER);
+  }
+}
+
+static void writeAllChannels(uint32_t duty, bool useFrame)
+{
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    if (useFrame)
+    {
+      pwmFrameStage(channel, duty);
+    }
+    else
+    {
+      // What ledcWrite() does for each channel
+      halPwmSetDuty(channel, duty);
+      halPwmUpdate(channel);
+      stagedDuty[channel] = duty;
+    }
+  }
+  pwmFrameCommit();
+}
+
+static bool measureSkew(bool useFrame, uint32_t &skewMicros)
+{
+  int64_t switchedAt[MOTOR_CHANNEL_COUNT] = {};
+  uint8_t switched = 0;
+  const uint8_t allChannels = (1 << MOTOR_CHANNEL_COUNT) - 1;
+
+  writeAllChannels(0, true);
+  halDelayMicros(3 * PWM_PERIOD_MICROS + halRandom() % PWM_PERIOD_MICROS);
+
+  writeAllChannels((1UL << activeCalibration().pwmResolution) / 2, useFrame);
+  int64_t start = halMicros64();
+  int64_t now = start;
+
+  while (switched != allChannels && now - start < 3 * (int64_t)PWM_PERIOD_MICROS)
+  {
+    now = halMicros64();
+    for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+    {
+      if (!(switched & (1 << channel)) && halPinRead(channelPins[channel]))
+      {
+        switchedAt[channel] = now;
+        switched |= 1 << channel;
+      }
+    }
+  }
+  writeAllChannels(0, true);
+
+  if (switched != allChannels)
+  {
+    return false;
+  }
+
+  int64_t first = switchedAt[0];
+  int64_t last = switchedAt[0];
+  for (int channel = 1; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    first = std::min(first, switchedAt[channel]);
+    last = std::max(last, switchedAt[channel]);
+  }
+  skewMicros = (uint32_t)(last - first);
+  return true;
+}
+
+static PwmSkewStats measureMode(bool useFrame, int iterations)
+{
+  PwmSkewStats stats = {};
+  uint64_t total = 0;
+  int measured = 0;
+
+  for (int i = 0; i < iterations; i++)
+  {
+    uint32_t skew = 0;
+    if (!measureSkew(useFrame, skew))
+    {
+      stats.missed++;
+      continue;
+    }
+    total += skew;
+    stats.maxMicros = std::max(stats.maxMicros, skew);
+    measured++;
+  }
+
+  stats.meanMicros = measured > 0 ? (uint32_t)(total / measured) : 0;
+  return stats;
+}
+
+PwmSkewResult runPwmSkewBenchmark(int iterations)
+{
+  PwmSkewResult result = {};
+
+  // Let the benchmark read back the pins LEDC is driving
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    halPinEnableReadback(channelPins[channel]);
+  }
+
+  for (int timer = PWM_TIMER + 1; timer < PWM_TIMER_COUNT; timer++)
+  {
+    halPwmConfigureTimer(timer, activeCalibration().pwmFrequency, activeCalibration().pwmResolution);
+  }
+  bindChannels(true);
+  result.sequential = measureMode(false, iterations);
+
+  bindChannels(false);
+  result.frame = measureMode(true, iterations);
+  return result;
+}
@@ -0,0 +1,46 @@
+/*
+ * Commit-frame output for the eight motor LEDC channels
+ *
+ * All channels run off one LEDC timer. Duties are staged with
+ * pwmFrameStage() and latched together by pwmFrameCommit(): the duty
+ * registers are written first, then every update bit, so all changed
+ * channels switch on the same PWM period boundary instead of one after
+ * another across four unsynchronised timers. Staging the duty a channel
+ * already has is a no-op, so only channels that change are written.
+ */
+
+#ifndef PWM_FRAME_H
+#define PWM_FRAME_H
+
+#include <stdint.h>
+
+// Configure the shared timer from the active calibration; calling it again
+// retimes channels that are already attached
+void pwmFrameSetup();
+void pwmFrameAttach(int channel, int pin);
+
+void pwmFrameStage(int channel, uint32_t duty);
+void pwmFrameCommit();
+
+// Duty most recently staged for the channel (what it outputs once committed)
+uint32_t pwmFrameDuty(int channel);
+
+struct PwmSkewStats
+{
+  uint32_t meanMicros;  // spread between the first and last channel switching
+  uint32_t maxMicros;
+  uint32_t missed;      // iterations where a channel never switched
+};
+
+struct PwmSkewResult
+{
+  PwmSkewStats sequential;  // per-channel writes on the old one-timer-per-pair layout
+  PwmSkewStats frame;       // staged writes latched by pwmFrameCommit()
+};
+
+// Steps every channel 0 -> 50% and times when each pin goes high. Drives
+// IN1 and IN2 of each motor together, which brakes rather than turns the
+// wheels. Run it before the motor task starts.
+PwmSkewResult runPwmSkewBenchmark(int iterations);
+
+#endif // PWM_FRAME_H
@@ -1,20 +1,3 @@
-/*
- * SMART CAR MOTOR DIRECTION CALIBRATION
- * 
- * If any motor rotates backwards during the startup test:
- * 1. Find the motor number from the test output
- * 2. Set motorDirectionCorrection[motor_number] = -1
- * 
- * Example: If FRONT_RIGHT_MOTOR (motor 0) rotates backwards:
- * Change: int motorDirectionCorrection[4] = {1, 1, 1, 1};
- * To:     int motorDirectionCorrection[4] = {-1, 1, 1, 1};
- * 
- * Motor Numbers:
- * 0 = FRONT_RIGHT_MOTOR
- * 1 = BACK_RIGHT_MOTOR  
- * 2 = FRONT_LEFT_MOTOR
- * 3 = BACK_LEFT_MOTOR
- */
 
 #include <Arduino.h>
 #ifdef ESP32
@@ -26,411 +9,319 @@
 #endif
 #include <ESPAsyncWebServer.h>
 
-#define UP 1
-#define DOWN 2
-#define LEFT 3
-#define RIGHT 4
-#define UP_LEFT 5
-#define UP_RIGHT 6
-#define DOWN_LEFT 7
-#define DOWN_RIGHT 8
-#define TURN_LEFT 9
-#define TURN_RIGHT 10
-#define STOP 0
-
-// Hand gesture commands
-#define HAND_LEFT_RAISED 11
-#define HAND_RIGHT_RAISED 12
-#define HAND_BOTH_RAISED 13
-#define HAND_NONE_RAISED 14
-
-// Add new movement commands for tracking
-#define TRACK_LEFT 15
-#define TRACK_RIGHT 16
-#define TRACK_CENTER 17
-
-#define FRONT_RIGHT_MOTOR 0
-#define BACK_RIGHT_MOTOR 1
-#define FRONT_LEFT_MOTOR 2
-#define BACK_LEFT_MOTOR 3
-
-#define FORWARD 1
-#define BACKWARD -1
-
-// PWM settings for motor speed control
-#define MAX_SPEED 255
-#define PWM_FREQUENCY 1000
-#define PWM_RESOLUTION 8
-
-struct MOTOR_PINS
-{
-  int pinIN1;
-  int pinIN2;    
-};
-
-// Updated motor pin configuration
-std::vector<MOTOR_PINS> motorPins = 
-{
-  {16, 17},  // FRONT_RIGHT_MOTOR
-  {18, 19},  // BACK_RIGHT_MOTOR
-  {27, 26},  // FRONT_LEFT_MOTOR
-  {25, 33},  // BACK_LEFT_MOTOR
-};
-
-// Motor direction correction - set to -1 for motors that are wired backwards
-// Test each motor individually and set -1 for any that rotate backwards
-// For straight movement, adjust based on actual motor behavior
-int motorDirectionCorrection[4] = {-1, 1, 1, 1};  // Motor 0 (FRONT_RIGHT) is reversed
-
-const char* ssid     = "SLT_FIBRE";
-const char* password = "abcd1234";
+#include "arduino_config.h"
+#include "battery_monitor.h"
+#include "calibration.h"
+#include "camera_pins.h"
+#include "camera_stream.h"
+#include "car_commands.h"
+#include "car_log.h"
+#include "command_ingress.h"
+#include "command_protocol.h"
+#include "control_arbiter.h"
+#include "flight_recorder.h"
+#include "hal.h"
+#include "jitter_buffer.h"
+#include "metrics.h"
+#include "motion_script.h"
+#include "motor_control.h"
+#include "pwm_frame.h"
+#include "telemetry.h"
+#include "tracking_control.h"
+#include "udp_receiver.h"
+#include "web_assets.h"
+#include "wheel_speed.h"
+#include "wifi_manager.h"
+
+#define METRICS_BODY_SIZE 4096
 
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
+AsyncWebSocket controlWs("/control");  // Binary streaming channel for the vision host
 
-const char* htmlHomePage PROGMEM = R"HTMLHOMEPAGE(
-<!DOCTYPE html>
-<html>
-  <head>
-  <meta name="viewport" content="width=device-width, initial-scale=1, maximum-scale=1, user-scalable=no">
-    <style>
-    .arrows {
-      font-size:70px;
-      color:red;
-    }
-    .circularArrows {
-      font-size:80px;
-      color:blue;
-    }
-    td {
-      background-color:black;
-      border-radius:25%;
-      box-shadow: 5px 5px #888888;
-    }
-    td:active {
-      transform: translate(5px,5px);
-      box-shadow: none; 
-    }
-
-    .noselect {
-      -webkit-touch-callout: none;
-        -webkit-user-select: none;
-         -khtml-user-select: none;
-           -moz-user-select: none;
-            -ms-user-select: none;
-                user-select: none;
-    }
-    </style>
-  </head>
-  <body class="noselect" align="center" style="background-color:white">
-     
-    <h1 style="color: teal;text-align:center;">Hash Include Electronics</h1>
-    <h2 style="color: teal;text-align:center;">Wi-Fi &#128663; Control</h2>
-    
-    <table id="mainTable" style="width:400px;margin:auto;table-layout:fixed" CELLSPACING=10>
-      <tr>
-        <td ontouchstart='onTouchStartAndEnd("5")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#11017;</span></td>
-        <td ontouchstart='onTouchStartAndEnd("1")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#8679;</span></td>
-        <td ontouchstart='onTouchStartAndEnd("6")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#11016;</span></td>
-      </tr>
-      
-      <tr>
-        <td ontouchstart='onTouchStartAndEnd("3")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#8678;</span></td>
-        <td></td>    
-        <td ontouchstart='onTouchStartAndEnd("4")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#8680;</span></td>
-      </tr>
-      
-      <tr>
-        <td ontouchstart='onTouchStartAndEnd("7")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#11019;</span></td>
-        <td ontouchstart='onTouchStartAndEnd("2")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#8681;</span></td>
-        <td ontouchstart='onTouchStartAndEnd("8")' ontouchend='onTouchStartAndEnd("0")'><span class="arrows" >&#11018;</span></td>
-      </tr>
-    
-      <tr>
-        <td ontouchstart='onTouchStartAndEnd("9")' ontouchend='onTouchStartAndEnd("0")'><span class="circularArrows" >&#8634;</span></td>
-        <td style="background-color:white;box-shadow:none"></td>
-        <td ontouchstart='onTouchStartAndEnd("10")' ontouchend='onTouchStartAndEnd("0")'><span class="circularArrows" >&#8635;</span></td>
-      </tr>
-    </table>
-
-    <script>
-      var webSocketUrl = "ws:\/\/" + window.location.hostname + "/ws";
-      var websocket;
-      
-      function initWebSocket() 
-      {
-        websocket = new WebSocket(webSocketUrl);
-        websocket.onopen    = function(event){};
-        websocket.onclose   = function(event){setTimeout(initWebSocket, 2000);};
-        websocket.onmessage = function(event){};
-      }
+// Control state as JSON for the joystick page
+static void formatControlState(const ControlState &state, char *buffer, size_t size)
+{
+  snprintf(buffer, size, "{\"owner\":\"%s\",\"version\":%u,\"duty\":[%d,%d,%d,%d]}", sourceName(state.owner),
+           state.version, state.motorDuty[0], state.motorDuty[1], state.motorDuty[2], state.motorDuty[3]);
+}
 
-      function onTouchStartAndEnd(value) 
-      {
-        websocket.send(value);
-      }
-          
-      window.onload = initWebSocket;
-      document.getElementById("mainTable").addEventListener("touchend", function(event){
-        event.preventDefault()
-      });      
-    </script>
-    
-  </body>
-</html> 
-
-)HTMLHOMEPAGE";
-
-void rotateMotor(int motorNumber, int motorDirection)
+// Push the control state to every client when the motor task publishes a new version
+void broadcastControlState()
 {
-  // Apply motor direction correction
-  int correctedDirection = motorDirection * motorDirectionCorrection[motorNumber];
-  
-  if (correctedDirection == FORWARD)
-  {
-    ledcWrite(motorNumber * 2, MAX_SPEED);     // pinIN1 at max speed
-    ledcWrite(motorNumber * 2 + 1, 0);        // pinIN2 at 0
-  }
-  else if (correctedDirection == BACKWARD)
-  {
-    ledcWrite(motorNumber * 2, 0);            // pinIN1 at 0
-    ledcWrite(motorNumber * 2 + 1, MAX_SPEED); // pinIN2 at max speed
-  }
-  else
+  static uint32_t broadcastVersion = 0;
+  ControlState state = getControlState();
+
+  if (state.version == broadcastVersion)
   {
-    ledcWrite(motorNumber * 2, 0);            // pinIN1 at 0
-    ledcWrite(motorNumber * 2 + 1, 0);        // pinIN2 at 0
+    return;
   }
+  broadcastVersion = state.version;
+
+  char text[96];
+  formatControlState(state, text, sizeof(text));
+  ws.textAll(text);
+
+  uint8_t frame[PROTO_STATE_SIZE];
+  encodeState(frame, (uint16_t)state.version, state.owner, state.motorDuty);
+  controlWs.binaryAll(frame, sizeof(frame));
 }
 
-void rotateMotorSynchronized(int motorNumber, int motorDirection, bool preStart = false)
+// Motion script progress, pushed like the control state
+void broadcastScriptProgress()
 {
-  // Apply motor direction correction
-  int correctedDirection = motorDirection * motorDirectionCorrection[motorNumber];
-  
-  if (correctedDirection == FORWARD)
+  static ScriptProgress broadcast = {};
+  ScriptProgress progress = getScriptProgress();
+
+  if (progress.id == broadcast.id && progress.segment == broadcast.segment && progress.count == broadcast.count &&
+      progress.state == broadcast.state)
   {
-    ledcWrite(motorNumber * 2, MAX_SPEED);     // pinIN1 at max speed
-    ledcWrite(motorNumber * 2 + 1, 0);        // pinIN2 at 0
+    return;
   }
-  else if (correctedDirection == BACKWARD)
+  broadcast = progress;
+
+  char text[96];
+  formatScriptProgress(progress, text, sizeof(text));
+  ws.textAll(text);
+
+  uint8_t frame[PROTO_SCRIPT_STATE_SIZE];
+  encodeScriptProgress(frame, progress);
+  controlWs.binaryAll(frame, sizeof(frame));
+}
+
+// The joystick page is gzipped at build time; revalidation by ETag turns reloads into a 304
+void handleRoot(AsyncWebServerRequest *request) 
+{
+  AsyncWebServerResponse *response;
+
+  if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == CONTROL_PAGE_ETAG)
   {
-    ledcWrite(motorNumber * 2, 0);            // pinIN1 at 0
-    ledcWrite(motorNumber * 2 + 1, MAX_SPEED); // pinIN2 at max speed
+    response = request->beginResponse(304);
   }
   else
   {
-    ledcWrite(motorNumber * 2, 0);            // pinIN1 at 0
-    ledcWrite(motorNumber * 2 + 1, 0);        // pinIN2 at 0
+    response = request->beginResponse_P(200, "text/html", CONTROL_PAGE_GZ, CONTROL_PAGE_GZ_LENGTH);
+    response->addHeader("Content-Encoding", "gzip");
   }
+  response->addHeader("ETag", CONTROL_PAGE_ETAG);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
 }
 
-void startAllMotorsForward()
+void handleHandGesture(AsyncWebServerRequest *request) 
 {
-  Serial.println("Starting synchronized forward movement with Motor 2 compensation");
-  
-  // Pre-start Motor 2 (FRONT_LEFT_MOTOR) first to compensate for startup delay
-  rotateMotorSynchronized(FRONT_LEFT_MOTOR, FORWARD, true);
-  delay(50); // 50ms head start for Motor 2
-  
-  // Start all other motors
-  rotateMotorSynchronized(FRONT_RIGHT_MOTOR, FORWARD);
-  rotateMotorSynchronized(BACK_RIGHT_MOTOR, FORWARD);
-  rotateMotorSynchronized(BACK_LEFT_MOTOR, FORWARD);
-  
-  Serial.println("All motors started for forward movement");
-}
+  uint32_t receivedMicros = micros();
 
-void startAllMotorsBackward()
-{
-  Serial.println("Starting synchronized backward movement");
-  
-  // Start all motors in backward direction
-  rotateMotor(FRONT_RIGHT_MOTOR, BACKWARD);
-  rotateMotor(BACK_RIGHT_MOTOR, BACKWARD);
-  rotateMotor(FRONT_LEFT_MOTOR, BACKWARD);
-  rotateMotor(BACK_LEFT_MOTOR, BACKWARD);
-  
-  Serial.println("All motors started for backward movement");
+  if (request->hasParam("gesture", true)) {
+    ingestGesture(request->getParam("gesture", true)->value().c_str(), receivedMicros);
+    request->send(200, "text/plain", "OK");
+  } else {
+    request->send(400, "text/plain", "Missing gesture parameter");
+  }
 }
 
-void stopAllMotors()
+void handlePersonTracking(AsyncWebServerRequest *request) 
 {
-  Serial.println("Stopping all motors");
-  rotateMotor(FRONT_RIGHT_MOTOR, STOP);
-  rotateMotor(BACK_RIGHT_MOTOR, STOP);
-  rotateMotor(FRONT_LEFT_MOTOR, STOP);
-  rotateMotor(BACK_LEFT_MOTOR, STOP);
+  uint32_t receivedMicros = micros();
+
+  // Proportional modes: signed error or turn rate, -1000 (left) .. 1000 (right)
+  if (request->hasParam("error", true)) {
+    ingestTrackingError(request->getParam("error", true)->value().toInt(), receivedMicros);
+    request->send(200, "text/plain", "OK");
+  } else if (request->hasParam("x", true)) {
+    // Raw observation for the on-device controller
+    TargetObservation observation;
+    observation.x = request->getParam("x", true)->value().toInt();
+    observation.width = request->hasParam("width", true) ? request->getParam("width", true)->value().toInt() : 0;
+    observation.confidence =
+        request->hasParam("confidence", true) ? request->getParam("confidence", true)->value().toInt() : 0;
+    observation.frameMillis =
+        request->hasParam("frame_ms", true) ? request->getParam("frame_ms", true)->value().toInt() : millis();
+    ingestTargetObservation(observation, receivedMicros);
+    request->send(200, "text/plain", "OK");
+  } else if (request->hasParam("turn_rate", true)) {
+    ingestTurnRate(request->getParam("turn_rate", true)->value().toInt(), receivedMicros);
+    request->send(200, "text/plain", "OK");
+  } else if (request->hasParam("action", true)) {
+    ingestTrackingAction(request->getParam("action", true)->value().c_str(), receivedMicros);
+    request->send(200, "text/plain", "OK");
+  } else {
+    request->send(400, "text/plain", "Missing action, error, turn_rate or x parameter");
+  }
 }
 
-void processCarMovement(String inputValue)
+void handleStats(AsyncWebServerRequest *request)
 {
-  Serial.printf("Got value as %s %d\n", inputValue.c_str(), inputValue.toInt());  
-  switch(inputValue.toInt())
+  MotorQueueStats tcpQueue = getMotorQueueStats(PRODUCER_ASYNC_TCP);
+  MotorQueueStats udpQueue = getMotorQueueStats(PRODUCER_UDP);
+  UdpReceiverStats udpStats = getUdpReceiverStats();
+  WifiStats wifi = getWifiStats();
+  char body[2048];
+
+  int length = snprintf(body, sizeof(body),
+                        "queue_depth %u\nqueue_capacity %u\nqueue_high_watermark %u\nqueue_overflows %u\ncommands_processed %u\n"
+                        "commands_discarded %u\nudp_queue_depth %u\nudp_queue_high_watermark %u\nudp_queue_overflows %u\n"
+                        "udp_commands_processed %u\nudp_commands_discarded %u\n"
+                        "udp_received %u\nudp_accepted %u\nudp_dropped_stale %u\nudp_dropped_malformed %u\nudp_dropped_queue_full %u\n"
+                        "udp_last_sequence %u\nlog_dropped %u\nlease_expiries %u\narbiter_rejections %u\ncontrol_owner %s\ntelemetry_congestion_skips %u\n"
+                        "wifi_connected %u\nwifi_connects %u\nwifi_disconnects %u\nwifi_last_connect_ms %u\nwifi_fast_connect %u\n",
+                        tcpQueue.depth, tcpQueue.capacity, tcpQueue.highWatermark, tcpQueue.overflows, tcpQueue.processed,
+                        tcpQueue.discarded, udpQueue.depth, udpQueue.highWatermark, udpQueue.overflows,
+                        udpQueue.processed, udpQueue.discarded,
+                        udpStats.received, udpStats.accepted, udpStats.droppedStale, udpStats.droppedMalformed,
+                        udpStats.droppedQueueFull, udpStats.lastSequence, getLogDroppedCount(), getLeaseExpiryCount(),
+                        getArbiterRejections(), sourceName(getControlState().owner), getTelemetryCongestionSkips(),
+                        wifi.connected, wifi.connects, wifi.disconnects, wifi.lastConnectMillis, wifi.fastConnect);
+
+  TrackerStats tracker = getTrackerStats();
+  length += snprintf(body + length, sizeof(body) - length,
+                     "tracker_observations %u\ntracker_ignored %u\ntracker_targets_lost %u\n"
+                     "core_motor %d\ncore_async_tcp %d\ncore_async_udp %d\ncore_service %d\ncore_log %d\n",
+                     tracker.observations, tracker.ignored, tracker.targetsLost, halTaskCore("motor"),
+                     halTaskCore("async_tcp"), halTaskCore("async_udp"), halTaskCore("service"), halTaskCore("log"));
+
+  BatteryStats battery = getBatteryStats();
+  static const char *const batteryStates[] = {"unknown", "absent", "ok", "low"};
+  length += snprintf(body + length, sizeof(body) - length,
+                     "battery_mv %u\nbattery_state %s\nbattery_output_scale_permille %u\nbattery_readings %u\n"
+                     "battery_low_events %u\n",
+                     battery.millivolts, batteryStates[battery.state], battery.scalePermille, battery.readings,
+                     battery.lowEvents);
+
+  JitterStats jitter = getJitterStats();
+  length += snprintf(body + length, sizeof(body) - length,
+                     "batch_received %u\nbatch_commands %u\nbatch_played %u\nbatch_late %u\nbatch_stale %u\n"
+                     "batch_underruns %u\nbatch_overflows %u\nbatch_buffer_depth %u\nbatch_transit_ms %d\n",
+                     jitter.batches, jitter.commands, jitter.played, jitter.late, jitter.stale, jitter.underruns,
+                     jitter.overflows, jitter.depth, jitter.transitMillis);
+
+  if (ENCODERS_ENABLED)
   {
-    case UP:
-      startAllMotorsForward();  // Use synchronized startup for straight movement
-      break;
-
-    case DOWN:
-      startAllMotorsBackward();  // Use synchronized backward movement
-      break;
-
-    case LEFT:
-      rotateMotor(FRONT_RIGHT_MOTOR, FORWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, BACKWARD);
-      rotateMotor(BACK_LEFT_MOTOR, FORWARD);   
-      break;
-
-    case RIGHT:
-      rotateMotor(FRONT_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, FORWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, FORWARD);
-      rotateMotor(BACK_LEFT_MOTOR, BACKWARD);  
-      break;
-
-    case UP_LEFT:
-      rotateMotor(FRONT_RIGHT_MOTOR, FORWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, STOP);
-      rotateMotor(FRONT_LEFT_MOTOR, STOP);
-      rotateMotor(BACK_LEFT_MOTOR, FORWARD);  
-      break;
-
-    case UP_RIGHT:
-      rotateMotor(FRONT_RIGHT_MOTOR, STOP);
-      rotateMotor(BACK_RIGHT_MOTOR, FORWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, FORWARD);
-      rotateMotor(BACK_LEFT_MOTOR, STOP);  
-      break;
-
-    case DOWN_LEFT:
-      rotateMotor(FRONT_RIGHT_MOTOR, STOP);
-      rotateMotor(BACK_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, BACKWARD);
-      rotateMotor(BACK_LEFT_MOTOR, STOP);   
-      break;
-
-    case DOWN_RIGHT:
-      rotateMotor(FRONT_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, STOP);
-      rotateMotor(FRONT_LEFT_MOTOR, STOP);
-      rotateMotor(BACK_LEFT_MOTOR, BACKWARD);   
-      break;
-
-    case TURN_LEFT:
-      rotateMotor(FRONT_RIGHT_MOTOR, FORWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, FORWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, BACKWARD);
-      rotateMotor(BACK_LEFT_MOTOR, BACKWARD);  
-      break;
-
-    case TURN_RIGHT:
-      rotateMotor(FRONT_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, FORWARD);
-      rotateMotor(BACK_LEFT_MOTOR, FORWARD);   
-      break;
+    WheelSpeedStats wheels = getWheelSpeedStats();
+    for (int i = 0; i < MOTOR_COUNT && length < (int)sizeof(body); i++)
+    {
+      length += snprintf(body + length, sizeof(body) - length,
+                         "wheel_%d_target_rpm %d\nwheel_%d_measured_rpm %d\nwheel_%d_trim %d\n",
+                         i, wheels.targetRpm[i], i, wheels.measuredRpm[i], i, wheels.trim[i]);
+    }
+  }
+  request->send(200, "text/plain", body);
+}
 
-    // Hand gesture controls
-    case HAND_LEFT_RAISED:
-      Serial.println("Left hand raised - Moving forward with synchronized startup");
-      startAllMotorsForward();  // Use synchronized startup for hand gesture forward movement
-      break;
+// Free heap when the server came up, to compare long sessions against
+static uint32_t bootFreeHeap = 0;
 
-    case HAND_RIGHT_RAISED:
-      Serial.println("Right hand raised - Moving backward");
-      startAllMotorsBackward();  // Use backward movement for right hand
-      break;
+void handleHealth(AsyncWebServerRequest *request)
+{
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largestBlock = ESP.getMaxAllocHeap();
+  char body[256];
+
+  // Fragmentation: how much of the free heap is not in the largest block
+  snprintf(body, sizeof(body),
+           "free_heap %u\nlargest_free_block %u\nmin_free_heap %u\nfree_heap_at_boot %u\nheap_fragmentation_percent %u\n"
+           "uptime_ms %u\n",
+           freeHeap, largestBlock, ESP.getMinFreeHeap(), bootFreeHeap,
+           freeHeap > 0 ? 100 - (unsigned)((uint64_t)largestBlock * 100 / freeHeap) : 0, (unsigned)millis());
+  request->send(200, "text/plain", body);
+}
 
-    case HAND_BOTH_RAISED:
-      Serial.println("Both hands raised - Stopping");
-      stopAllMotors();  // Use synchronized stop function
-      break;
+// Encoded piece by piece straight from the ring as the response is sent
+void handleRecorder(AsyncWebServerRequest *request)
+{
+  RecorderDump dump = startRecorderDump();
 
-    case HAND_NONE_RAISED:
-      Serial.println("No hands raised - Stopping");
-      stopAllMotors();  // Use synchronized stop function
-      break;
+  request->send(request->beginResponse("application/octet-stream", recorderDumpSize(dump),
+                                       [dump](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                                         return encodeRecorderDump(dump, index, buffer, maxLen);
+                                       }));
+}
 
-    // Add these new cases in the processCarMovement switch statement
-    case TRACK_LEFT:
-      Serial.println("Tracking left - adjusting car orientation");
-      rotateMotor(FRONT_RIGHT_MOTOR, FORWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, FORWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, BACKWARD);
-      rotateMotor(BACK_LEFT_MOTOR, BACKWARD);
-      break;
+#if SMARTCAR_CAMERA
+void handleCamera(AsyncWebServerRequest *request)
+{
+  const char *frameSize = request->hasParam("size") ? request->getParam("size")->value().c_str() : nullptr;
+  int fps = request->hasParam("fps") ? request->getParam("fps")->value().toInt() : 0;
+  char body[384];
 
-    case TRACK_RIGHT:
-      Serial.println("Tracking right - adjusting car orientation");
-      rotateMotor(FRONT_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(BACK_RIGHT_MOTOR, BACKWARD);
-      rotateMotor(FRONT_LEFT_MOTOR, FORWARD);
-      rotateMotor(BACK_LEFT_MOTOR, FORWARD);
-      break;
+  if (!setCameraMode(frameSize, fps)) {
+    request->send(400, "text/plain", "Unknown or too large size, or fps not 1..60");
+    return;
+  }
+  formatCameraStatus(body, sizeof(body));
+  request->send(200, "text/plain", body);
+}
+#endif
 
-    case TRACK_CENTER:
-      Serial.println("Target centered - stopping orientation adjustment");
-      stopAllMotors();  // Use synchronized stop function
-      break;
+void handleMetrics(AsyncWebServerRequest *request)
+{
+  // Handlers all run on the AsyncTCP task, so one buffer is enough
+  static char body[METRICS_BODY_SIZE];
 
-    case STOP:
-    default:
-      stopAllMotors();  // Use synchronized stop function
-      break;
-  }
+  formatMetrics(body, sizeof(body));
+  request->send(200, "text/plain", body);
 }
 
-void handleRoot(AsyncWebServerRequest *request) 
+void handleGetCalibration(AsyncWebServerRequest *request)
 {
-  request->send_P(200, "text/html", htmlHomePage);
+  char body[256];
+
+  formatCalibration(body, sizeof(body), calibrationSnapshot());
+  request->send(200, "text/plain", body);
 }
 
-void handleHandGesture(AsyncWebServerRequest *request) 
+// Token from "Authorization: Bearer <token>" or a token parameter
+static bool calibrationAuthorized(AsyncWebServerRequest *request)
 {
-  if (request->hasParam("gesture", true)) {
-    String gesture = request->getParam("gesture", true)->value();
-    Serial.printf("Received hand gesture: %s\n", gesture.c_str());
-    
-    if (gesture == "left") {
-      processCarMovement("11");  // HAND_LEFT_RAISED
-    } else if (gesture == "right") {
-      processCarMovement("12");  // HAND_RIGHT_RAISED
-    } else if (gesture == "both") {
-      processCarMovement("13");  // HAND_BOTH_RAISED
-    } else if (gesture == "none") {
-      processCarMovement("14");  // HAND_NONE_RAISED
-    } else {
-      processCarMovement("0");   // STOP
-    }
-    
-    request->send(200, "text/plain", "OK");
-  } else {
-    request->send(400, "text/plain", "Missing gesture parameter");
+  if (request->hasHeader("Authorization"))
+  {
+    const String &value = request->getHeader("Authorization")->value();
+    return value.startsWith("Bearer ") && calibrationTokenMatches(value.c_str() + 7);
   }
+  return request->hasParam("token", true) && calibrationTokenMatches(request->getParam("token", true)->value().c_str());
 }
 
-void handlePersonTracking(AsyncWebServerRequest *request) 
+void handlePostCalibration(AsyncWebServerRequest *request)
 {
-  if (request->hasParam("action", true)) {
-    String action = request->getParam("action", true)->value();
-    Serial.printf("Received tracking command: %s\n", action.c_str());
-    
-    if (action == "track_left") {
-      processCarMovement("15");  // TRACK_LEFT
-    } else if (action == "track_right") {
-      processCarMovement("16");  // TRACK_RIGHT
-    } else if (action == "track_center") {
-      processCarMovement("17");  // TRACK_CENTER
-    } else {
-      processCarMovement("0");   // STOP
+  static const char *const FIELDS[] = {"direction_correction", "max_speed", "pwm_frequency", "pwm_resolution",
+                                       "startup_offsets"};
+  char body[256];
+
+  if (!calibrationAuthorized(request))
+  {
+    request->send(403, "text/plain", "Calibration token required");
+    return;
+  }
+
+  // reset=1 starts from the compiled-in defaults, otherwise from the active values
+  bool reset = request->hasParam("reset", true) && request->getParam("reset", true)->value() == "1";
+  Calibration calibration = reset ? defaultCalibration() : calibrationSnapshot();
+
+  for (const char *field : FIELDS)
+  {
+    if (request->hasParam(field, true) &&
+        !parseCalibrationField(calibration, field, request->getParam(field, true)->value().c_str()))
+    {
+      snprintf(body, sizeof(body), "Bad %s", field);
+      request->send(400, "text/plain", body);
+      return;
     }
-    
-    request->send(200, "text/plain", "OK");
-  } else {
-    request->send(400, "text/plain", "Missing action parameter");
   }
+
+  const char *problem = validateCalibration(calibration);
+  if (problem != nullptr)
+  {
+    request->send(400, "text/plain", problem);
+    return;
+  }
+  if (!submitCalibration(calibration))
+  {
+    request->send(503, "text/plain", "Calibration update already pending");
+    return;
+  }
+
+  formatCalibration(body, sizeof(body), calibration);
+  request->send(200, "text/plain", body);
 }
 
 void handleNotFound(AsyncWebServerRequest *request) 
@@ -443,82 +334,201 @@ void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsE
   switch (type) 
   {
     case WS_EVT_CONNECT:
-      Serial.printf("WebSocket client #%u connected from %s\n", client->id(), client->remoteIP().toString().c_str());
+    {
+      LOG_INFO("WebSocket client #%u connected from %s", client->id(), client->remoteIP().toString().c_str());
+      char text[96];
+      formatControlState(getControlState(), text, sizeof(text));
+      client->text(text);
       break;
+    }
     case WS_EVT_DISCONNECT:
-      Serial.printf("WebSocket client #%u disconnected\n", client->id());
-      processCarMovement("0");
+      LOG_INFO("WebSocket client #%u disconnected", client->id());
+      telemetrySubscribe(server, client->id(), false);
+      ingestDisconnect(SOURCE_WS, micros());
       break;
     case WS_EVT_DATA:
-      AwsFrameInfo *info;
-      info = (AwsFrameInfo*)arg;
-      if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) 
+    {
+      AwsFrameInfo *info = (AwsFrameInfo*)arg;
+      if (!info->final || info->index != 0 || info->len != len)
+      {
+        break;
+      }
+
+      uint32_t receivedMicros = micros();
+      CarCommand command;
+      IngressResult result = info->opcode == WS_BINARY
+                                 ? ingestBinaryFrame(SOURCE_WS, data, len, receivedMicros, command)
+                                 : ingestTextFrame(SOURCE_WS, data, len, receivedMicros, command);
+
+      if (result == INGRESS_MALFORMED)
+      {
+        LOG_WARN("Dropped malformed binary frame from client #%u", client->id());
+      }
+      else if (result == INGRESS_SUBSCRIBE)
       {
-        std::string myData = "";
-        myData.assign((char *)data, len);
-        processCarMovement(myData.c_str());       
+        telemetrySubscribe(server, client->id(), command.command);
       }
       break;
+    }
     default:
       break;  
   }
 }
 
-void setUpPinModes()
+void onControlSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  switch (type)
+  {
+    case WS_EVT_CONNECT:
+    {
+      LOG_INFO("Control client #%u connected from %s", client->id(), client->remoteIP().toString().c_str());
+      ControlState state = getControlState();
+      uint8_t frame[PROTO_STATE_SIZE];
+      encodeState(frame, (uint16_t)state.version, state.owner, state.motorDuty);
+      client->binary(frame, sizeof(frame));
+      break;
+    }
+    case WS_EVT_DISCONNECT:
+      LOG_INFO("Control client #%u disconnected", client->id());
+      telemetrySubscribe(server, client->id(), false);
+      ingestDisconnect(SOURCE_CONTROL_WS, micros());
+      break;
+    case WS_EVT_DATA:
+    {
+      AwsFrameInfo *info = (AwsFrameInfo*)arg;
+      if (!info->final || info->index != 0 || info->len != len)
+      {
+        break;
+      }
+
+      // Every frame is acknowledged so the host can measure round-trip latency
+      uint32_t receivedMicros = micros();
+      CarCommand command = {};
+      uint8_t status = PROTO_ACK_OK;
+      IngressResult result = info->opcode == WS_BINARY
+                                 ? ingestBinaryFrame(SOURCE_CONTROL_WS, data, len, receivedMicros, command)
+                                 : INGRESS_MALFORMED;
+
+      if (result == INGRESS_MALFORMED)
+      {
+        status = PROTO_ACK_MALFORMED;
+      }
+      else if (result == INGRESS_SUBSCRIBE)
+      {
+        status = telemetrySubscribe(server, client->id(), command.command) ? PROTO_ACK_OK : PROTO_ACK_QUEUE_FULL;
+      }
+      else if (result == INGRESS_QUEUE_FULL)
+      {
+        status = PROTO_ACK_QUEUE_FULL;
+      }
+
+      uint8_t ack[PROTO_ACK_SIZE];
+      uint32_t depth = getMotorQueueStats().depth;
+      encodeAck(ack, command.sequence, status, (uint8_t)min(depth, (uint32_t)UINT8_MAX));
+      client->binary(ack, sizeof(ack));
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// Everything that is not the network stack or the motor task: WiFi
+// reconnects, state and telemetry pushes, flash writes and client
+// cleanup. A low-priority task next to the network stack, so none of it
+// competes with the motor task for its core.
+static void serviceTask(void *parameter)
+{
+  for (;;)
+  {
+    serviceWifi();
+    broadcastControlState();
+    broadcastScriptProgress();
+    serviceTelemetry();
+    serviceCalibration();
+    serviceBattery(millis());
+    ws.cleanupClients();
+    controlWs.cleanupClients();
+    halSleepMillis(SERVICE_PERIOD_MS);
+  }
+}
+
+// Where the tasks actually ended up; -1 means not pinned
+static void reportTaskPlacement()
 {
-  // Configure PWM for all motor pins
-  for (int i = 0; i < motorPins.size(); i++)
+  LOG_INFO("Tasks: motor core %d prio %d, async_tcp core %d prio %d, async_udp core %d, service core %d prio %d, "
+           "log core %d prio %d",
+           halTaskCore("motor"), MOTOR_TASK_PRIORITY, halTaskCore("async_tcp"), NETWORK_TASK_PRIORITY,
+           halTaskCore("async_udp"), halTaskCore("service"), SERVICE_TASK_PRIORITY, halTaskCore("log"),
+           LOG_TASK_PRIORITY);
+  if (MOTOR_TASK_CORE == NETWORK_CORE)
   {
-    // Configure PWM channels for each motor pin
-    ledcSetup(i * 2, PWM_FREQUENCY, PWM_RESOLUTION);     // Channel for pinIN1
-    ledcSetup(i * 2 + 1, PWM_FREQUENCY, PWM_RESOLUTION); // Channel for pinIN2
-    
-    // Attach pins to PWM channels
-    ledcAttachPin(motorPins[i].pinIN1, i * 2);
-    ledcAttachPin(motorPins[i].pinIN2, i * 2 + 1);
-    
-    // Initialize motors to stop
-    rotateMotor(i, STOP);  
+    LOG_WARN("Motor task shares core %d with the network stack; expect jitter under WiFi load", MOTOR_TASK_CORE);
+  }
+  if (MOTOR_TASK_PRIORITY <= NETWORK_TASK_PRIORITY)
+  {
+    LOG_WARN("Motor task priority %d does not preempt the network task (%d)", MOTOR_TASK_PRIORITY,
+             NETWORK_TASK_PRIORITY);
   }
 }
 
 void setup(void) 
 {
+  loadCalibration();
   setUpPinModes();
-  Serial.begin(115200);
-
-  // Connect to WiFi network instead of creating access point
-  WiFi.begin(ssid, password);
-  Serial.print("Connecting to WiFi");
-  
-  // Wait for connection
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+  if (PWM_SKEW_BENCHMARK_ITERATIONS > 0)
+  {
+    PwmSkewResult skew = runPwmSkewBenchmark(PWM_SKEW_BENCHMARK_ITERATIONS);
+    LOG_INFO("PWM skew sequential: mean %u us, max %u us, missed %u", skew.sequential.meanMicros,
+             skew.sequential.maxMicros, skew.sequential.missed);
+    LOG_INFO("PWM skew frame: mean %u us, max %u us, missed %u", skew.frame.meanMicros,
+             skew.frame.maxMicros, skew.frame.missed);
   }
-  
-  Serial.println();
-  Serial.print("Connected to WiFi network: ");
-  Serial.println(ssid);
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
-  Serial.print("Signal strength (RSSI): ");
-  Serial.print(WiFi.RSSI());
-  Serial.println(" dBm");
+  startMotorTask();
+  startBatteryMonitor();
+  // Camera boards may run motors from the UART pins; logs are dropped then
+  if (!MOTORS_USE_UART)
+  {
+    Serial.begin(115200);
+  }
+  startLogTask();
+
+  // Motors are stopped and owned by the motor task before any network exists.
+  // The connection comes up in the background; the server listens meanwhile.
+  startWifi();
 
   server.on("/", HTTP_GET, handleRoot);
   server.on("/hand-gesture", HTTP_POST, handleHandGesture);
   server.on("/person-tracking", HTTP_POST, handlePersonTracking);
+  server.on("/stats", HTTP_GET, handleStats);
+  server.on("/metrics", HTTP_GET, handleMetrics);
+  server.on("/health", HTTP_GET, handleHealth);
+  server.on("/recorder", HTTP_GET, handleRecorder);
+  server.on("/calibration", HTTP_GET, handleGetCalibration);
+  server.on("/calibration", HTTP_POST, handlePostCalibration);
+#if SMARTCAR_CAMERA
+  server.on("/camera", HTTP_GET, handleCamera);
+#endif
   server.onNotFound(handleNotFound);
 
   ws.onEvent(onWebSocketEvent);
   server.addHandler(&ws);
+  controlWs.onEvent(onControlSocketEvent);
+  server.addHandler(&controlWs);
   server.begin();
-  Serial.println("HTTP server started");
-  Serial.println("Smart car is ready for commands!");
+  LOG_INFO("HTTP server started");
+  startUdpReceiver();
+#if SMARTCAR_CAMERA
+  startCamera();
+#endif
+  halStartTask(serviceTask, "service", 4096, SERVICE_TASK_PRIORITY, SERVICE_TASK_CORE, nullptr);
+  reportTaskPlacement();
+  bootFreeHeap = ESP.getFreeHeap();
+  LOG_INFO("Smart car is ready for commands!");
 }
 
 void loop() 
 {
-  ws.cleanupClients(); 
+  // All work runs in the pinned tasks
+  vTaskDelete(nullptr);
 }
\ No newline at end of file
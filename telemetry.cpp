@@ -0,0 +1,189 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+
+#include "arduino_config.h"
+#include "battery_monitor.h"
+#include "command_protocol.h"
+#include "control_arbiter.h"
+#include "metrics.h"
+#include "motor_control.h"
+#include "pwm_frame.h"
+#include "telemetry.h"
+
+static_assert(sizeof(TelemetrySample) == 42, "TelemetrySample is part of the wire format");
+
+// Longest run of batches a congested client skips
+#define TELEMETRY_MAX_BACKOFF 15
+
+#define TELEMETRY_FRAME_SIZE (TELEMETRY_HEADER_SIZE + TELEMETRY_BATCH_SAMPLES * sizeof(TelemetrySample))
+
+struct TelemetrySubscriber
+{
+  AsyncWebSocket *server;  // nullptr when the slot is free
+  uint32_t clientId;
+  uint8_t backoff;         // batches to skip after each congested send
+  uint8_t skipped;
+};
+
+// Only touched from the AsyncTCP task (subscribe) and the service task via the lock
+static portMUX_TYPE subscriberLock = portMUX_INITIALIZER_UNLOCKED;
+static TelemetrySubscriber subscribers[TELEMETRY_MAX_SUBSCRIBERS];
+static uint8_t subscriberCount = 0;
+
+static uint8_t frame[TELEMETRY_FRAME_SIZE];
+static uint8_t batchedSamples = 0;
+static uint16_t frameSequence = 0;
+static uint32_t lastSampleMillis = 0;
+static uint32_t loopIterations = 0;
+static uint32_t congestionSkips = 0;
+
+bool telemetrySubscribe(AsyncWebSocket *server, uint32_t clientId, bool enable)
+{
+  bool done = !enable;
+
+  portENTER_CRITICAL(&subscriberLock);
+  for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; i++)
+  {
+    if (subscribers[i].server == server && subscribers[i].clientId == clientId)
+    {
+      if (!enable)
+      {
+        subscribers[i].server = nullptr;
+        subscriberCount--;
+      }
+      done = true;
+      break;
+    }
+  }
+
+  for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS && !done; i++)
+  {
+    if (subscribers[i].server == nullptr)
+    {
+      subscribers[i] = {server, clientId, 0, 0};
+      subscriberCount++;
+      done = true;
+    }
+  }
+  portEXIT_CRITICAL(&subscriberLock);
+  return done;
+}
+
+static void takeSample(TelemetrySample &sample, uint32_t now)
+{
+  MotorQueueStats queue = getMotorQueueStats();
+  LastCommandMetrics last = getLastCommandMetrics();
+  uint32_t elapsed = now - lastSampleMillis;
+
+  sample.millis = now;
+  sample.command = last.type;
+  sample.owner = getControlState().owner;
+  for (int channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++)
+  {
+    sample.channelDuty[channel] = (uint16_t)pwmFrameDuty(channel);
+  }
+  sample.rssi = (int8_t)WiFi.RSSI();
+  sample.freeHeap = ESP.getFreeHeap();
+  sample.loopHz = (uint16_t)min(elapsed > 0 ? loopIterations * 1000 / elapsed : 0, (uint32_t)UINT16_MAX);
+  sample.queueDepth = (uint8_t)min(queue.depth, (uint32_t)UINT8_MAX);
+  sample.queueHighWatermark = (uint8_t)min(queue.highWatermark, (uint32_t)UINT8_MAX);
+  sample.queueOverflows = (uint16_t)min(queue.overflows, (uint32_t)UINT16_MAX);
+  sample.commandLatencyMicros = last.latencyMicros;
+  BatteryStats battery = getBatteryStats();
+  sample.batteryMillivolts = (uint16_t)min(battery.millivolts, (uint32_t)UINT16_MAX);
+  sample.outputScalePermille = (uint16_t)battery.scalePermille;
+  sample.batteryState = battery.state;
+}
+
+static void sendBatch()
+{
+  frameSequence++;
+  frame[0] = PROTO_OP_TELEMETRY;
+  frame[1] = (uint8_t)(frameSequence & 0xFF);
+  frame[2] = (uint8_t)(frameSequence >> 8);
+  frame[3] = batchedSamples;
+  frame[4] = sizeof(TelemetrySample);
+  size_t length = TELEMETRY_HEADER_SIZE + batchedSamples * sizeof(TelemetrySample);
+
+  for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; i++)
+  {
+    portENTER_CRITICAL(&subscriberLock);
+    TelemetrySubscriber subscriber = subscribers[i];
+    portEXIT_CRITICAL(&subscriberLock);
+
+    if (subscriber.server == nullptr)
+    {
+      continue;
+    }
+
+    AsyncWebSocketClient *client = subscriber.server->client(subscriber.clientId);
+    if (client == nullptr)
+    {
+      telemetrySubscribe(subscriber.server, subscriber.clientId, false);
+      continue;
+    }
+
+    if (subscriber.skipped < subscriber.backoff)
+    {
+      subscriber.skipped++;
+    }
+    else if (!client->canSend())
+    {
+      subscriber.skipped = 0;
+      subscriber.backoff = min(subscriber.backoff * 2 + 1, TELEMETRY_MAX_BACKOFF);
+      congestionSkips++;
+    }
+    else
+    {
+      client->binary(frame, length);
+      subscriber.skipped = 0;
+      if (subscriber.backoff > 0)
+      {
+        subscriber.backoff--;
+      }
+    }
+
+    // Keep the slot's backoff unless it was reassigned meanwhile
+    portENTER_CRITICAL(&subscriberLock);
+    if (subscribers[i].server == subscriber.server && subscribers[i].clientId == subscriber.clientId)
+    {
+      subscribers[i].backoff = subscriber.backoff;
+      subscribers[i].skipped = subscriber.skipped;
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+  }
+}
+
+void serviceTelemetry()
+{
+  loopIterations++;
+  if (subscriberCount == 0 || TELEMETRY_RATE_HZ <= 0)
+  {
+    batchedSamples = 0;
+    return;
+  }
+
+  uint32_t now = millis();
+  if (now - lastSampleMillis < 1000UL / TELEMETRY_RATE_HZ)
+  {
+    return;
+  }
+
+  TelemetrySample sample;
+  takeSample(sample, now);
+  memcpy(frame + TELEMETRY_HEADER_SIZE + batchedSamples * sizeof(TelemetrySample), &sample, sizeof(sample));
+  lastSampleMillis = now;
+  loopIterations = 0;
+
+  if (++batchedSamples >= TELEMETRY_BATCH_SAMPLES)
+  {
+    sendBatch();
+    batchedSamples = 0;
+  }
+}
+
+uint32_t getTelemetryCongestionSkips()
+{
+  return congestionSkips;
+}
@@ -0,0 +1,50 @@
+/*
+ * Opt-in binary telemetry over the WebSockets
+ *
+ * Clients send PROTO_OP_SUBSCRIBE to start or stop. The service task
+ * samples the car at TELEMETRY_RATE_HZ while anyone is subscribed and sends
+ * TELEMETRY_BATCH_SAMPLES samples per PROTO_OP_TELEMETRY frame. A client
+ * whose send queue is congested (canSend() false) skips batches, more of
+ * them each time it stays congested, and recovers one step per batch
+ * that gets through.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+#include "car_commands.h"
+
+#define TELEMETRY_MAX_SUBSCRIBERS 4
+#define TELEMETRY_HEADER_SIZE 5
+
+// One sample on the wire, little-endian
+struct __attribute__((packed)) TelemetrySample
+{
+  uint32_t millis;
+  uint8_t command;                         // METRIC_TYPE_* of the last applied command
+  uint8_t owner;                           // SOURCE_* owning control, 0xFF for none
+  uint16_t channelDuty[MOTOR_CHANNEL_COUNT];
+  int8_t rssi;                             // dBm
+  uint32_t freeHeap;
+  uint16_t loopHz;                         // service task passes per second
+  uint8_t queueDepth;
+  uint8_t queueHighWatermark;
+  uint16_t queueOverflows;
+  uint32_t commandLatencyMicros;           // receive -> applied, last command
+  uint16_t batteryMillivolts;              // filtered pack voltage, 0 when not sensed
+  uint16_t outputScalePermille;            // battery compensation and soft limit on the duties
+  uint8_t batteryState;                    // BatteryState
+};
+
+class AsyncWebSocket;
+
+// Returns false when enabling and every subscriber slot is taken
+bool telemetrySubscribe(AsyncWebSocket *server, uint32_t clientId, bool enable);
+
+void serviceTelemetry();
+
+uint32_t getTelemetryCongestionSkips();
+
+#endif // TELEMETRY_H
@@ -0,0 +1,801 @@
+// Load generator for the car's network endpoints
+//
+// Drives one endpoint at a sweep of command rates and reports, per step,
+// the achieved rate, p50/p99 round-trip latency, the error rate and the
+// device's own counters from /stats and /metrics over the same interval.
+// The first step whose errors pass 1%, whose achieved rate falls below 90%
+// of the offered rate, or whose p99 triples against the first step is
+// reported as the saturation knee.
+//
+// Traffic is open-loop: every worker sends on a fixed schedule and latency
+// is measured from the scheduled send time, so a stalled endpoint shows
+// up as latency instead of silently lowering the rate.
+//
+//   control   binary command frames on /control, timed by their acks
+//   ws        text command frames on /ws; no reply, device side only
+//   gesture   POST /hand-gesture gesture=none, timed by the response
+//   tracking  POST /person-tracking action=track_center, likewise
+//   udp       UDP fast-path datagrams; no reply, device side only
+//
+// Commands default to STOP, which goes through the queue, arbiter and
+// motor task without moving the car. --command N sends command id N on
+// control, ws and udp instead: lift the car off the ground first.
+//
+// Usage: loadgen --host IP [--port 80] [--udp-port 4210] [--target control]
+//                [--rates 10,20,50,100,200] [--concurrency 1] [--duration 5]
+//                [--timeout-ms 1000] [--command 0]
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "arduino_config.h"
+#include "car_commands.h"
+#include "command_protocol.h"
+#include "udp_receiver.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+  std::string host;
+  int port = 80;
+  int udpPort = UDP_COMMAND_PORT;
+  std::string target = "control";
+  std::vector<int> rates = {10, 20, 50, 100, 200};
+  int concurrency = 1;
+  double durationSeconds = 5;
+  int timeoutMillis = 1000;
+  int command = STOP;
+};
+
+// What one worker saw during a step; merged after the step
+struct WorkerResult
+{
+  uint64_t sent = 0;
+  uint64_t completed = 0;
+  uint64_t errors = 0;
+  std::vector<double> latencyMillis;
+};
+
+static double millisSince(Clock::time_point start, Clock::time_point end)
+{
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static bool resolve(const std::string &host, int port, int type, sockaddr_in &address)
+{
+  addrinfo hints = {};
+  addrinfo *result = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = type;
+
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || result == nullptr)
+  {
+    return false;
+  }
+  memcpy(&address, result->ai_addr, sizeof(address));
+  freeaddrinfo(result);
+  return true;
+}
+
+static int connectTcp(const Options &options, int timeoutMillis)
+{
+  sockaddr_in address;
+  if (!resolve(options.host, options.port, SOCK_STREAM, address))
+  {
+    return -1;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  timeval timeout = {timeoutMillis / 1000, (timeoutMillis % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static bool sendAll(int fd, const void *data, size_t len)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (len > 0)
+  {
+    ssize_t written = send(fd, bytes, len, MSG_NOSIGNAL);
+    if (written <= 0)
+    {
+      return false;
+    }
+    bytes += written;
+    len -= written;
+  }
+  return true;
+}
+
+// One HTTP/1.0 request on its own connection; returns the status, -1 on failure
+static int httpRequest(const Options &options, const std::string &method, const std::string &path,
+                       const std::string &body, std::string *response)
+{
+  int fd = connectTcp(options, options.timeoutMillis);
+  if (fd < 0)
+  {
+    return -1;
+  }
+
+  std::string request = method + " " + path + " HTTP/1.0\r\nHost: " + options.host + "\r\n";
+  if (!body.empty())
+  {
+    request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n";
+  }
+  request += "\r\n" + body;
+
+  std::string reply;
+  if (sendAll(fd, request.data(), request.size()))
+  {
+    char buffer[2048];
+    ssize_t got;
+    while ((got = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+      reply.append(buffer, got);
+    }
+  }
+  close(fd);
+
+  int status = -1;
+  if (sscanf(reply.c_str(), "HTTP/%*s %d", &status) != 1)
+  {
+    return -1;
+  }
+  if (response != nullptr)
+  {
+    size_t bodyStart = reply.find("\r\n\r\n");
+    *response = bodyStart == std::string::npos ? "" : reply.substr(bodyStart + 4);
+  }
+  return status;
+}
+
+// Minimal RFC 6455 client: enough for the firmware's two endpoints
+class WebSocket
+{
+public:
+  ~WebSocket()
+  {
+    if (fd_ >= 0)
+    {
+      close(fd_);
+    }
+  }
+
+  bool open(const Options &options, const std::string &path)
+  {
+    fd_ = connectTcp(options, options.timeoutMillis);
+    if (fd_ < 0)
+    {
+      return false;
+    }
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + options.host +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (!sendAll(fd_, request.data(), request.size()))
+    {
+      return false;
+    }
+
+    // Anything after the response headers is already frame data
+    char buffer[1024];
+    while (buffer_.find("\r\n\r\n") == std::string::npos)
+    {
+      ssize_t got = recv(fd_, buffer, sizeof(buffer), 0);
+      if (got <= 0)
+      {
+        return false;
+      }
+      buffer_.append(buffer, got);
+    }
+    if (buffer_.compare(0, 12, "HTTP/1.1 101") != 0)
+    {
+      return false;
+    }
+    buffer_.erase(0, buffer_.find("\r\n\r\n") + 4);
+    return true;
+  }
+
+  int fd() const { return fd_; }
+
+  // Client frames are always masked; a zero mask keeps the payload as is
+  bool sendFrame(uint8_t opcode, const uint8_t *data, size_t len)
+  {
+    uint8_t frame[4 + 4 + 125];
+    if (len > 125)
+    {
+      return false;
+    }
+    frame[0] = 0x80 | opcode;
+    frame[1] = 0x80 | (uint8_t)len;
+    memset(frame + 2, 0, 4);
+    memcpy(frame + 6, data, len);
+    return sendAll(fd_, frame, 6 + len);
+  }
+
+  // Read what is available and hand back complete frames; false once closed
+  bool receive(std::vector<std::string> &frames)
+  {
+    char buffer[2048];
+    ssize_t got = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+      return false;
+    }
+    if (got > 0)
+    {
+      buffer_.append(buffer, got);
+    }
+
+    for (;;)
+    {
+      if (buffer_.size() < 2)
+      {
+        return true;
+      }
+      size_t header = 2;
+      uint64_t len = (uint8_t)buffer_[1] & 0x7F;
+      if (len == 126)
+      {
+        header = 4;
+        if (buffer_.size() < header)
+        {
+          return true;
+        }
+        len = ((uint8_t)buffer_[2] << 8) | (uint8_t)buffer_[3];
+      }
+      else if (len == 127)
+      {
+        header = 10;
+        if (buffer_.size() < header)
+        {
+          return true;
+        }
+        len = 0;
+        for (int i = 0; i < 8; i++)
+        {
+          len = len << 8 | (uint8_t)buffer_[2 + i];
+        }
+      }
+      if (buffer_.size() < header + len)
+      {
+        return true;
+      }
+      frames.push_back(buffer_.substr(header, len));
+      buffer_.erase(0, header + len);
+    }
+  }
+
+private:
+  int fd_ = -1;
+  std::string buffer_;
+};
+
+static void sleepUntil(Clock::time_point when)
+{
+  std::this_thread::sleep_until(when);
+}
+
+// Waits for the socket until the deadline; used between scheduled sends
+static void pollUntil(int fd, Clock::time_point deadline)
+{
+  auto now = Clock::now();
+  if (deadline <= now)
+  {
+    return;
+  }
+  pollfd descriptor = {fd, POLLIN, 0};
+  poll(&descriptor, 1, (int)std::max(1.0, millisSince(now, deadline)));
+}
+
+static void runControlWorker(const Options &options, double rate, Clock::time_point end, WorkerResult &result)
+{
+  WebSocket socket;
+  if (!socket.open(options, "/control"))
+  {
+    result.errors++;
+    return;
+  }
+
+  std::map<uint16_t, Clock::time_point> pending;
+  auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+  auto nextSend = Clock::now();
+  uint16_t sequence = 0;
+  auto drainUntil = end + std::chrono::milliseconds(options.timeoutMillis);
+
+  while (Clock::now() < drainUntil && (Clock::now() < end || !pending.empty()))
+  {
+    if (Clock::now() >= nextSend && nextSend < end)
+    {
+      uint8_t frame[PROTO_HEADER_SIZE + 1] = {PROTO_OP_COMMAND, (uint8_t)sequence, (uint8_t)(sequence >> 8),
+                                              (uint8_t)options.command};
+      pending[sequence] = nextSend;
+      if (!socket.sendFrame(0x2, frame, sizeof(frame)))
+      {
+        result.errors += pending.size();
+        return;
+      }
+      result.sent++;
+      sequence++;
+      nextSend += interval;
+      continue;
+    }
+
+    pollUntil(socket.fd(), std::min(nextSend < end ? nextSend : drainUntil, drainUntil));
+    std::vector<std::string> frames;
+    if (!socket.receive(frames))
+    {
+      result.errors += pending.size();
+      return;
+    }
+
+    auto now = Clock::now();
+    for (const std::string &frame : frames)
+    {
+      if (frame.size() >= PROTO_ACK_SIZE && (uint8_t)frame[0] == PROTO_OP_ACK)
+      {
+        uint16_t ackSequence = (uint8_t)frame[1] | ((uint8_t)frame[2] << 8);
+        auto found = pending.find(ackSequence);
+        if (found == pending.end())
+        {
+          continue;
+        }
+        if ((uint8_t)frame[3] == PROTO_ACK_OK)
+        {
+          result.completed++;
+          result.latencyMillis.push_back(millisSince(found->second, now));
+        }
+        else
+        {
+          result.errors++;
+        }
+        pending.erase(found);
+      }
+    }
+
+    // Acks that never came
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+      if (millisSince(it->second, now) > options.timeoutMillis)
+      {
+        result.errors++;
+        it = pending.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+  result.errors += pending.size();
+}
+
+static void runWsWorker(const Options &options, double rate, Clock::time_point end, WorkerResult &result)
+{
+  WebSocket socket;
+  if (!socket.open(options, "/ws"))
+  {
+    result.errors++;
+    return;
+  }
+
+  auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+  std::string text = std::to_string(options.command);
+
+  for (auto nextSend = Clock::now(); nextSend < end; nextSend += interval)
+  {
+    sleepUntil(nextSend);
+    if (!socket.sendFrame(0x1, (const uint8_t *)text.data(), text.size()))
+    {
+      result.errors++;
+      return;
+    }
+    result.sent++;
+    result.completed++;
+
+    // State pushes are not replies; just keep the receive window open
+    std::vector<std::string> frames;
+    if (!socket.receive(frames))
+    {
+      result.errors++;
+      return;
+    }
+  }
+}
+
+static void runHttpWorker(const Options &options, double rate, Clock::time_point end, WorkerResult &result)
+{
+  bool gesture = options.target == "gesture";
+  std::string path = gesture ? "/hand-gesture" : "/person-tracking";
+  std::string body = gesture ? "gesture=none" : "action=track_center";
+  auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+
+  for (auto nextSend = Clock::now(); nextSend < end; nextSend += interval)
+  {
+    sleepUntil(nextSend);
+    result.sent++;
+    int status = httpRequest(options, "POST", path, body, nullptr);
+    if (status == 200)
+    {
+      result.completed++;
+      result.latencyMillis.push_back(millisSince(nextSend, Clock::now()));
+    }
+    else
+    {
+      result.errors++;
+    }
+  }
+}
+
+static void writeUint32(uint8_t *data, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    data[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static void runUdpWorker(const Options &options, double rate, Clock::time_point end, WorkerResult &result,
+                         std::atomic<uint32_t> &sequence)
+{
+  sockaddr_in address;
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0 || !resolve(options.host, options.udpPort, SOCK_DGRAM, address))
+  {
+    result.errors++;
+    return;
+  }
+
+  auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+  auto start = Clock::now();
+
+  for (auto nextSend = start; nextSend < end; nextSend += interval)
+  {
+    sleepUntil(nextSend);
+    uint8_t datagram[UDP_HEADER_SIZE + PROTO_HEADER_SIZE + 1] = {};
+    uint32_t datagramSequence = sequence.fetch_add(1) + 1;
+    writeUint32(datagram, datagramSequence);
+    writeUint32(datagram + 4, (uint32_t)millisSince(start, Clock::now()));
+    datagram[UDP_HEADER_SIZE] = PROTO_OP_COMMAND;
+    datagram[UDP_HEADER_SIZE + 1] = (uint8_t)datagramSequence;
+    datagram[UDP_HEADER_SIZE + 2] = (uint8_t)(datagramSequence >> 8);
+    datagram[UDP_HEADER_SIZE + 3] = (uint8_t)options.command;
+
+    result.sent++;
+    if (sendto(fd, datagram, sizeof(datagram), 0, (sockaddr *)&address, sizeof(address)) == sizeof(datagram))
+    {
+      result.completed++;
+    }
+    else
+    {
+      result.errors++;
+    }
+  }
+  close(fd);
+}
+
+// "name value" lines from /stats and the command counters from /metrics
+static std::map<std::string, double> fetchCounters(const Options &options, std::string &metrics)
+{
+  std::map<std::string, double> counters;
+  std::string stats;
+
+  if (httpRequest(options, "GET", "/stats", "", &stats) == 200)
+  {
+    char name[96];
+    double value;
+    size_t lineStart = 0;
+    while (lineStart < stats.size())
+    {
+      size_t lineEnd = stats.find('\n', lineStart);
+      std::string line = stats.substr(lineStart, lineEnd - lineStart);
+      if (sscanf(line.c_str(), "%95s %lf", name, &value) == 2)
+      {
+        counters[name] = value;
+      }
+      lineStart = lineEnd == std::string::npos ? stats.size() : lineEnd + 1;
+    }
+  }
+  if (httpRequest(options, "GET", "/metrics", "", &metrics) != 200)
+  {
+    metrics.clear();
+  }
+  return counters;
+}
+
+static double percentile(std::vector<double> values, int percent)
+{
+  if (values.empty())
+  {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+static const char *deviceSourceName(const std::string &target)
+{
+  if (target == "control")
+  {
+    return "control";
+  }
+  if (target == "gesture")
+  {
+    return "hand_gesture";
+  }
+  if (target == "tracking")
+  {
+    return "person_tracking";
+  }
+  return target.c_str();
+}
+
+// Device-side view of the same step: processed commands, overflows, drops and latency
+static void reportDevice(const Options &options, const std::map<std::string, double> &before,
+                         const std::map<std::string, double> &after, const std::string &metrics)
+{
+  static const char *counters[] = {"commands_processed", "queue_overflows", "udp_commands_processed",
+                                   "udp_queue_overflows", "udp_dropped_stale", "udp_dropped_queue_full",
+                                   "arbiter_rejections", "lease_expiries", "wifi_disconnects"};
+
+  printf("    device:");
+  for (const char *name : counters)
+  {
+    auto first = before.find(name);
+    auto last = after.find(name);
+    if (first != before.end() && last != after.end())
+    {
+      printf(" %s +%.0f", name, last->second - first->second);
+    }
+  }
+  printf("\n");
+
+  // Histograms are cumulative since boot; good enough to spot a trend across steps
+  std::string countsLine = std::string("commands_total{source=\"") + deviceSourceName(options.target) + "\"}";
+  size_t lineStart = 0;
+  while (lineStart < metrics.size())
+  {
+    size_t lineEnd = metrics.find('\n', lineStart);
+    std::string line = metrics.substr(lineStart, lineEnd - lineStart);
+    if (line.compare(0, countsLine.size(), countsLine) == 0 || line.compare(0, 18, "command_latency_us") == 0 ||
+        line.compare(0, 19, "dispatch_latency_us") == 0)
+    {
+      printf("    device: %s\n", line.c_str());
+    }
+    lineStart = lineEnd == std::string::npos ? metrics.size() : lineEnd + 1;
+  }
+}
+
+static std::vector<int> parseRates(const char *text)
+{
+  std::vector<int> rates;
+  for (const char *p = text; *p != '\0';)
+  {
+    int rate = atoi(p);
+    if (rate > 0)
+    {
+      rates.push_back(rate);
+    }
+    const char *comma = strchr(p, ',');
+    p = comma == nullptr ? p + strlen(p) : comma + 1;
+  }
+  return rates;
+}
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: loadgen --host IP [--port 80] [--udp-port %d] [--target control|ws|gesture|tracking|udp]\n"
+          "               [--rates 10,20,50,100,200] [--concurrency 1] [--duration 5] [--timeout-ms 1000]\n"
+          "               [--command 0]\n",
+          UDP_COMMAND_PORT);
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string flag = argv[i];
+    if (i + 1 >= argc)
+    {
+      return false;
+    }
+    const char *value = argv[++i];
+
+    if (flag == "--host")
+    {
+      options.host = value;
+    }
+    else if (flag == "--port")
+    {
+      options.port = atoi(value);
+    }
+    else if (flag == "--udp-port")
+    {
+      options.udpPort = atoi(value);
+    }
+    else if (flag == "--target")
+    {
+      options.target = value;
+    }
+    else if (flag == "--rates")
+    {
+      options.rates = parseRates(value);
+    }
+    else if (flag == "--concurrency")
+    {
+      options.concurrency = std::max(1, atoi(value));
+    }
+    else if (flag == "--duration")
+    {
+      options.durationSeconds = atof(value);
+    }
+    else if (flag == "--timeout-ms")
+    {
+      options.timeoutMillis = atoi(value);
+    }
+    else if (flag == "--command")
+    {
+      options.command = atoi(value);
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  static const char *targets[] = {"control", "ws", "gesture", "tracking", "udp"};
+  bool knownTarget = std::find_if(std::begin(targets), std::end(targets), [&](const char *target) {
+                       return options.target == target;
+                     }) != std::end(targets);
+  return !options.host.empty() && knownTarget && !options.rates.empty() && options.command >= 0 &&
+         options.command <= LAST_COMMAND;
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    usage();
+    return 2;
+  }
+  if (options.command != STOP)
+  {
+    fprintf(stderr, "warning: command %d moves the car\n", options.command);
+  }
+
+  printf("target %s on %s, %d worker(s), %.1f s per step\n", options.target.c_str(), options.host.c_str(),
+         options.concurrency, options.durationSeconds);
+
+  std::atomic<uint32_t> udpSequence{(uint32_t)time(nullptr)};
+  double baselineP99 = 0;
+  int kneeRate = 0;
+  int lastGoodRate = 0;
+
+  for (int rate : options.rates)
+  {
+    std::string metricsBefore;
+    std::string metricsAfter;
+    std::map<std::string, double> before = fetchCounters(options, metricsBefore);
+
+    std::vector<WorkerResult> results(options.concurrency);
+    std::vector<std::thread> workers;
+    double workerRate = (double)rate / options.concurrency;
+    auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(options.durationSeconds));
+
+    for (int i = 0; i < options.concurrency; i++)
+    {
+      WorkerResult &result = results[i];
+      workers.emplace_back([&, workerRate, end]() {
+        if (options.target == "control")
+        {
+          runControlWorker(options, workerRate, end, result);
+        }
+        else if (options.target == "ws")
+        {
+          runWsWorker(options, workerRate, end, result);
+        }
+        else if (options.target == "udp")
+        {
+          runUdpWorker(options, workerRate, end, result, udpSequence);
+        }
+        else
+        {
+          runHttpWorker(options, workerRate, end, result);
+        }
+      });
+    }
+    for (std::thread &worker : workers)
+    {
+      worker.join();
+    }
+
+    // Let the device drain before reading its counters
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::map<std::string, double> after = fetchCounters(options, metricsAfter);
+
+    WorkerResult total;
+    for (const WorkerResult &result : results)
+    {
+      total.sent += result.sent;
+      total.completed += result.completed;
+      total.errors += result.errors;
+      total.latencyMillis.insert(total.latencyMillis.end(), result.latencyMillis.begin(), result.latencyMillis.end());
+    }
+
+    // Device-side losses count as errors for targets without replies
+    double deviceLosses = 0;
+    for (const char *name : {"queue_overflows", "udp_queue_overflows", "udp_dropped_stale", "udp_dropped_queue_full"})
+    {
+      if (before.count(name) && after.count(name))
+      {
+        deviceLosses += after[name] - before[name];
+      }
+    }
+
+    double achieved = total.completed / options.durationSeconds;
+    double errorRate = total.sent > 0 ? (total.errors + deviceLosses) / total.sent : 1;
+    double p50 = percentile(total.latencyMillis, 50);
+    double p99 = percentile(total.latencyMillis, 99);
+    printf("rate %5d/s: achieved %7.1f/s, errors %5.2f%%, rtt p50 %7.2f ms p99 %7.2f ms (%zu samples)\n", rate,
+           achieved, errorRate * 100, p50, p99, total.latencyMillis.size());
+    reportDevice(options, before, after, metricsAfter);
+
+    if (baselineP99 == 0)
+    {
+      baselineP99 = p99;
+    }
+    bool saturated = errorRate > 0.01 || achieved < 0.9 * rate || (baselineP99 > 0 && p99 > 3 * baselineP99);
+    if (saturated && kneeRate == 0)
+    {
+      kneeRate = rate;
+    }
+    else if (!saturated && kneeRate == 0)
+    {
+      lastGoodRate = rate;
+    }
+  }
+
+  if (kneeRate != 0)
+  {
+    printf("saturation knee between %d/s (last good step) and %d/s\n", lastGoodRate, kneeRate);
+  }
+  else
+  {
+    printf("no saturation up to %d/s\n", options.rates.back());
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+
+#include "arduino_config.h"
+#include "tracking_control.h"
+
+static_assert(TRACKING_MIN_DUTY <= TRACKING_MAX_DUTY, "tracking min_duty must not exceed max_duty");
+static_assert(TRACKER_EXIT_BAND <= TRACKER_ENTER_BAND, "tracking controller exit_band must not exceed enter_band");
+
+// Controller state, only touched by the motor task
+static bool active = false;
+static bool turning = false;
+static int lastX = 0;
+static int velocity = 0;  // offset units per second, smoothed
+static uint32_t lastFrameMillis = 0;
+static uint32_t lastSeenMillis = 0;
+
+static std::atomic<uint32_t> observationsUsed{0};
+static std::atomic<uint32_t> observationsIgnored{0};
+static std::atomic<uint32_t> targetsLost{0};
+
+static int clampRate(int value)
+{
+  return std::min(std::max(value, -TRACKING_RATE_LIMIT), TRACKING_RATE_LIMIT);
+}
+
+// The error comes straight from request parameters, so it is clamped
+// before the gain can overflow it
+int trackingErrorToTurnRate(int error)
+{
+  return clampRate(clampRate(error) * TRACKING_GAIN_PERCENT / 100);
+}
+
+int turnRateToDuty(int turnRate)
+{
+  int magnitude = abs(clampRate(turnRate));
+  if (magnitude <= TRACKING_DEAD_BAND)
+  {
+    return 0;
+  }
+
+  // Rescale what is left above the dead-band onto min..max duty
+  int span = TRACKING_RATE_LIMIT - TRACKING_DEAD_BAND;
+  int duty = TRACKING_MIN_DUTY + (TRACKING_MAX_DUTY - TRACKING_MIN_DUTY) * (magnitude - TRACKING_DEAD_BAND) / span;
+  return turnRate > 0 ? duty : -duty;
+}
+
+void trackerReset()
+{
+  active = false;
+  turning = false;
+  velocity = 0;
+}
+
+bool trackerObserve(const TargetObservation &observation, uint32_t nowMillis)
+{
+  // UDP may reorder frames; the host clock only has to be monotonic
+  bool stale = active && (int32_t)(observation.frameMillis - lastFrameMillis) <= 0;
+  if (observation.confidence < TRACKER_MIN_CONFIDENCE || observation.width == 0 || stale)
+  {
+    observationsIgnored.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  int x = clampRate(observation.x);
+  uint32_t frameGap = observation.frameMillis - lastFrameMillis;
+  if (active && frameGap <= TRACKER_PREDICT_MS)
+  {
+    velocity = (velocity + (x - lastX) * 1000 / (int)frameGap) / 2;
+  }
+  else
+  {
+    velocity = 0;
+  }
+
+  lastX = x;
+  lastFrameMillis = observation.frameMillis;
+  lastSeenMillis = nowMillis;
+  active = true;
+  observationsUsed.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+int trackerStep(uint32_t nowMillis)
+{
+  if (!active)
+  {
+    return 0;
+  }
+
+  uint32_t age = nowMillis - lastSeenMillis;
+  if (age >= TRACKER_LOST_MS)
+  {
+    trackerReset();
+    targetsLost.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  // Where the target should be by now if it kept moving
+  int x = clampRate(lastX + velocity * (int)std::min(age, (uint32_t)TRACKER_PREDICT_MS) / 1000);
+  int magnitude = abs(x);
+
+  if (!turning && magnitude > TRACKER_ENTER_BAND)
+  {
+    turning = true;
+  }
+  else if (turning && magnitude < TRACKER_EXIT_BAND)
+  {
+    turning = false;
+  }
+  return turning ? trackingErrorToTurnRate(x) : 0;
+}
+
+bool trackerActive()
+{
+  return active;
+}
+
+TrackerStats getTrackerStats()
+{
+  TrackerStats stats;
+  stats.observations = observationsUsed.load(std::memory_order_relaxed);
+  stats.ignored = observationsIgnored.load(std::memory_order_relaxed);
+  stats.targetsLost = targetsLost.load(std::memory_order_relaxed);
+  return stats;
+}
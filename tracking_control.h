@@ -0,0 +1,60 @@
+/*
+ * Proportional turning for person tracking.
+ *
+ * The host reports how far the target is from the frame centre as a
+ * signed error, -1000 (far left) .. 1000 (far right), or asks for a turn
+ * rate directly on the same scale. Rates map onto a PWM duty between
+ * TRACKING_MIN_DUTY and TRACKING_MAX_DUTY, so small errors turn gently
+ * instead of spinning at MAX_SPEED.
+ *
+ * Or the host streams raw observations (PROTO_OP_OBSERVE, one per camera
+ * frame) and the car runs the controller itself, at TRACKER_RATE_HZ on
+ * the motor task:
+ *
+ *   - observations below TRACKER_MIN_CONFIDENCE, without a target or not
+ *     newer than the last frame are ignored
+ *   - across dropped frames the target is extrapolated from its recent
+ *     velocity, for at most TRACKER_PREDICT_MS
+ *   - turning starts once the offset exceeds TRACKER_ENTER_BAND and only
+ *     ends below TRACKER_EXIT_BAND, so a target on the edge of the
+ *     dead-band does not make the car twitch
+ *   - the turn rate is trackingErrorToTurnRate() of the offset
+ *   - after TRACKER_LOST_MS without a usable observation the car stops
+ *     and the controller idles until the next one
+ */
+
+#ifndef TRACKING_CONTROL_H
+#define TRACKING_CONTROL_H
+
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define TRACKING_RATE_LIMIT 1000
+
+struct TrackerStats
+{
+  uint32_t observations;  // used to steer
+  uint32_t ignored;       // low confidence, no target or out of order
+  uint32_t targetsLost;
+};
+
+// Positive turn rate turns right (clockwise seen from above)
+int trackingErrorToTurnRate(int error);
+
+// Signed duty for the left side motors; the right side gets the negation.
+// Returns 0 inside the dead-band.
+int turnRateToDuty(int turnRate);
+
+// On-device controller, motor task only. trackerObserve() returns false
+// for an observation it ignored; trackerStep() returns the turn rate for
+// this tick and goes idle once the target is lost.
+void trackerReset();
+bool trackerObserve(const TargetObservation &observation, uint32_t nowMillis);
+int trackerStep(uint32_t nowMillis);
+bool trackerActive();
+
+// Safe from any task
+TrackerStats getTrackerStats();
+
+#endif // TRACKING_CONTROL_H
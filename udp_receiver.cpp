@@ -0,0 +1,112 @@
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+#include "arduino_config.h"
+#include "car_log.h"
+#include "motor_control.h"
+#include "udp_receiver.h"
+
+static AsyncUDP udp;
+
+// Only written from the AsyncUDP task
+static UdpReceiverStats stats = {};
+static bool haveSequence = false;
+static uint32_t lastPacketMillis = 0;
+static CommandBatch receivedBatch;
+
+static uint32_t readUint32(const uint8_t *data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+bool decodeUdpDatagram(const uint8_t *data, size_t len, uint32_t &sequence, uint32_t &senderTimestamp, CarCommand &command)
+{
+  if (len < UDP_HEADER_SIZE)
+  {
+    return false;
+  }
+
+  sequence = readUint32(data);
+  senderTimestamp = readUint32(data + 4);
+  return decodeBinaryCommand(data + UDP_HEADER_SIZE, len - UDP_HEADER_SIZE, command);
+}
+
+static void onUdpPacket(AsyncUDPPacket &packet)
+{
+  uint32_t receivedMicros = micros();
+  stats.received++;
+
+  uint32_t sequence;
+  uint32_t senderTimestamp;
+  CarCommand command = {};
+  if (!decodeUdpDatagram(packet.data(), packet.length(), sequence, senderTimestamp, command) ||
+      command.opcode == PROTO_OP_PING || command.opcode == PROTO_OP_SUBSCRIBE ||
+      command.opcode == PROTO_OP_SCRIPT)
+  {
+    stats.droppedMalformed++;
+    return;
+  }
+
+  uint32_t now = millis();
+  if (haveSequence && now - lastPacketMillis > UDP_SESSION_TIMEOUT_MS)
+  {
+    haveSequence = false;
+  }
+
+  // Wrap-safe "newer than": anything at or behind the newest accepted is stale
+  if (haveSequence && (int32_t)(sequence - stats.lastSequence) <= 0)
+  {
+    stats.droppedStale++;
+    return;
+  }
+
+  bool queued;
+  if (command.opcode == PROTO_OP_BATCH)
+  {
+    if (!decodeCommandBatch(packet.data() + UDP_HEADER_SIZE, packet.length() - UDP_HEADER_SIZE, receivedBatch))
+    {
+      stats.droppedMalformed++;
+      return;
+    }
+    receivedBatch.source = SOURCE_UDP;
+    receivedBatch.receivedMicros = receivedMicros;
+    receivedBatch.decodedMicros = micros();
+    queued = submitCommandBatch(receivedBatch, PRODUCER_UDP);
+  }
+  else
+  {
+    command.source = SOURCE_UDP;
+    command.receivedMicros = receivedMicros;
+    command.decodedMicros = micros();
+    queued = submitCarCommand(command, PRODUCER_UDP);
+  }
+  if (!queued)
+  {
+    stats.droppedQueueFull++;
+    return;
+  }
+
+  haveSequence = true;
+  lastPacketMillis = now;
+  stats.lastSequence = sequence;
+  stats.lastSenderTimestamp = senderTimestamp;
+  stats.accepted++;
+}
+
+bool startUdpReceiver()
+{
+  if (!udp.listen(UDP_COMMAND_PORT))
+  {
+    LOG_ERROR("UDP listen on port %d failed", UDP_COMMAND_PORT);
+    return false;
+  }
+
+  udp.onPacket(onUdpPacket);
+  LOG_INFO("UDP command receiver listening on port %d", UDP_COMMAND_PORT);
+  return true;
+}
+
+UdpReceiverStats getUdpReceiverStats()
+{
+  return stats;
+}
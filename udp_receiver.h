@@ -0,0 +1,48 @@
+/*
+ * UDP fast-path command receiver.
+ *
+ * Each datagram carries a sequence number and the sender's timestamp in
+ * front of a regular binary command frame (see command_protocol.h):
+ *
+ *   byte 0..3  sequence number (u32 LE, increasing per sender)
+ *   byte 4..7  sender timestamp (u32 LE, sender clock)
+ *   byte 8..   binary command frame
+ *
+ * A datagram is dropped as stale unless its sequence number is newer
+ * than the newest one accepted, so a late retransmission or reordered
+ * packet can never undo a fresher command. After UDP_SESSION_TIMEOUT_MS
+ * of silence the sequence is forgotten so a restarted sender is accepted.
+ * A PROTO_OP_BATCH frame goes to the jitter buffer (jitter_buffer.h) as a
+ * whole once its datagram passes that check.
+ */
+
+#ifndef UDP_RECEIVER_H
+#define UDP_RECEIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_protocol.h"
+
+#define UDP_HEADER_SIZE 8
+
+struct UdpReceiverStats
+{
+  uint32_t received;
+  uint32_t accepted;
+  uint32_t droppedStale;
+  uint32_t droppedMalformed;
+  uint32_t droppedQueueFull;
+  uint32_t lastSequence;
+  uint32_t lastSenderTimestamp;
+};
+
+// Decode the datagram header and command frame; false if malformed
+bool decodeUdpDatagram(const uint8_t *data, size_t len, uint32_t &sequence, uint32_t &senderTimestamp, CarCommand &command);
+
+// Start listening on UDP_COMMAND_PORT. Needs the network interface up.
+bool startUdpReceiver();
+
+UdpReceiverStats getUdpReceiverStats();
+
+#endif // UDP_RECEIVER_H
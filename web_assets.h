@@ -0,0 +1,85 @@
+/*
+ * AUTO-GENERATED WEB ASSETS
+ * Generated from web/control_page.html by build_web_assets.py
+ * DO NOT EDIT THIS FILE DIRECTLY - Edit web/control_page.html instead
+ */
+
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <Arduino.h>
+
+// 3153 bytes minified, 1060 bytes gzip-compressed
+#define CONTROL_PAGE_ETAG "\"552bc698d8b143a2\""
+const size_t CONTROL_PAGE_GZ_LENGTH = 1060;
+const uint8_t CONTROL_PAGE_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x57, 0x6d, 0x6f, 0xdb, 0x36,
+  0x10, 0xfe, 0xae, 0x5f, 0xc1, 0xb2, 0xd8, 0x6a, 0x63, 0x96, 0x2c, 0x3b, 0x6f, 0xae, 0x64, 0x19,
+  0x48, 0x53, 0x6f, 0xcb, 0x90, 0xa5, 0xc5, 0x9c, 0xa1, 0x18, 0x50, 0xa0, 0xa0, 0x45, 0xda, 0x26,
+  0x42, 0x91, 0x06, 0x49, 0xf9, 0xa5, 0x81, 0xff, 0xfb, 0x8e, 0x92, 0xe5, 0xc4, 0x89, 0x50, 0xa4,
+  0x89, 0x03, 0x38, 0x16, 0x79, 0xc7, 0xe7, 0xee, 0x9e, 0x3b, 0xf1, 0xce, 0xfd, 0x37, 0x1f, 0x3f,
+  0x5d, 0xdc, 0xfc, 0xf7, 0x79, 0x88, 0x66, 0x36, 0x13, 0x03, 0xaf, 0x5f, 0x7d, 0x31, 0x42, 0xe1,
+  0x2b, 0x63, 0x96, 0x20, 0x49, 0x32, 0x96, 0xe0, 0x05, 0x67, 0xcb, 0xb9, 0xd2, 0x16, 0xa3, 0x54,
+  0x49, 0xcb, 0xa4, 0x4d, 0xf0, 0x92, 0x53, 0x3b, 0x4b, 0x28, 0x5b, 0xf0, 0x94, 0xf9, 0xc5, 0xa2,
+  0x85, 0xb8, 0xe4, 0x96, 0x13, 0xe1, 0x9b, 0x94, 0x08, 0x96, 0x74, 0x5a, 0x28, 0x23, 0x2b, 0x9e,
+  0xe5, 0xd9, 0xfd, 0x46, 0x6e, 0x98, 0x2e, 0x56, 0x64, 0x0c, 0x1b, 0x52, 0x61, 0xb0, 0x63, 0xec,
+  0x5a, 0xb0, 0x81, 0x17, 0x10, 0xad, 0xd5, 0xd2, 0xa0, 0x3b, 0x6f, 0x02, 0x36, 0x7c, 0xc3, 0xbf,
+  0xb3, 0xe8, 0x2c, 0x9c, 0xaf, 0x62, 0x2f, 0x55, 0x42, 0xe9, 0x48, 0x33, 0x1a, 0x7b, 0x1b, 0x2f,
+  0x48, 0xb9, 0x4e, 0x73, 0x41, 0xf4, 0xf9, 0x53, 0xf5, 0xde, 0x03, 0xf5, 0xb1, 0xc8, 0x99, 0xd3,
+  0xb7, 0x14, 0x54, 0xc6, 0x24, 0xbd, 0x9d, 0x6a, 0x95, 0x4b, 0xea, 0x57, 0x52, 0xd8, 0x89, 0xbd,
+  0xb1, 0xd2, 0x14, 0x1c, 0xd2, 0x84, 0xf2, 0xdc, 0x44, 0xdd, 0x93, 0x5f, 0xdc, 0xd6, 0xca, 0x37,
+  0x33, 0x42, 0xd5, 0x32, 0x42, 0x27, 0xf3, 0x55, 0xf1, 0x79, 0xdb, 0x2b, 0xfe, 0x4a, 0xb8, 0x88,
+  0xa4, 0x96, 0x2f, 0x18, 0xa0, 0x5a, 0x4d, 0xa4, 0x99, 0x28, 0x9d, 0x45, 0xa8, 0x78, 0x14, 0xc4,
+  0xb2, 0x06, 0xe8, 0xb7, 0xe0, 0xd3, 0xdc, 0x47, 0x92, 0x4a, 0x16, 0xde, 0x04, 0x52, 0x19, 0x26,
+  0x58, 0x6a, 0xe1, 0xb8, 0xbf, 0x64, 0xe3, 0x5b, 0x6e, 0x7d, 0xab, 0xf2, 0x74, 0xe6, 0x03, 0x27,
+  0x42, 0xe5, 0xb6, 0x52, 0xad, 0x84, 0x25, 0x61, 0xc5, 0x91, 0x9d, 0xe8, 0xd6, 0xe5, 0xa9, 0x56,
+  0x92, 0xa9, 0xef, 0xf5, 0xfb, 0xa6, 0x6e, 0xbb, 0x66, 0x6b, 0xe3, 0xf5, 0xdb, 0xdb, 0x7c, 0xf4,
+  0xdb, 0xdb, 0x3a, 0x18, 0x2b, 0xba, 0x46, 0xa9, 0x20, 0xc6, 0x24, 0xb8, 0x72, 0x1f, 0x23, 0x22,
+  0xf8, 0x54, 0x26, 0x38, 0x85, 0x62, 0x60, 0x1a, 0xa3, 0xe2, 0x50, 0x82, 0x9f, 0x10, 0xbd, 0x9c,
+  0x71, 0xcb, 0x5c, 0x96, 0x67, 0x9d, 0x4a, 0xa7, 0x14, 0x20, 0xcb, 0x88, 0x88, 0x2d, 0x5b, 0x59,
+  0xbf, 0x80, 0x8a, 0x4a, 0xa4, 0x18, 0x0f, 0xfe, 0x24, 0x66, 0x86, 0x2e, 0x65, 0x2a, 0x72, 0xca,
+  0xd0, 0xd0, 0x59, 0xd3, 0x4a, 0xf2, 0xd4, 0x80, 0x43, 0x1d, 0x07, 0xd4, 0x7d, 0x2e, 0xd0, 0x17,
+  0xee, 0xff, 0xce, 0xd1, 0xaf, 0x6f, 0x3b, 0xdd, 0xde, 0xe9, 0xe9, 0x51, 0x8c, 0x2e, 0xa0, 0x50,
+  0xb4, 0x12, 0x80, 0xd3, 0x05, 0x1c, 0xeb, 0x4a, 0x10, 0x71, 0x9a, 0xe0, 0x8c, 0x70, 0x79, 0xe3,
+  0x56, 0xbb, 0x30, 0x8a, 0x7a, 0x8e, 0x8e, 0x43, 0x57, 0x4f, 0x19, 0xd1, 0x53, 0x2e, 0x23, 0x92,
+  0x5b, 0x15, 0x17, 0x67, 0x7c, 0x41, 0xd6, 0x2e, 0x53, 0x13, 0xbe, 0x62, 0x14, 0xa3, 0x8b, 0xe1,
+  0xd5, 0xd5, 0xe8, 0xf3, 0xf9, 0xc5, 0xe5, 0xf5, 0x1f, 0x49, 0x27, 0x74, 0xc0, 0xda, 0xfd, 0xa3,
+  0x08, 0xac, 0xb9, 0xcc, 0x1a, 0x4b, 0xb4, 0x4d, 0xde, 0x29, 0x79, 0xe3, 0x56, 0x23, 0xb7, 0x3a,
+  0x97, 0x74, 0x28, 0x69, 0x03, 0x9f, 0xe0, 0xe6, 0xbb, 0x4a, 0x8d, 0x49, 0x5a, 0xaf, 0x14, 0x82,
+  0xd2, 0xa0, 0x6f, 0xe6, 0x44, 0x56, 0x49, 0x28, 0x5f, 0x14, 0x8c, 0x06, 0x10, 0x5a, 0x27, 0xec,
+  0x9c, 0xc5, 0x90, 0x33, 0x10, 0x0f, 0xfa, 0x6d, 0x4b, 0x9f, 0x6b, 0xba, 0xf3, 0x6a, 0xd3, 0xbd,
+  0xd3, 0xb3, 0xf7, 0x2f, 0xb1, 0x7c, 0x7a, 0x90, 0xa0, 0x4f, 0x1f, 0x99, 0x6e, 0x97, 0xac, 0x3f,
+  0x9b, 0xfa, 0xa3, 0x43, 0xc4, 0xdf, 0x7b, 0x12, 0xff, 0x4f, 0x31, 0x71, 0x7c, 0x00, 0x1f, 0x7a,
+  0xe1, 0x2b, 0x89, 0x38, 0x3b, 0x48, 0x3a, 0x5e, 0x54, 0x09, 0xdd, 0x43, 0xc4, 0xdf, 0x79, 0x89,
+  0xe5, 0xde, 0x41, 0x82, 0xee, 0xbd, 0x92, 0xfa, 0xf7, 0x2f, 0xf3, 0x62, 0xbf, 0x01, 0x6e, 0x79,
+  0x38, 0x3a, 0x7e, 0xca, 0xc3, 0x0f, 0xef, 0xe4, 0xf8, 0x41, 0x7b, 0x72, 0x77, 0x3f, 0xfe, 0xb9,
+  0xeb, 0x23, 0x3c, 0xa4, 0xef, 0x27, 0xb5, 0x44, 0xb6, 0x8b, 0xdb, 0x16, 0x1e, 0xe6, 0xc5, 0x2d,
+  0xad, 0x96, 0xf2, 0x41, 0xa3, 0x29, 0x23, 0x99, 0x6a, 0xb2, 0xae, 0xb9, 0xfa, 0x8b, 0x89, 0x60,
+  0x42, 0x32, 0x2e, 0xd6, 0x91, 0x81, 0xc6, 0x0c, 0x4d, 0x4e, 0xf3, 0x09, 0x1e, 0x6c, 0x1b, 0x40,
+  0xd9, 0xec, 0xfa, 0xed, 0xb9, 0x1b, 0x3e, 0x52, 0xcd, 0xe7, 0x76, 0xe0, 0x2d, 0x88, 0x46, 0xd0,
+  0x72, 0x47, 0x2a, 0xbd, 0x65, 0xf6, 0x5f, 0x2d, 0x50, 0x82, 0xf0, 0xd2, 0x44, 0x5f, 0xdb, 0x5f,
+  0xdb, 0x18, 0xfd, 0x86, 0x96, 0x5c, 0x02, 0x51, 0x81, 0x50, 0x29, 0xb1, 0x5c, 0xc9, 0x60, 0xa6,
+  0x8c, 0x75, 0xa3, 0x11, 0x88, 0x70, 0x1b, 0x02, 0x89, 0x2b, 0x00, 0x53, 0x00, 0xc4, 0xde, 0x24,
+  0x97, 0xa9, 0xd3, 0x2c, 0x66, 0xa2, 0x2f, 0x15, 0x70, 0xa3, 0xe9, 0xdd, 0x79, 0x3b, 0x2d, 0xb0,
+  0x21, 0xd9, 0x12, 0xdd, 0x4b, 0x1f, 0x3a, 0x00, 0x03, 0xc4, 0x4e, 0x31, 0x50, 0x52, 0xcd, 0x99,
+  0x04, 0xfd, 0x0a, 0xb6, 0xc1, 0x16, 0x10, 0x6a, 0xf3, 0x6e, 0xb3, 0xaf, 0x95, 0x0a, 0xe8, 0xcf,
+  0x35, 0x6a, 0x86, 0xd9, 0x1b, 0x9e, 0x31, 0xe8, 0x5a, 0x8d, 0x3d, 0x7f, 0x5a, 0xa8, 0x1b, 0x86,
+  0x61, 0x33, 0x7e, 0x04, 0x93, 0x31, 0x63, 0xc8, 0xb4, 0x06, 0x08, 0xbc, 0x77, 0x71, 0x42, 0x61,
+  0x58, 0x27, 0xfd, 0x6b, 0xf4, 0xe9, 0x3a, 0x98, 0x13, 0x6d, 0x58, 0x29, 0x0f, 0x28, 0xb1, 0x04,
+  0x1c, 0xa7, 0x2a, 0xcd, 0x33, 0xb7, 0x9e, 0x32, 0x0b, 0x0d, 0xdc, 0x3d, 0x7e, 0x58, 0x5f, 0x42,
+  0x41, 0x94, 0x39, 0x6c, 0x06, 0x2e, 0x65, 0x17, 0xe5, 0x24, 0xe9, 0x88, 0xde, 0xe5, 0xc5, 0x51,
+  0x5d, 0x80, 0x07, 0x85, 0x26, 0xcc, 0x23, 0x6e, 0x24, 0x71, 0x26, 0xaf, 0x86, 0xe7, 0xa3, 0xe1,
+  0xb7, 0x7f, 0x86, 0xd7, 0xc3, 0x2f, 0xdf, 0xfe, 0x1e, 0xc1, 0xa1, 0xce, 0x49, 0x58, 0x92, 0xae,
+  0x19, 0x90, 0xe8, 0xa2, 0xd3, 0x8e, 0xcf, 0x5c, 0x88, 0x07, 0xe4, 0xd7, 0x14, 0xe5, 0x82, 0xc0,
+  0x60, 0xe8, 0x02, 0x49, 0x05, 0x23, 0xfa, 0xd2, 0xd5, 0x0b, 0x6c, 0x35, 0xee, 0x51, 0xc0, 0xff,
+  0x1a, 0xc8, 0x7b, 0x7a, 0x0c, 0xdb, 0xa1, 0xc4, 0x1e, 0x9f, 0xa0, 0xf2, 0x19, 0xbd, 0x81, 0x38,
+  0xa0, 0xde, 0x01, 0x78, 0xef, 0x34, 0x30, 0xbf, 0xb3, 0xb1, 0x23, 0xb3, 0x79, 0x87, 0xea, 0xf1,
+  0xd0, 0xa6, 0xf5, 0x28, 0xd2, 0xa6, 0x23, 0x60, 0xe3, 0x6d, 0xeb, 0x4f, 0x49, 0xa1, 0x08, 0x05,
+  0xd8, 0xbd, 0x2c, 0xfe, 0x80, 0xf0, 0xfb, 0xd1, 0xa6, 0x19, 0x10, 0x4a, 0x87, 0x2e, 0x4b, 0x57,
+  0xdc, 0x00, 0xf1, 0x4c, 0x37, 0x70, 0xf5, 0xf6, 0xe2, 0xd6, 0x93, 0x8a, 0xf1, 0xca, 0x84, 0xce,
+  0x75, 0xf1, 0xfd, 0x91, 0x4d, 0x48, 0x2e, 0x5c, 0xf9, 0x6e, 0xc0, 0x21, 0x78, 0x59, 0xb7, 0x6f,
+  0x4d, 0xbf, 0xed, 0x86, 0xc3, 0x62, 0x56, 0x74, 0x3f, 0x1d, 0xfe, 0x07, 0xaf, 0x6b, 0x05, 0x8d,
+  0x51, 0x0c, 0x00, 0x00,
+};
+
+#endif // WEB_ASSETS_H
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <algorithm>
+
+#include "arduino_config.h"
+#include "hal.h"
+#include "calibration.h"
+#include "motor_ramp.h"
+#include "wheel_speed.h"
+
+// Glitch filter in APB cycles (80 MHz): ignore pulses shorter than ~1.25 us
+#define ENCODER_FILTER_CYCLES 100
+
+// Weight of the newest sample in the speed estimate; encoder counts per
+// period are small, so the raw estimate is coarse
+#define SPEED_FILTER_ALPHA 0.25f
+
+struct WheelPid
+{
+  float measuredRpm;
+  float integral;
+  float previousError;
+  int activeChannel;
+  int trim;
+  int targetRpm;
+};
+
+static WheelPid wheels[MOTOR_COUNT];
+
+void setUpWheelEncoders()
+{
+  if (!ENCODERS_ENABLED)
+  {
+    return;
+  }
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    halEncoderSetup(i, ENCODER_PINS[i][0], ENCODER_PINS[i][1], ENCODER_FILTER_CYCLES);
+  }
+}
+
+static void resetPid(WheelPid &wheel, int activeChannel)
+{
+  wheel.integral = 0;
+  wheel.previousError = 0;
+  wheel.activeChannel = activeChannel;
+  wheel.trim = 0;
+}
+
+void wheelSpeedStep()
+{
+  if (!ENCODERS_ENABLED)
+  {
+    return;
+  }
+
+  const float period = 1.0f / SPEED_LOOP_HZ;
+  const float countsToRpm = 60.0f * SPEED_LOOP_HZ / ENCODER_COUNTS_PER_REV;
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    WheelPid &wheel = wheels[i];
+    int channel = 0;
+    int duty = rampActiveDuty(i, channel);
+
+    // Speed magnitude only: single-channel encoders cannot tell direction
+    float sample = abs(halEncoderTake(i)) * countsToRpm;
+    wheel.measuredRpm += SPEED_FILTER_ALPHA * (sample - wheel.measuredRpm);
+    wheel.targetRpm = duty * SPEED_MAX_RPM / activeCalibration().maxSpeed;
+
+    // Stopped, or just changed direction: start the loop from scratch
+    if (duty == 0 || channel != wheel.activeChannel)
+    {
+      resetPid(wheel, channel);
+      rampSetTrim(i, 0);
+      continue;
+    }
+
+    float error = wheel.targetRpm - wheel.measuredRpm;
+    float derivative = (error - wheel.previousError) / period;
+    wheel.previousError = error;
+
+    // Anti-windup: the integral term alone never exceeds the trim limit
+    if (SPEED_PID_KI > 0)
+    {
+      float integralLimit = SPEED_TRIM_LIMIT / SPEED_PID_KI;
+      wheel.integral = std::min(std::max(wheel.integral + error * period, -integralLimit), integralLimit);
+    }
+
+    float output = SPEED_PID_KP * error + SPEED_PID_KI * wheel.integral + SPEED_PID_KD * derivative;
+    wheel.trim = std::min(std::max((int)output, -SPEED_TRIM_LIMIT), SPEED_TRIM_LIMIT);
+    rampSetTrim(i, wheel.trim);
+  }
+}
+
+WheelSpeedStats getWheelSpeedStats()
+{
+  WheelSpeedStats stats = {};
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    stats.targetRpm[i] = wheels[i].targetRpm;
+    stats.measuredRpm[i] = (int)wheels[i].measuredRpm;
+    stats.trim[i] = wheels[i].trim;
+  }
+  return stats;
+}
@@ -0,0 +1,36 @@
+/*
+ * Optional closed-loop wheel speed control
+ *
+ * Each wheel's encoder is counted by its own PCNT unit, so encoder edges
+ * cost no interrupts. At SPEED_LOOP_HZ the motor task reads the counts and
+ * runs one PID per wheel: the ramped duty of a motor becomes a speed
+ * setpoint (MAX_SPEED = SPEED_MAX_RPM) and the PID output trims that duty
+ * so every wheel actually turns at it.
+ *
+ * Encoders are wired per ENCODER_PINS in arduino_config.h; a channel B pin
+ * of -1 counts channel A alone. All of this is compiled in but idle unless
+ * ENCODERS_ENABLED is set.
+ */
+
+#ifndef WHEEL_SPEED_H
+#define WHEEL_SPEED_H
+
+#include <stdint.h>
+
+#include "car_commands.h"
+
+struct WheelSpeedStats
+{
+  int targetRpm[MOTOR_COUNT];
+  int measuredRpm[MOTOR_COUNT];
+  int trim[MOTOR_COUNT];
+};
+
+void setUpWheelEncoders();
+
+// One control period; only call from the motor task
+void wheelSpeedStep();
+
+WheelSpeedStats getWheelSpeedStats();
+
+#endif // WHEEL_SPEED_H
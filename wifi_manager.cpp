@@ -0,0 +1,202 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <atomic>
+
+#include "arduino_config.h"
+#include "car_log.h"
+#include "motor_control.h"
+#include "wifi_manager.h"
+
+#define WIFI_CACHE_NAMESPACE "wifi"
+#define WIFI_CACHE_KEY "ap"
+
+// Access point last connected to, keyed by SSID so a config change invalidates it
+struct WifiApCache
+{
+  uint32_t ssidHash;
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+static WifiApCache apCache = {};
+static bool apCacheValid = false;
+static bool attemptUsesCache = false;
+
+// Set on the WiFi event task, consumed by serviceWifi()
+static std::atomic<bool> connected{false};
+static std::atomic<bool> gotIpPending{false};
+static std::atomic<bool> disconnectPending{false};
+
+static uint32_t attemptStartMillis = 0;
+static uint32_t reconnectAtMillis = 0;
+static bool reconnectScheduled = false;
+static uint32_t failedAttempts = 0;
+static WifiStats stats = {};
+
+static uint32_t hashSsid(const char *ssid)
+{
+  uint32_t hash = 2166136261u;  // FNV-1a
+
+  while (*ssid)
+  {
+    hash = (hash ^ (uint8_t)*ssid++) * 16777619u;
+  }
+  return hash;
+}
+
+static void loadApCache()
+{
+  Preferences preferences;
+
+  if (!WIFI_FAST_CONNECT || !preferences.begin(WIFI_CACHE_NAMESPACE, true))
+  {
+    return;
+  }
+  apCacheValid = preferences.getBytes(WIFI_CACHE_KEY, &apCache, sizeof(apCache)) == sizeof(apCache) &&
+                 apCache.ssidHash == hashSsid(WIFI_SSID) && apCache.channel != 0;
+  preferences.end();
+}
+
+static void saveApCache()
+{
+  WifiApCache current = {};
+  const uint8_t *bssid = WiFi.BSSID();
+
+  if (!WIFI_FAST_CONNECT || bssid == nullptr)
+  {
+    return;
+  }
+
+  current.ssidHash = hashSsid(WIFI_SSID);
+  memcpy(current.bssid, bssid, sizeof(current.bssid));
+  current.channel = WiFi.channel();
+
+  // Flash writes only when the access point actually changed
+  if (apCacheValid && memcmp(&current, &apCache, sizeof(current)) == 0)
+  {
+    return;
+  }
+
+  Preferences preferences;
+  if (preferences.begin(WIFI_CACHE_NAMESPACE, false))
+  {
+    preferences.putBytes(WIFI_CACHE_KEY, &current, sizeof(current));
+    preferences.end();
+    apCache = current;
+    apCacheValid = true;
+    LOG_DEBUG("Cached access point on channel %u", current.channel);
+  }
+}
+
+static void beginConnect()
+{
+  attemptUsesCache = apCacheValid;
+  attemptStartMillis = millis();
+
+  if (attemptUsesCache)
+  {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, apCache.channel, apCache.bssid);
+  }
+  else
+  {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  }
+  LOG_INFO("Connecting to WiFi network %s%s", WIFI_SSID, attemptUsesCache ? " (cached access point)" : "");
+}
+
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+  switch (event)
+  {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      connected.store(true);
+      gotIpPending.store(true);
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      // Fires both when a link drops and when an attempt fails
+      if (connected.exchange(false))
+      {
+        requestMotorStop();
+      }
+      disconnectPending.store(true);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void startWifi()
+{
+  loadApCache();
+
+  WiFi.persistent(false);       // credentials come from arduino_config.h, not flash
+  WiFi.setAutoReconnect(false);  // serviceWifi() owns reconnects and backoff
+  WiFi.mode(WIFI_STA);
+  WiFi.onEvent(onWifiEvent);
+
+  if (WIFI_STATIC_IP[0] != '\0')
+  {
+    IPAddress ip, gateway, subnet, dns;
+    if (ip.fromString(WIFI_STATIC_IP) && gateway.fromString(WIFI_GATEWAY) && subnet.fromString(WIFI_SUBNET))
+    {
+      dns.fromString(WIFI_DNS[0] != '\0' ? WIFI_DNS : WIFI_GATEWAY);
+      WiFi.config(ip, gateway, subnet, dns);
+    }
+    else
+    {
+      LOG_WARN("Invalid static IP configuration, using DHCP");
+    }
+  }
+
+  beginConnect();
+}
+
+void serviceWifi()
+{
+  if (gotIpPending.exchange(false))
+  {
+    failedAttempts = 0;
+    reconnectScheduled = false;
+    stats.connects++;
+    stats.lastConnectMillis = millis() - attemptStartMillis;
+    stats.fastConnect = attemptUsesCache;
+
+    LOG_INFO("Connected to WiFi network %s in %lu ms", WIFI_SSID, (unsigned long)stats.lastConnectMillis);
+    LOG_INFO("IP address: %s", WiFi.localIP().toString().c_str());
+    LOG_INFO("Signal strength (RSSI): %d dBm", WiFi.RSSI());
+    saveApCache();
+  }
+
+  if (disconnectPending.exchange(false) && !connected.load())
+  {
+    stats.disconnects++;
+
+    // A cached access point that fails once is dropped in favour of a full scan
+    if (attemptUsesCache)
+    {
+      apCacheValid = false;
+    }
+
+    uint32_t backoff = min((uint32_t)WIFI_RECONNECT_MAX_MS, (uint32_t)WIFI_RECONNECT_MIN_MS << min(failedAttempts, 8u));
+    failedAttempts++;
+    reconnectAtMillis = millis() + backoff;
+    reconnectScheduled = true;
+    LOG_WARN("WiFi disconnected, retrying in %lu ms", (unsigned long)backoff);
+  }
+
+  if (reconnectScheduled && (int32_t)(millis() - reconnectAtMillis) >= 0)
+  {
+    reconnectScheduled = false;
+    beginConnect();
+  }
+}
+
+WifiStats getWifiStats()
+{
+  WifiStats current = stats;
+  current.connected = connected.load();
+  return current;
+}
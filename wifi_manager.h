@@ -0,0 +1,30 @@
+/*
+ * Non-blocking WiFi station management
+ *
+ * startWifi() returns at once; connection progress arrives as WiFi events
+ * and serviceWifi() (called from the service task) schedules reconnects
+ * with backoff. With WIFI_FAST_CONNECT the BSSID and channel of the last
+ * access point are cached in NVS so a warm boot skips the scan, and
+ * WIFI_STATIC_IP skips DHCP. Losing the link stops the motors.
+ */
+
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <stdint.h>
+
+struct WifiStats
+{
+  bool connected;
+  uint32_t connects;
+  uint32_t disconnects;
+  uint32_t lastConnectMillis;  // begin() to IP for the most recent connection
+  bool fastConnect;            // most recent attempt used the cached access point
+};
+
+void startWifi();
+void serviceWifi();
+
+WifiStats getWifiStats();
+
+#endif // WIFI_MANAGER_H